@@ -0,0 +1,87 @@
+#ifndef __FSL_COMMON_H__
+#define __FSL_COMMON_H__
+
+// Host replacement of the KSDK fsl_common.h. Only the subset that the firmware sources use is provided.
+
+// Includes:
+
+    #include <assert.h>
+    #include <stdbool.h>
+    #include <stddef.h>
+    #include <stdint.h>
+    #include <string.h>
+    #include <strings.h>
+    #include "fsl_device_registers.h"
+    #include "fsl_clock.h"
+
+// Macros:
+
+    #define MAKE_STATUS(group, code) ((((group)*100) + (code)))
+
+    #ifndef MIN
+        #define MIN(a, b) ((a) < (b) ? (a) : (b))
+    #endif
+
+    #ifndef MAX
+        #define MAX(a, b) ((a) > (b) ? (a) : (b))
+    #endif
+
+    #define USEC_TO_COUNT(us, clockFreqInHz) (uint64_t)((uint64_t)(us) * (clockFreqInHz) / 1000000U)
+    #define COUNT_TO_USEC(count, clockFreqInHz) (uint64_t)((uint64_t)(count) * 1000000U / (clockFreqInHz))
+    #define MSEC_TO_COUNT(ms, clockFreqInHz) (uint64_t)((uint64_t)(ms) * (clockFreqInHz) / 1000U)
+    #define COUNT_TO_MSEC(count, clockFreqInHz) (uint64_t)((uint64_t)(count) * 1000U / (clockFreqInHz))
+
+    #define __WFI() ((void)0)
+    #define __NOP() ((void)0)
+
+// Typedefs:
+
+    typedef int32_t status_t;
+
+    enum _status_groups {
+        kStatusGroup_Generic = 0,
+        kStatusGroup_I2C = 13,
+    };
+
+    enum _generic_status {
+        kStatus_Success = MAKE_STATUS(kStatusGroup_Generic, 0),
+        kStatus_Fail = MAKE_STATUS(kStatusGroup_Generic, 1),
+        kStatus_ReadOnly = MAKE_STATUS(kStatusGroup_Generic, 2),
+        kStatus_OutOfRange = MAKE_STATUS(kStatusGroup_Generic, 3),
+        kStatus_InvalidArgument = MAKE_STATUS(kStatusGroup_Generic, 4),
+        kStatus_Timeout = MAKE_STATUS(kStatusGroup_Generic, 5),
+        kStatus_NoTransferInProgress = MAKE_STATUS(kStatusGroup_Generic, 6),
+    };
+
+// Functions:
+
+    static inline uint32_t DisableGlobalIRQ(void)
+    {
+        return 0;
+    }
+
+    static inline void EnableGlobalIRQ(uint32_t primask)
+    {
+        (void)primask;
+    }
+
+    static inline void EnableIRQ(IRQn_Type interrupt)
+    {
+        (void)interrupt;
+    }
+
+    static inline void DisableIRQ(IRQn_Type interrupt)
+    {
+        (void)interrupt;
+    }
+
+    static inline void NVIC_SetPriority(IRQn_Type interrupt, uint32_t priority)
+    {
+        (void)interrupt;
+        (void)priority;
+    }
+
+    // Provided by the simulated device that gets reset.
+    void NVIC_SystemReset(void);
+
+#endif
@@ -0,0 +1,6 @@
+#include "fsl_device_registers.h"
+
+PORT_Type HostPorts[HOST_PORT_COUNT];
+GPIO_Type HostGpios[HOST_GPIO_COUNT];
+I2C_Type HostI2cs[HOST_I2C_COUNT];
+PIT_Type HostPit;
@@ -0,0 +1,94 @@
+#ifndef __FSL_DEVICE_REGISTERS_H__
+#define __FSL_DEVICE_REGISTERS_H__
+
+// Host replacement of the KSDK device header. The peripheral register layouts mirror the Kinetis parts so
+// that code accessing registers directly works unchanged, but the peripherals are plain memory.
+
+// Includes:
+
+    #include <stdint.h>
+
+// Macros:
+
+    #define HOST_PORT_COUNT 5
+    #define HOST_GPIO_COUNT 5
+    #define HOST_I2C_COUNT 2
+    #define HOST_PIT_CHANNEL_COUNT 4
+
+    #define PORTA (&HostPorts[0])
+    #define PORTB (&HostPorts[1])
+    #define PORTC (&HostPorts[2])
+    #define PORTD (&HostPorts[3])
+    #define PORTE (&HostPorts[4])
+
+    #define GPIOA (&HostGpios[0])
+    #define GPIOB (&HostGpios[1])
+    #define GPIOC (&HostGpios[2])
+    #define GPIOD (&HostGpios[3])
+    #define GPIOE (&HostGpios[4])
+
+    #define I2C0 (&HostI2cs[0])
+    #define I2C1 (&HostI2cs[1])
+
+    #define PIT (&HostPit)
+
+// Typedefs:
+
+    typedef enum {
+        PIT0_IRQn,
+        PIT1_IRQn,
+        PIT2_IRQn,
+        PIT3_IRQn,
+        I2C0_IRQn,
+        I2C1_IRQn,
+        USB0_IRQn,
+        PORTB_IRQn,
+        LPTMR0_IRQn,
+    } IRQn_Type;
+
+    typedef struct {
+        volatile uint32_t PCR[32];
+    } PORT_Type;
+
+    typedef struct {
+        volatile uint32_t PDOR;
+        volatile uint32_t PSOR;
+        volatile uint32_t PCOR;
+        volatile uint32_t PTOR;
+        volatile uint32_t PDIR;
+        volatile uint32_t PDDR;
+    } GPIO_Type;
+
+    typedef struct {
+        volatile uint8_t A1;
+        volatile uint8_t F;
+        volatile uint8_t C1;
+        volatile uint8_t S;
+        volatile uint8_t D;
+        volatile uint8_t C2;
+        volatile uint8_t FLT;
+        volatile uint8_t RA;
+        volatile uint8_t SMB;
+        volatile uint8_t A2;
+        volatile uint8_t SLTH;
+        volatile uint8_t SLTL;
+    } I2C_Type;
+
+    typedef struct {
+        volatile uint32_t MCR;
+        struct {
+            volatile uint32_t LDVAL;
+            volatile uint32_t CVAL;
+            volatile uint32_t TCTRL;
+            volatile uint32_t TFLG;
+        } CHANNEL[HOST_PIT_CHANNEL_COUNT];
+    } PIT_Type;
+
+// Variables:
+
+    extern PORT_Type HostPorts[HOST_PORT_COUNT];
+    extern GPIO_Type HostGpios[HOST_GPIO_COUNT];
+    extern I2C_Type HostI2cs[HOST_I2C_COUNT];
+    extern PIT_Type HostPit;
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef __FSL_GPIO_H__
+#define __FSL_GPIO_H__
+
+// Host replacement of the KSDK fsl_gpio.h. Every output change notifies the simulator, which recomputes
+// the input registers from the simulated key matrices.
+
+// Includes:
+
+    #include "fsl_common.h"
+    #include "fsl_port.h"
+
+// Typedefs:
+
+    typedef enum {
+        kGPIO_DigitalInput,
+        kGPIO_DigitalOutput,
+    } gpio_pin_direction_t;
+
+    typedef struct {
+        gpio_pin_direction_t pinDirection;
+        uint8_t outputLogic;
+    } gpio_pin_config_t;
+
+// Functions:
+
+    void HostGpio_OutputChanged(GPIO_Type *base);
+
+    static inline void GPIO_WritePinOutput(GPIO_Type *base, uint32_t pin, uint8_t output)
+    {
+        if (output) {
+            base->PDOR |= 1U << pin;
+        } else {
+            base->PDOR &= ~(1U << pin);
+        }
+        HostGpio_OutputChanged(base);
+    }
+
+    static inline void GPIO_SetPinsOutput(GPIO_Type *base, uint32_t mask)
+    {
+        base->PDOR |= mask;
+        HostGpio_OutputChanged(base);
+    }
+
+    static inline void GPIO_ClearPinsOutput(GPIO_Type *base, uint32_t mask)
+    {
+        base->PDOR &= ~mask;
+        HostGpio_OutputChanged(base);
+    }
+
+    static inline void GPIO_TogglePinsOutput(GPIO_Type *base, uint32_t mask)
+    {
+        base->PDOR ^= mask;
+        HostGpio_OutputChanged(base);
+    }
+
+    static inline uint32_t GPIO_ReadPinInput(GPIO_Type *base, uint32_t pin)
+    {
+        return (base->PDIR >> pin) & 1U;
+    }
+
+    static inline void GPIO_PinInit(GPIO_Type *base, uint32_t pin, const gpio_pin_config_t *config)
+    {
+        if (config->pinDirection == kGPIO_DigitalInput) {
+            base->PDDR &= ~(1U << pin);
+        } else {
+            base->PDDR |= 1U << pin;
+            GPIO_WritePinOutput(base, pin, config->outputLogic);
+        }
+    }
+
+#endif
@@ -0,0 +1,58 @@
+#include "fsl_i2c.h"
+#include "virtual_i2c_bus.h"
+
+// Host I2C master driver. Transfers are carried out by the virtual I2C bus of the simulator.
+
+volatile uint32_t I2C_Watchdog;
+uint32_t I2C_ActualBaudRate;
+
+void I2C_MasterGetDefaultConfig(i2c_master_config_t *masterConfig)
+{
+    masterConfig->enableMaster = true;
+    masterConfig->enableStopHold = false;
+    masterConfig->baudRate_Bps = 100000U;
+    masterConfig->glitchFilterWidth = 0;
+}
+
+void I2C_MasterInit(I2C_Type *base, const i2c_master_config_t *masterConfig, uint32_t srcClock_Hz)
+{
+    (void)base;
+    (void)srcClock_Hz;
+    I2C_ActualBaudRate = masterConfig->baudRate_Bps;
+    VirtualI2cBus_Config.baudRateBps = masterConfig->baudRate_Bps;
+}
+
+void I2C_MasterSetBaudRate(I2C_Type *base, uint32_t baudRate_Bps, uint32_t srcClock_Hz)
+{
+    (void)base;
+    (void)srcClock_Hz;
+    I2C_ActualBaudRate = baudRate_Bps;
+    VirtualI2cBus_Config.baudRateBps = baudRate_Bps;
+}
+
+void I2C_MasterDeinit(I2C_Type *base)
+{
+    (void)base;
+    VirtualI2cBus_AbortTransfer();
+}
+
+void I2C_MasterTransferCreateHandle(I2C_Type *base, i2c_master_handle_t *handle,
+                                    i2c_master_transfer_callback_t callback, void *userData)
+{
+    (void)base;
+    memset(handle, 0, sizeof(*handle));
+    handle->completionCallback = callback;
+    handle->userData = userData;
+}
+
+status_t I2C_MasterTransferNonBlocking(I2C_Type *base, i2c_master_handle_t *handle, i2c_master_transfer_t *xfer)
+{
+    return VirtualI2cBus_StartTransfer(base, handle, xfer);
+}
+
+void I2C_MasterTransferAbort(I2C_Type *base, i2c_master_handle_t *handle)
+{
+    (void)base;
+    (void)handle;
+    VirtualI2cBus_AbortTransfer();
+}
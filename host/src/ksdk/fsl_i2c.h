@@ -0,0 +1,79 @@
+#ifndef __FSL_I2C_H__
+#define __FSL_I2C_H__
+
+// Host replacement of the KSDK fsl_i2c.h. Transfers are handed to the host I2C back-end instead of a peripheral.
+
+// Includes:
+
+    #include "fsl_common.h"
+
+// Typedefs:
+
+    enum _i2c_status {
+        kStatus_I2C_Busy = MAKE_STATUS(kStatusGroup_I2C, 0),
+        kStatus_I2C_Idle = MAKE_STATUS(kStatusGroup_I2C, 1),
+        kStatus_I2C_Nak = MAKE_STATUS(kStatusGroup_I2C, 2),
+        kStatus_I2C_ArbitrationLost = MAKE_STATUS(kStatusGroup_I2C, 3),
+        kStatus_I2C_Timeout = MAKE_STATUS(kStatusGroup_I2C, 4),
+    };
+
+    typedef enum {
+        kI2C_Write = 0x0U,
+        kI2C_Read = 0x1U,
+    } i2c_direction_t;
+
+    enum _i2c_master_transfer_flags {
+        kI2C_TransferDefaultFlag = 0x0U,
+        kI2C_TransferNoStartFlag = 0x1U,
+        kI2C_TransferRepeatedStartFlag = 0x2U,
+        kI2C_TransferNoStopFlag = 0x4U,
+    };
+
+    typedef struct {
+        bool enableMaster;
+        bool enableStopHold;
+        uint32_t baudRate_Bps;
+        uint8_t glitchFilterWidth;
+    } i2c_master_config_t;
+
+    typedef struct {
+        uint32_t flags;
+        uint8_t slaveAddress;
+        i2c_direction_t direction;
+        uint32_t subaddress;
+        uint8_t subaddressSize;
+        uint8_t *volatile data;
+        volatile size_t dataSize;
+    } i2c_master_transfer_t;
+
+    typedef struct _i2c_master_handle i2c_master_handle_t;
+
+    typedef void (*i2c_master_transfer_callback_t)(I2C_Type *base, i2c_master_handle_t *handle, status_t status, void *userData);
+
+    struct _i2c_master_handle {
+        i2c_master_transfer_t transfer;
+        size_t transferSize;
+        uint8_t state;
+        i2c_master_transfer_callback_t completionCallback;
+        void *userData;
+    };
+
+// Variables:
+
+    // The patched KSDK of the firmware increments I2C_Watchdog upon every I2C interrupt and exposes the actual
+    // baud rate computed by I2C_MasterSetBaudRate(), which I2C_MasterInit() calls too.
+    extern volatile uint32_t I2C_Watchdog;
+    extern uint32_t I2C_ActualBaudRate;
+
+// Functions:
+
+    void I2C_MasterGetDefaultConfig(i2c_master_config_t *masterConfig);
+    void I2C_MasterInit(I2C_Type *base, const i2c_master_config_t *masterConfig, uint32_t srcClock_Hz);
+    void I2C_MasterSetBaudRate(I2C_Type *base, uint32_t baudRate_Bps, uint32_t srcClock_Hz);
+    void I2C_MasterDeinit(I2C_Type *base);
+    void I2C_MasterTransferCreateHandle(I2C_Type *base, i2c_master_handle_t *handle,
+                                        i2c_master_transfer_callback_t callback, void *userData);
+    status_t I2C_MasterTransferNonBlocking(I2C_Type *base, i2c_master_handle_t *handle, i2c_master_transfer_t *xfer);
+    void I2C_MasterTransferAbort(I2C_Type *base, i2c_master_handle_t *handle);
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef __FSL_PIT_H__
+#define __FSL_PIT_H__
+
+// Host replacement of the KSDK fsl_pit.h. The timers don't count by themselves: the simulator calls the
+// interrupt handlers when a period elapses, and the current count is the value it leaves in CVAL.
+
+// Includes:
+
+    #include "fsl_common.h"
+
+// Macros:
+
+    #define PIT_TFLG_TIF_MASK 0x1U
+    #define PIT_TCTRL_TEN_MASK 0x1U
+    #define PIT_TCTRL_TIE_MASK 0x2U
+
+// Typedefs:
+
+    typedef enum {
+        kPIT_Chnl_0,
+        kPIT_Chnl_1,
+        kPIT_Chnl_2,
+        kPIT_Chnl_3,
+    } pit_chnl_t;
+
+    typedef enum {
+        kPIT_TimerInterruptEnable = PIT_TCTRL_TIE_MASK,
+    } pit_interrupt_enable_t;
+
+    typedef enum {
+        kPIT_TimerFlag = PIT_TFLG_TIF_MASK,
+    } pit_status_flags_t;
+
+    typedef struct {
+        bool enableRunInDebug;
+    } pit_config_t;
+
+// Functions:
+
+    static inline void PIT_GetDefaultConfig(pit_config_t *config)
+    {
+        config->enableRunInDebug = false;
+    }
+
+    static inline void PIT_Init(PIT_Type *base, const pit_config_t *config)
+    {
+        (void)base;
+        (void)config;
+    }
+
+    static inline void PIT_SetTimerPeriod(PIT_Type *base, pit_chnl_t channel, uint32_t count)
+    {
+        base->CHANNEL[channel].LDVAL = count;
+        base->CHANNEL[channel].CVAL = count;
+    }
+
+    static inline uint32_t PIT_GetCurrentTimerCount(PIT_Type *base, pit_chnl_t channel)
+    {
+        return base->CHANNEL[channel].CVAL;
+    }
+
+    static inline void PIT_EnableInterrupts(PIT_Type *base, pit_chnl_t channel, uint32_t mask)
+    {
+        base->CHANNEL[channel].TCTRL |= mask;
+    }
+
+    static inline void PIT_StartTimer(PIT_Type *base, pit_chnl_t channel)
+    {
+        base->CHANNEL[channel].TCTRL |= PIT_TCTRL_TEN_MASK;
+    }
+
+    static inline void PIT_StopTimer(PIT_Type *base, pit_chnl_t channel)
+    {
+        base->CHANNEL[channel].TCTRL &= ~PIT_TCTRL_TEN_MASK;
+    }
+
+    static inline void PIT_ClearStatusFlags(PIT_Type *base, pit_chnl_t channel, uint32_t mask)
+    {
+        base->CHANNEL[channel].TFLG &= ~mask;
+    }
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef __FSL_PORT_H__
+#define __FSL_PORT_H__
+
+// Host replacement of the KSDK fsl_port.h. Pin muxing has no effect on the host.
+
+// Includes:
+
+    #include "fsl_common.h"
+
+// Typedefs:
+
+    typedef enum {
+        kPORT_PullDisable,
+        kPORT_PullDown,
+        kPORT_PullUp,
+    } port_pull_t;
+
+    typedef enum {
+        kPORT_OpenDrainDisable,
+        kPORT_OpenDrainEnable,
+    } port_open_drain_enable_t;
+
+    typedef enum {
+        kPORT_PinDisabledOrAnalog,
+        kPORT_MuxAsGpio,
+        kPORT_MuxAlt2,
+        kPORT_MuxAlt3,
+        kPORT_MuxAlt4,
+        kPORT_MuxAlt5,
+        kPORT_MuxAlt6,
+        kPORT_MuxAlt7,
+    } port_mux_t;
+
+    typedef struct {
+        uint16_t pullSelect;
+        uint16_t slewRate;
+        uint16_t passiveFilterEnable;
+        uint16_t openDrainEnable;
+        uint16_t driveStrength;
+        uint16_t mux;
+        uint16_t lockRegister;
+    } port_pin_config_t;
+
+// Functions:
+
+    static inline void PORT_SetPinConfig(PORT_Type *base, uint32_t pin, const port_pin_config_t *config)
+    {
+        base->PCR[pin] = config->mux;
+    }
+
+    static inline void PORT_SetPinMux(PORT_Type *base, uint32_t pin, port_mux_t mux)
+    {
+        base->PCR[pin] = mux;
+    }
+
+#endif
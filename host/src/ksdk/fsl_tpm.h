@@ -0,0 +1,10 @@
+#ifndef __FSL_TPM_H__
+#define __FSL_TPM_H__
+
+// Host replacement of the KSDK fsl_tpm.h. The left keyboard half only refers to it from led_pwm.h.
+
+// Includes:
+
+    #include "fsl_common.h"
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef __USB_H__
+#define __USB_H__
+
+// Host replacement of the KSDK usb.h.
+
+// Includes:
+
+    #include "fsl_common.h"
+
+// Macros:
+
+    #define USB_SETUP_PACKET_SIZE (8U)
+
+    #define USB_DESCRIPTOR_LENGTH_DEVICE (0x12U)
+    #define USB_DESCRIPTOR_LENGTH_CONFIGURE (0x09U)
+    #define USB_DESCRIPTOR_LENGTH_INTERFACE (0x09U)
+    #define USB_DESCRIPTOR_LENGTH_ENDPOINT (0x07U)
+
+    #define USB_DESCRIPTOR_TYPE_DEVICE (0x01U)
+    #define USB_DESCRIPTOR_TYPE_CONFIGURE (0x02U)
+    #define USB_DESCRIPTOR_TYPE_STRING (0x03U)
+    #define USB_DESCRIPTOR_TYPE_INTERFACE (0x04U)
+    #define USB_DESCRIPTOR_TYPE_ENDPOINT (0x05U)
+    #define USB_DESCRIPTOR_TYPE_HID (0x21U)
+    #define USB_DESCRIPTOR_TYPE_HID_REPORT (0x22U)
+
+    #define USB_DESCRIPTOR_CONFIGURE_ATTRIBUTE_D7_MASK (0x80U)
+    #define USB_DESCRIPTOR_CONFIGURE_ATTRIBUTE_SELF_POWERED_SHIFT (6U)
+    #define USB_DESCRIPTOR_CONFIGURE_ATTRIBUTE_REMOTE_WAKEUP_SHIFT (5U)
+    #define USB_DESCRIPTOR_ENDPOINT_ADDRESS_DIRECTION_SHIFT (7U)
+    #define USB_DESCRIPTOR_ENDPOINT_ADDRESS_DIRECTION_IN (0x80U)
+    #define USB_DESCRIPTOR_ENDPOINT_ADDRESS_DIRECTION_OUT (0x00U)
+
+    #define USB_ENDPOINT_CONTROL (0x00U)
+    #define USB_ENDPOINT_INTERRUPT (0x03U)
+    #define USB_IN (1U)
+    #define USB_OUT (0U)
+    #define USB_SHORT_GET_LOW(x) (((uint16_t)x) & 0xFFU)
+    #define USB_SHORT_GET_HIGH(x) ((uint8_t)(((uint16_t)x) >> 8U) & 0xFFU)
+
+// Typedefs:
+
+    typedef enum _usb_status {
+        kStatus_USB_Success = 0x00U,
+        kStatus_USB_Error,
+        kStatus_USB_Busy,
+        kStatus_USB_InvalidHandle,
+        kStatus_USB_InvalidParameter,
+        kStatus_USB_InvalidRequest,
+        kStatus_USB_ControllerNotFound,
+        kStatus_USB_InvalidControllerInterface,
+        kStatus_USB_NotSupported,
+        kStatus_USB_Retry,
+        kStatus_USB_TransferStall,
+        kStatus_USB_TransferFailed,
+        kStatus_USB_AllocFail,
+        kStatus_USB_LackSwapBuffer,
+        kStatus_USB_TransferCancel,
+        kStatus_USB_BandwidthFail,
+        kStatus_USB_MSDStatusFail,
+    } usb_status_t;
+
+    typedef enum _usb_controller_index {
+        kUSB_ControllerKhci0 = 0U,
+    } usb_controller_index_t;
+
+    typedef void *usb_device_handle;
+
+    typedef struct _usb_setup_struct {
+        uint8_t bmRequestType;
+        uint8_t bRequest;
+        uint16_t wValue;
+        uint16_t wIndex;
+        uint16_t wLength;
+    } usb_setup_struct_t;
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef __USB_DEVICE_H__
+#define __USB_DEVICE_H__
+
+// Host replacement of the KSDK usb_device.h.
+
+// Includes:
+
+    #include "usb.h"
+
+// Typedefs:
+
+    typedef usb_status_t (*usb_device_callback_t)(usb_device_handle handle, uint32_t callbackEvent, void *eventParam);
+
+#endif
@@ -0,0 +1,98 @@
+#include "virtual_left_keyboard_half.h"
+#include "main.h"
+#include "module.h"
+#include "i2c_addresses.h"
+#include "led_pwm.h"
+#include "slave_protocol_handler.h"
+#include "key_scanner.h"
+#include "key_events.h"
+
+// Runs the message handlers of the left keyboard half firmware behind a virtual I2C slave. This file is
+// compiled against the headers of left/src, the byte handling mirrors i2cSlaveCallback() of init_peripherals.c.
+// The key matrix isn't scanned, key states are set directly and queued as key events. The key scanner ticks
+// of the events are derived from the virtual clock.
+
+key_matrix_t keyMatrix = {
+    .colNum = KEYBOARD_MATRIX_COLS_NUM,
+    .rowNum = KEYBOARD_MATRIX_ROWS_NUM,
+};
+
+virtual_left_keyboard_half_state_t VirtualLeftKeyboardHalf_State;
+
+// Declared by virtual_timer.h, which can't be included here as it pulls in the timer of the right half.
+extern uint64_t VirtualTimer_CurrentTimeMicros;
+
+static uint64_t nextTickTimeMicros;
+
+static void tick(void)
+{
+    while (nextTickTimeMicros <= VirtualTimer_CurrentTimeMicros) {
+        KeyEvents_Tick();
+        nextTickTimeMicros += KEY_SCANNER_INTERVAL_USEC;
+    }
+}
+
+static void receive(virtual_i2c_slave_t *slave, const uint8_t *data, size_t length)
+{
+    uint8_t rxMessagePos = 0;
+
+    for (size_t i = 0; i < length && rxMessagePos < sizeof(i2c_message_t); i++) {
+        ((uint8_t*)&RxMessage)[rxMessagePos++] = data[i];
+        if (RxMessage.length == rxMessagePos-I2C_MESSAGE_HEADER_LENGTH) {
+            VirtualLeftKeyboardHalf_State.rxMessageCount++;
+            SlaveRxHandler();
+        }
+    }
+}
+
+static void transmit(virtual_i2c_slave_t *slave, uint8_t *data, size_t length)
+{
+    tick();
+    SlaveTxHandler();
+    VirtualLeftKeyboardHalf_State.txMessageCount++;
+    memcpy(data, &TxMessage, MIN(length, TxMessage.length + I2C_MESSAGE_HEADER_LENGTH));
+}
+
+virtual_i2c_slave_t VirtualLeftKeyboardHalf_Slave = {
+    .address = I2C_ADDRESS_LEFT_KEYBOARD_HALF_FIRMWARE,
+    .isConnected = true,
+    .receive = receive,
+    .transmit = transmit,
+};
+
+void LedPwm_SetBrightness(uint8_t brightnessPercent)
+{
+    VirtualLeftKeyboardHalf_State.ledPwmBrightness = brightnessPercent;
+}
+
+void NVIC_SystemReset(void)
+{
+    VirtualLeftKeyboardHalf_State.resetCount++;
+}
+
+void VirtualLeftKeyboardHalf_Init(void)
+{
+    memset(keyMatrix.rowStates, 0, sizeof(keyMatrix.rowStates));
+    memset(&RxMessage, 0, sizeof(RxMessage));
+    memset(&TxMessage, 0, sizeof(TxMessage));
+    memset(&VirtualLeftKeyboardHalf_State, 0, sizeof(VirtualLeftKeyboardHalf_State));
+    VirtualLeftKeyboardHalf_State.ledPwmBrightness = INITIAL_DUTY_CYCLE_PERCENT;
+    nextTickTimeMicros = VirtualTimer_CurrentTimeMicros;
+
+    uint8_t discardedEvents[I2C_MESSAGE_MAX_PAYLOAD_LENGTH];
+    KeyEvents_Serialize(discardedEvents, false);
+}
+
+void VirtualLeftKeyboardHalf_SetKeyState(uint8_t keyId, bool isPressed)
+{
+    if (keyId < MODULE_KEY_COUNT && KeyMatrix_GetKeyState(&keyMatrix, keyId) != isPressed) {
+        uint32_t colMask = 1U << (keyId % KEYBOARD_MATRIX_COLS_NUM);
+        tick();
+        KeyEvents_Push(keyId, isPressed);
+        if (isPressed) {
+            keyMatrix.rowStates[keyId / KEYBOARD_MATRIX_COLS_NUM] |= colMask;
+        } else {
+            keyMatrix.rowStates[keyId / KEYBOARD_MATRIX_COLS_NUM] &= ~colMask;
+        }
+    }
+}
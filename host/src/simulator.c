@@ -0,0 +1,472 @@
+#include "simulator.h"
+#include "virtual_timer.h"
+#include "key_matrix.h"
+#include "right_key_matrix.h"
+#include "key_scanner.h"
+#include "key_states.h"
+#include "module_key_events.h"
+#include "keymap.h"
+#include "usb_composite_device.h"
+#include "usb_report_updater.h"
+#include "config_parser/config_globals.h"
+#include "config_parser/parse_config.h"
+#include "eeprom.h"
+#include "profiler.h"
+#include "timer.h"
+#include "i2c.h"
+#include "i2c_addresses.h"
+#include "i2c_watchdog.h"
+#include "i2c_baud_rate.h"
+#include "init_peripherals.h"
+#include "slave_scheduler.h"
+#include "slave_drivers/uhk_module_driver.h"
+#include "virtual_i2c_bus.h"
+#include "virtual_left_keyboard_half.h"
+
+typedef struct {
+    simulator_report_type_t type;
+    uint8_t endpointIndex;
+    uint8_t descriptorPollIntervalMsec;
+    uint8_t reportLength;
+    usb_device_class_callback_t callback;
+    bool isBusy;
+    simulator_report_t pendingReport;
+} simulated_endpoint_t;
+
+typedef struct {
+    key_matrix_t *keyMatrix;
+    bool pressedKeys[MAX_KEYS_IN_MATRIX];
+} simulated_key_matrix_t;
+
+simulator_config_t Simulator_Config = {
+    .mainLoopIterationsPerTick = 1,
+    .usbPollIntervalMsec = 0,
+    .isUsbAttached = true,
+    .isI2cBusSimulated = false,
+    .i2cBaudRateBps = 0,
+};
+
+uint32_t Simulator_DroppedReportCount;
+virtual_is31fl3731_t Simulator_LedDrivers[LED_DRIVER_MAX_COUNT];
+
+// Normally invoked by the PIT, see nextKeyScanTimeMicros.
+void PIT_KEY_SCANNER_HANDLER(void);
+
+// The symbols below are normally defined by i2c_watchdog.c which is bound to the PIT.
+uint32_t I2cWatchdog_WatchCounter;
+uint32_t I2cWatchdog_RecoveryCounter;
+
+// The symbols below are normally defined by init_peripherals.c which is bound to the KSDK port and clock drivers.
+volatile uint32_t I2cMainBusRequestedBaudRateBps;
+volatile uint32_t I2cMainBusActualBaudRateBps;
+
+// The symbols below are normally defined by usb_composite_device.c which is bound to the KSDK USB stack.
+volatile bool SleepModeActive;
+usb_composite_device_t UsbCompositeDevice;
+
+static simulated_endpoint_t simulatedEndpoints[] = {
+    {
+        .type = SimulatorReportType_BasicKeyboard,
+        .endpointIndex = USB_BASIC_KEYBOARD_ENDPOINT_INDEX,
+        .descriptorPollIntervalMsec = USB_BASIC_KEYBOARD_INTERRUPT_IN_INTERVAL,
+        .reportLength = USB_BASIC_KEYBOARD_REPORT_LENGTH,
+        .callback = UsbBasicKeyboardCallback,
+    },
+    {
+        .type = SimulatorReportType_MediaKeyboard,
+        .endpointIndex = USB_MEDIA_KEYBOARD_ENDPOINT_INDEX,
+        .descriptorPollIntervalMsec = USB_MEDIA_KEYBOARD_INTERRUPT_IN_INTERVAL,
+        .reportLength = USB_MEDIA_KEYBOARD_REPORT_LENGTH,
+        .callback = UsbMediaKeyboardCallback,
+    },
+    {
+        .type = SimulatorReportType_SystemKeyboard,
+        .endpointIndex = USB_SYSTEM_KEYBOARD_ENDPOINT_INDEX,
+        .descriptorPollIntervalMsec = USB_SYSTEM_KEYBOARD_INTERRUPT_IN_INTERVAL,
+        .reportLength = USB_SYSTEM_KEYBOARD_REPORT_LENGTH,
+        .callback = UsbSystemKeyboardCallback,
+    },
+    {
+        .type = SimulatorReportType_Mouse,
+        .endpointIndex = USB_MOUSE_ENDPOINT_INDEX,
+        .descriptorPollIntervalMsec = USB_MOUSE_INTERRUPT_IN_INTERVAL,
+        .reportLength = USB_MOUSE_REPORT_LENGTH,
+        .callback = UsbMouseCallback,
+    },
+};
+
+#define SIMULATED_ENDPOINT_COUNT (sizeof(simulatedEndpoints) / sizeof(simulated_endpoint_t))
+
+static simulated_key_matrix_t simulatedRightKeyMatrix = {
+    .keyMatrix = &RightKeyMatrix,
+};
+
+static simulator_report_t reports[SIMULATOR_MAX_REPORT_COUNT];
+static uint16_t reportCount;
+
+static simulator_key_event_t keyEvents[SIMULATOR_MAX_KEY_EVENT_COUNT];
+static uint16_t keyEventCount;
+
+static uint32_t previousI2cWatchdogCounter;
+static uint64_t nextKeyScanTimeMicros;
+
+// Matrix model
+
+static void updateMatrixInputs(simulated_key_matrix_t *simulatedKeyMatrix)
+{
+    key_matrix_t *keyMatrix = simulatedKeyMatrix->keyMatrix;
+
+    for (uint8_t colId = 0; colId < keyMatrix->colNum; colId++) {
+        key_matrix_pin_t *col = keyMatrix->cols + colId;
+        bool isHigh = false;
+        for (uint8_t rowId = 0; rowId < keyMatrix->rowNum; rowId++) {
+            key_matrix_pin_t *row = keyMatrix->rows + rowId;
+            bool isRowDriven = (row->gpio->PDOR >> row->pin) & 1;
+            if (isRowDriven && simulatedKeyMatrix->pressedKeys[rowId * keyMatrix->colNum + colId]) {
+                isHigh = true;
+                break;
+            }
+        }
+        if (isHigh) {
+            col->gpio->PDIR |= 1U << col->pin;
+        } else {
+            col->gpio->PDIR &= ~(1U << col->pin);
+        }
+    }
+}
+
+void HostGpio_OutputChanged(GPIO_Type *base)
+{
+    (void)base;
+    if (simulatedRightKeyMatrix.keyMatrix->cols) {
+        updateMatrixInputs(&simulatedRightKeyMatrix);
+    }
+}
+
+// USB model
+
+void WakeUpHost(void)
+{
+    SleepModeActive = false;
+}
+
+static simulated_endpoint_t *getEndpoint(uint8_t endpointIndex)
+{
+    for (uint8_t i = 0; i < SIMULATED_ENDPOINT_COUNT; i++) {
+        if (simulatedEndpoints[i].endpointIndex == endpointIndex) {
+            return simulatedEndpoints + i;
+        }
+    }
+    return NULL;
+}
+
+usb_status_t USB_DeviceHidSend(class_handle_t handle, uint8_t ep, uint8_t *buffer, uint32_t length)
+{
+    simulated_endpoint_t *endpoint = getEndpoint(ep);
+    if (!endpoint || length > SIMULATOR_MAX_REPORT_LENGTH) {
+        return kStatus_USB_InvalidParameter;
+    }
+    if (endpoint->isBusy) {
+        return kStatus_USB_Busy;
+    }
+
+    simulator_report_t *report = &endpoint->pendingReport;
+    report->type = endpoint->type;
+    report->queueTimeMicros = Simulator_GetTimeMicros();
+    report->length = length;
+    memcpy(report->data, buffer, length);
+    endpoint->isBusy = true;
+    return kStatus_USB_Success;
+}
+
+static void pollEndpoints(void)
+{
+    for (uint8_t i = 0; i < SIMULATED_ENDPOINT_COUNT; i++) {
+        simulated_endpoint_t *endpoint = simulatedEndpoints + i;
+        uint8_t pollInterval = Simulator_Config.usbPollIntervalMsec ?: endpoint->descriptorPollIntervalMsec;
+        if (!endpoint->isBusy || CurrentTime % pollInterval) {
+            continue;
+        }
+
+        endpoint->pendingReport.sendTimeMicros = Simulator_GetTimeMicros();
+        if (reportCount < SIMULATOR_MAX_REPORT_COUNT) {
+            reports[reportCount++] = endpoint->pendingReport;
+        } else {
+            Simulator_DroppedReportCount++;
+        }
+
+        endpoint->isBusy = false;
+        endpoint->callback(0, kUSB_DeviceHidEventSendResponse, NULL);
+    }
+}
+
+// I2C model
+
+static void initI2cMainBus(void)
+{
+    i2c_master_config_t masterConfig;
+    I2C_MasterGetDefaultConfig(&masterConfig);
+    masterConfig.baudRate_Bps = I2cMainBusRequestedBaudRateBps;
+    I2C_MasterInit(I2C_MAIN_BUS_BASEADDR, &masterConfig, 0);
+    I2cMainBusActualBaudRateBps = I2C_ActualBaudRate;
+}
+
+// Mirrors PIT_I2C_WATCHDOG_HANDLER() and RecoverI2cMainBus() of the firmware.
+static void runI2cWatchdog(void)
+{
+    I2cWatchdog_WatchCounter++;
+
+    if (I2C_Watchdog == previousI2cWatchdogCounter) {
+        I2cWatchdog_RecoveryCounter++;
+        I2C_MasterTransferAbort(I2C_MAIN_BUS_BASEADDR, &I2cMasterHandle);
+        I2C_MasterDeinit(I2C_MAIN_BUS_BASEADDR);
+        initI2cMainBus();
+        RecoverSlaveScheduler();
+    }
+
+    previousI2cWatchdogCounter = I2C_Watchdog;
+}
+
+static uint32_t getMicrosUntilI2cWatchdog(void)
+{
+    return I2C_WATCHDOG_INTERVAL_USEC - (uint32_t)(VirtualTimer_CurrentTimeMicros % I2C_WATCHDOG_INTERVAL_USEC);
+}
+
+static void initI2cModel(void)
+{
+    VirtualI2cBus_Init();
+
+    VirtualLeftKeyboardHalf_Init();
+    VirtualI2cBus_AddSlave(&VirtualLeftKeyboardHalf_Slave);
+
+    VirtualIs31fl3731_Init(Simulator_LedDrivers + LedDriverId_Right, I2C_ADDRESS_IS31FL3731_RIGHT);
+    VirtualIs31fl3731_Init(Simulator_LedDrivers + LedDriverId_Left, I2C_ADDRESS_IS31FL3731_LEFT);
+    for (uint8_t ledDriverId = 0; ledDriverId <= LedDriverId_Last; ledDriverId++) {
+        VirtualI2cBus_AddSlave(&Simulator_LedDrivers[ledDriverId].slave);
+    }
+
+    I2cWatchdog_WatchCounter = 0;
+    I2cWatchdog_RecoveryCounter = 0;
+    previousI2cWatchdogCounter = I2C_Watchdog;
+
+    memset(UhkModuleStates, 0, sizeof(UhkModuleStates));
+    I2cMainBusRequestedBaudRateBps = Simulator_Config.i2cBaudRateBps ?: I2C_MAIN_BUS_NORMAL_BAUD_RATE;
+    I2cBaudRate_ChangeCount = 0;
+    I2cBaudRate_SetAdaptive(I2cBaudRate_IsAdaptive);
+    initI2cMainBus();
+    InitSlaveScheduler();
+}
+
+// Key events
+
+void Simulator_SetKeyState(uint8_t slotId, uint8_t keyId, bool isPressed)
+{
+    if (slotId == SlotId_RightKeyboardHalf) {
+        if (keyId < RIGHT_KEY_MATRIX_KEY_COUNT) {
+            simulatedRightKeyMatrix.pressedKeys[keyId] = isPressed;
+            updateMatrixInputs(&simulatedRightKeyMatrix);
+        }
+    } else if (slotId == SlotId_LeftKeyboardHalf && Simulator_Config.isI2cBusSimulated) {
+        VirtualLeftKeyboardHalf_SetKeyState(keyId, isPressed);
+    } else if (slotId < SLOT_COUNT && keyId < MAX_KEY_COUNT_PER_MODULE) {
+        // Modules that are not on the virtual I2C bus appear as if they were just polled.
+        if (isPressed) {
+            LeftKeyStates[slotId] |= KEY_STATE_BIT(keyId);
+        } else {
+            LeftKeyStates[slotId] &= ~KEY_STATE_BIT(keyId);
+        }
+        ModuleKeyEvents_Push(slotId, keyId, isPressed, Timer_GetCurrentTimeMicros());
+    }
+}
+
+bool Simulator_ScheduleKeyEvent(uint32_t timeMicros, uint8_t slotId, uint8_t keyId, bool isPressed)
+{
+    if (keyEventCount >= SIMULATOR_MAX_KEY_EVENT_COUNT) {
+        return false;
+    }
+
+    // Keep the queue sorted by time, preserving the insertion order of simultaneous events.
+    uint16_t index = keyEventCount;
+    while (index > 0 && keyEvents[index-1].timeMicros > timeMicros) {
+        keyEvents[index] = keyEvents[index-1];
+        index--;
+    }
+
+    keyEvents[index] = (simulator_key_event_t){
+        .timeMicros = timeMicros,
+        .slotId = slotId,
+        .keyId = keyId,
+        .isPressed = isPressed,
+    };
+    keyEventCount++;
+    return true;
+}
+
+static void applyDueKeyEvents(void)
+{
+    uint32_t now = Simulator_GetTimeMicros();
+    uint16_t dueCount = 0;
+
+    while (dueCount < keyEventCount && keyEvents[dueCount].timeMicros <= now) {
+        simulator_key_event_t *keyEvent = keyEvents + dueCount;
+        Simulator_SetKeyState(keyEvent->slotId, keyEvent->keyId, keyEvent->isPressed);
+        dueCount++;
+    }
+
+    if (dueCount) {
+        keyEventCount -= dueCount;
+        memmove(keyEvents, keyEvents + dueCount, keyEventCount * sizeof(simulator_key_event_t));
+    }
+}
+
+// Main loop
+
+static void runMainLoopIteration(void)
+{
+    UpdateUsbReports();
+}
+
+static uint32_t getMicrosUntilKeyScan(void)
+{
+    return (uint32_t)(nextKeyScanTimeMicros - VirtualTimer_CurrentTimeMicros);
+}
+
+// The key scanner interrupt fires every KeyScanner_RowIntervalUsec regardless of the main loop.
+static void runKeyScanner(void)
+{
+    PIT_KEY_SCANNER_HANDLER();
+    nextKeyScanTimeMicros += KeyScanner_RowIntervalUsec;
+}
+
+static uint32_t getMicrosUntilNextIteration(void)
+{
+    uint32_t tickLength = 1000U * TIMER_INTERVAL_MSEC;
+    uint32_t iterationLength = tickLength / (Simulator_Config.mainLoopIterationsPerTick ?: 1);
+    uint32_t sinceTick = (uint32_t)(VirtualTimer_CurrentTimeMicros % iterationLength);
+    return iterationLength - sinceTick;
+}
+
+void Simulator_AdvanceTimeMicros(uint32_t micros)
+{
+    Simulator_RunUntil(Simulator_GetTimeMicros() + micros);
+}
+
+void Simulator_AdvanceTime(uint32_t msec)
+{
+    Simulator_AdvanceTimeMicros(msec * 1000U);
+}
+
+void Simulator_RunUntil(uint32_t timeMicros)
+{
+    while ((int32_t)(timeMicros - Simulator_GetTimeMicros()) > 0) {
+        uint32_t iterationStep = getMicrosUntilNextIteration();
+        uint32_t step = MIN(iterationStep, timeMicros - Simulator_GetTimeMicros());
+        step = MIN(step, getMicrosUntilKeyScan());
+        if (Simulator_Config.isI2cBusSimulated) {
+            step = MIN(step, VirtualI2cBus_GetMicrosUntilCompletion());
+            step = MIN(step, getMicrosUntilI2cWatchdog());
+        }
+
+        uint32_t previousTime = CurrentTime;
+        VirtualTimer_AdvanceMicros(step);
+        applyDueKeyEvents();
+
+        if (VirtualTimer_CurrentTimeMicros == nextKeyScanTimeMicros) {
+            runKeyScanner();
+        }
+
+        if (Simulator_Config.isI2cBusSimulated) {
+            VirtualI2cBus_Update();
+            if (VirtualTimer_CurrentTimeMicros % I2C_WATCHDOG_INTERVAL_USEC == 0) {
+                runI2cWatchdog();
+            }
+        }
+
+        if (step == iterationStep) {
+            if (CurrentTime != previousTime) {
+                pollEndpoints();
+            }
+            runMainLoopIteration();
+        }
+    }
+}
+
+uint32_t Simulator_GetTimeMicros(void)
+{
+    return Timer_GetCurrentTimeMicros();
+}
+
+// Reports
+
+uint16_t Simulator_GetReportCount(void)
+{
+    return reportCount;
+}
+
+const simulator_report_t *Simulator_GetReport(uint16_t index)
+{
+    return index < reportCount ? reports + index : NULL;
+}
+
+void Simulator_ClearReports(void)
+{
+    reportCount = 0;
+    Simulator_DroppedReportCount = 0;
+}
+
+// Setup
+
+bool Simulator_LoadUserConfig(const uint8_t *config, uint16_t length)
+{
+    if (length > USER_CONFIG_SIZE) {
+        return false;
+    }
+
+    memcpy(StagingUserConfigBuffer.buffer, config, length);
+    ParserRunDry = true;
+    StagingUserConfigBuffer.offset = 0;
+    if (ParseConfig(&StagingUserConfigBuffer) != ParserError_Success) {
+        return false;
+    }
+
+    memcpy(ValidatedUserConfigBuffer.buffer, config, length);
+    ParserRunDry = false;
+    ValidatedUserConfigBuffer.offset = 0;
+    if (ParseConfig(&ValidatedUserConfigBuffer) != ParserError_Success) {
+        return false;
+    }
+
+    SwitchKeymapById(DefaultKeymapIndex);
+    return true;
+}
+
+void Simulator_Init(void)
+{
+    VirtualTimer_Reset();
+    PROFILER_INIT();
+    SleepModeActive = false;
+    UsbCompositeDevice.attach = Simulator_Config.isUsbAttached;
+
+    for (uint8_t i = 0; i < SIMULATED_ENDPOINT_COUNT; i++) {
+        simulatedEndpoints[i].isBusy = false;
+    }
+
+    memset(simulatedRightKeyMatrix.pressedKeys, 0, sizeof(simulatedRightKeyMatrix.pressedKeys));
+    InitKeyScanner();
+    updateMatrixInputs(&simulatedRightKeyMatrix);
+    nextKeyScanTimeMicros = KeyScanner_RowIntervalUsec;
+
+    keyEventCount = 0;
+    Simulator_ClearReports();
+    memset(ModuleKeyEventQueues, 0, sizeof(ModuleKeyEventQueues));
+
+    if (Simulator_Config.isI2cBusSimulated) {
+        initI2cModel();
+    } else {
+        // Modules that are not on the virtual I2C bus are as good as connected, so their key states aren't held back.
+        memset(UhkModuleStates, 0, sizeof(UhkModuleStates));
+        for (uint8_t uhkModuleDriverId = 0; uhkModuleDriverId < UHK_MODULE_MAX_COUNT; uhkModuleDriverId++) {
+            UhkModuleStates[uhkModuleDriverId].isIdentityVerified = true;
+        }
+    }
+}
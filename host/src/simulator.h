@@ -0,0 +1,74 @@
+#ifndef __SIMULATOR_H__
+#define __SIMULATOR_H__
+
+// Includes:
+
+    #include <stdint.h>
+    #include <stdbool.h>
+    #include "slot.h"
+    #include "module.h"
+    #include "slave_drivers/is31fl3731_driver.h"
+    #include "virtual_is31fl3731.h"
+
+// Macros:
+
+    #define SIMULATOR_MAX_REPORT_COUNT 4096
+    #define SIMULATOR_MAX_REPORT_LENGTH 8
+    #define SIMULATOR_MAX_KEY_EVENT_COUNT 1024
+
+// Typedefs:
+
+    typedef enum {
+        SimulatorReportType_BasicKeyboard,
+        SimulatorReportType_MediaKeyboard,
+        SimulatorReportType_SystemKeyboard,
+        SimulatorReportType_Mouse,
+    } simulator_report_type_t;
+
+    typedef struct {
+        simulator_report_type_t type;
+        uint32_t queueTimeMicros;  // When UsbXAction() handed the report to the USB stack
+        uint32_t sendTimeMicros;   // When the host polled the endpoint and received the report
+        uint8_t length;
+        uint8_t data[SIMULATOR_MAX_REPORT_LENGTH];
+    } simulator_report_t;
+
+    typedef struct {
+        uint32_t timeMicros;
+        uint8_t slotId;
+        uint8_t keyId;
+        bool isPressed;
+    } simulator_key_event_t;
+
+    typedef struct {
+        uint8_t mainLoopIterationsPerTick;  // How many times __WFI() returns per 1 ms timer tick
+        uint8_t usbPollIntervalMsec;        // 0 means the bInterval of the endpoint descriptors
+        bool isUsbAttached;
+        bool isI2cBusSimulated;             // Run the slave scheduler against the virtual I2C bus
+        uint32_t i2cBaudRateBps;            // 0 means I2C_MAIN_BUS_NORMAL_BAUD_RATE
+    } simulator_config_t;
+
+// Variables:
+
+    extern simulator_config_t Simulator_Config;
+    extern uint32_t Simulator_DroppedReportCount;
+    extern virtual_is31fl3731_t Simulator_LedDrivers[LED_DRIVER_MAX_COUNT];
+
+// Functions:
+
+    void Simulator_Init(void);
+    bool Simulator_LoadUserConfig(const uint8_t *config, uint16_t length);
+
+    void Simulator_SetKeyState(uint8_t slotId, uint8_t keyId, bool isPressed);
+    bool Simulator_ScheduleKeyEvent(uint32_t timeMicros, uint8_t slotId, uint8_t keyId, bool isPressed);
+
+    void Simulator_AdvanceTimeMicros(uint32_t micros);
+    void Simulator_AdvanceTime(uint32_t msec);
+    void Simulator_RunUntil(uint32_t timeMicros);
+    uint32_t Simulator_GetTimeMicros(void);
+
+    uint16_t Simulator_GetReportCount(void);
+    const simulator_report_t *Simulator_GetReport(uint16_t index);
+    void Simulator_ClearReports(void);
+
+#endif
@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "crc16.h"
+
+// Checks that the table driven implementations of crc16_update() produce the same CRC as the bitwise one over
+// random messages, also when a message is fed in two parts, and measures how long each of them takes per byte
+// for short slave protocol messages and for full length ones. The hardware CRC unit of the right half can't be
+// exercised on the host.
+
+#define MESSAGE_COUNT 4096
+#define ITERATION_COUNT 2000
+#define SHORT_MESSAGE_MAX_LENGTH 8
+
+typedef uint16_t (crc16_update_t)(uint16_t crc, const uint8_t *src, uint32_t lengthInBytes);
+
+static const struct {
+    const char *name;
+    crc16_update_t *update;
+} implementations[] = {
+    {"bitwise", crc16_update_bitwise},
+    {"nibble table", crc16_update_nibble_table},
+    {"byte table", crc16_update_byte_table},
+};
+
+static uint8_t messages[MESSAGE_COUNT][I2C_MESSAGE_MAX_PAYLOAD_LENGTH];
+static uint8_t messageLengths[MESSAGE_COUNT];
+
+static double getElapsedNanoseconds(struct timespec *start, struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+static void generateMessages(uint8_t maxLength)
+{
+    for (uint16_t i = 0; i < MESSAGE_COUNT; i++) {
+        messageLengths[i] = 1 + rand() % maxLength;
+        for (uint8_t j = 0; j < messageLengths[i]; j++) {
+            messages[i][j] = rand();
+        }
+    }
+}
+
+static uint32_t checkEquivalence(crc16_update_t *update)
+{
+    uint32_t mismatchCount = 0;
+    for (uint16_t i = 0; i < MESSAGE_COUNT; i++) {
+        uint8_t length = messageLengths[i];
+        uint8_t splitLength = rand() % (length + 1);
+        uint16_t expectedCrc = crc16_update_bitwise(0, messages[i], length);
+        uint16_t splitCrc = update(update(0, messages[i], splitLength), messages[i] + splitLength, length - splitLength);
+        if (update(0, messages[i], length) != expectedCrc || splitCrc != expectedCrc) {
+            mismatchCount++;
+        }
+    }
+    return mismatchCount;
+}
+
+// Returns the average nanoseconds per byte over every message.
+static double measure(crc16_update_t *update, uint16_t *checksum)
+{
+    struct timespec start, end;
+    uint64_t byteCount = 0;
+    uint16_t sum = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t iteration = 0; iteration < ITERATION_COUNT; iteration++) {
+        for (uint16_t i = 0; i < MESSAGE_COUNT; i++) {
+            sum += update(0, messages[i], messageLengths[i]);
+            byteCount += messageLengths[i];
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    *checksum = sum;
+    return getElapsedNanoseconds(&start, &end) / byteCount;
+}
+
+static bool runBenchmark(const char *name, uint8_t maxLength)
+{
+    bool isSuccess = true;
+    double bitwiseNanoseconds = 0;
+
+    generateMessages(maxLength);
+    printf("%s messages of 1 to %u bytes\n", name, maxLength);
+    for (uint8_t i = 0; i < sizeof(implementations) / sizeof(implementations[0]); i++) {
+        uint16_t checksum;
+        uint32_t mismatchCount = checkEquivalence(implementations[i].update);
+        double nanoseconds = measure(implementations[i].update, &checksum);
+        if (i == 0) {
+            bitwiseNanoseconds = nanoseconds;
+        }
+        printf("    %-12s  %6.3f ns/byte  %5.2fx  checksum %04x  %s\n", implementations[i].name, nanoseconds,
+            bitwiseNanoseconds / nanoseconds, checksum, mismatchCount ? "MISMATCH" : "ok");
+        isSuccess &= !mismatchCount;
+    }
+    return isSuccess;
+}
+
+int main(void)
+{
+    static const uint8_t checkString[] = "123456789";
+    crc16_data_t crc16Data;
+    uint16_t checkValue;
+
+    crc16_init(&crc16Data);
+    crc16_update(&crc16Data, checkString, sizeof(checkString) - 1);
+    crc16_finalize(&crc16Data, &checkValue);
+    printf("crc16_update(\"123456789\") = %04x, expected 31c3  %s\n", checkValue, checkValue == 0x31c3 ? "ok" : "MISMATCH");
+
+    srand(1);
+    bool isSuccess = checkValue == 0x31c3;
+    isSuccess &= runBenchmark("short", SHORT_MESSAGE_MAX_LENGTH);
+    isSuccess &= runBenchmark("long", I2C_MESSAGE_MAX_PAYLOAD_LENGTH);
+    return isSuccess ? 0 : 1;
+}
@@ -0,0 +1,253 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "simulator.h"
+#include "keymap.h"
+#include "debounce.h"
+#include "right_key_matrix.h"
+#include "usb_interfaces/usb_interface_basic_keyboard.h"
+
+// Feeds synthetic bounce traces of a key of the right keyboard half through every debounce strategy, with a
+// fixed and with an adaptive debounce time, and reports the delay from the first contact of a press and the
+// first break of a release to the USB report that reflects it, the number of spurious transitions, the number
+// of edges that never got reported and the debounce time of the key at the end. Only the clean trace is
+// expected to go through every strategy unscathed, and no adaptive strategy may let more spurious transitions
+// through than the same strategy with the fixed debounce time, which determines the exit status.
+//
+// Usage: debounce_benchmark [debounceTimeMsec]
+
+#define CYCLE_COUNT 40
+#define SETTLE_MSEC 300
+#define HOLD_MSEC 400
+#define IDLE_MSEC 400
+#define NOISE_WINDOW_MSEC 100  // Glitches and spikes only occur this long after the bouncing, so that even the
+                               // longest debounce time settles before the next edge
+
+typedef struct {
+    const char *name;
+    uint16_t pressBounceUsec;    // The contacts chatter this long after the first contact
+    uint16_t releaseBounceUsec;  // The contacts chatter this long after the first break
+    uint8_t holdGlitchCount;     // Short breaks while the key is held
+    uint8_t idleSpikeCount;      // Short contacts while the key is released, like ESD or crosstalk
+} bounce_trace_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t max;
+    uint64_t sum;
+} latency_stats_t;
+
+typedef struct {
+    latency_stats_t press;
+    latency_stats_t release;
+    uint32_t spuriousCount;
+    uint32_t missingCount;
+} trace_result_t;
+
+static const bounce_trace_t traces[] = {
+    {"clean",   0,     0,     0, 0},
+    {"bouncy",  5000,  8000,  0, 0},
+    {"worn",    15000, 20000, 0, 0},
+    {"glitchy", 3000,  3000,  3, 0},
+    {"noisy",   3000,  3000,  0, 3},
+};
+
+static const struct {
+    debounce_strategy_t strategy;
+    bool isAdaptive;
+    const char *name;
+} strategies[] = {
+    {DebounceStrategy_Eager, false, "eager"},
+    {DebounceStrategy_Deferred, false, "deferred"},
+    {DebounceStrategy_Integrator, false, "integrator"},
+    {DebounceStrategy_Eager, true, "adaptive eager"},
+    {DebounceStrategy_Deferred, true, "adaptive deferred"},
+    {DebounceStrategy_Integrator, true, "adaptive integrator"},
+};
+
+static uint8_t keyId;
+static uint8_t scancode;
+
+static void addSample(latency_stats_t *stats, uint32_t micros)
+{
+    if (micros > stats->max) {
+        stats->max = micros;
+    }
+    stats->sum += micros;
+    stats->count++;
+}
+
+static double getAverageMsec(latency_stats_t *stats)
+{
+    return stats->count ? (double)stats->sum / stats->count / 1000.0 : 0;
+}
+
+static uint32_t getRandomMicros(uint32_t min, uint32_t max)
+{
+    return min + rand() % (max - min + 1);
+}
+
+static bool containsScancode(const simulator_report_t *report)
+{
+    const usb_basic_keyboard_report_t *basicReport = (const usb_basic_keyboard_report_t*)report->data;
+    for (uint8_t i = 0; i < USB_BASIC_KEYBOARD_MAX_KEYS; i++) {
+        if (basicReport->scancodes[i] == scancode) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Schedules contact chatter that starts with isPressed at startMicros and settles at isPressed within
+// bounceMicros.
+static void scheduleBounces(uint32_t startMicros, uint32_t bounceMicros, bool isPressed)
+{
+    Simulator_ScheduleKeyEvent(startMicros, SlotId_RightKeyboardHalf, keyId, isPressed);
+    uint32_t time = startMicros;
+    bool state = isPressed;
+    while (true) {
+        time += getRandomMicros(100, 1500);
+        if (time >= startMicros + bounceMicros) {
+            break;
+        }
+        state = !state;
+        Simulator_ScheduleKeyEvent(time, SlotId_RightKeyboardHalf, keyId, state);
+    }
+    if (state != isPressed) {
+        Simulator_ScheduleKeyEvent(startMicros + bounceMicros, SlotId_RightKeyboardHalf, keyId, isPressed);
+    }
+}
+
+// Schedules count short pulses of !isPressed within the window.
+static void schedulePulses(uint32_t startMicros, uint32_t windowMicros, uint8_t count, bool isPressed)
+{
+    for (uint8_t i = 0; i < count; i++) {
+        uint32_t slotMicros = windowMicros / count;
+        uint32_t pulseStart = startMicros + i * slotMicros + getRandomMicros(0, slotMicros - 1000);
+        Simulator_ScheduleKeyEvent(pulseStart, SlotId_RightKeyboardHalf, keyId, !isPressed);
+        Simulator_ScheduleKeyEvent(pulseStart + getRandomMicros(200, 800), SlotId_RightKeyboardHalf, keyId, isPressed);
+    }
+}
+
+static void runCycle(const bounce_trace_t *trace, trace_result_t *result)
+{
+    uint32_t pressTime = Simulator_GetTimeMicros() + 1000;
+    uint32_t holdStart = pressTime + trace->pressBounceUsec + 5000;
+    uint32_t releaseTime = pressTime + HOLD_MSEC * 1000;
+    uint32_t idleStart = releaseTime + trace->releaseBounceUsec + 5000;
+    uint32_t endTime = releaseTime + IDLE_MSEC * 1000;
+
+    Simulator_ClearReports();
+    scheduleBounces(pressTime, trace->pressBounceUsec, true);
+    schedulePulses(holdStart, NOISE_WINDOW_MSEC * 1000, trace->holdGlitchCount, true);
+    scheduleBounces(releaseTime, trace->releaseBounceUsec, false);
+    schedulePulses(idleStart, NOISE_WINDOW_MSEC * 1000, trace->idleSpikeCount, false);
+    Simulator_RunUntil(endTime);
+
+    uint32_t pressReportTime = 0;
+    uint32_t releaseReportTime = 0;
+    uint8_t transitionCount = 0;
+    bool isReported = false;
+    for (uint16_t i = 0; i < Simulator_GetReportCount(); i++) {
+        const simulator_report_t *report = Simulator_GetReport(i);
+        if (report->type != SimulatorReportType_BasicKeyboard || containsScancode(report) == isReported) {
+            continue;
+        }
+        isReported = !isReported;
+        transitionCount++;
+        if (isReported && !pressReportTime) {
+            pressReportTime = report->sendTimeMicros;
+        }
+        if (!isReported && !releaseReportTime && report->queueTimeMicros >= releaseTime) {
+            releaseReportTime = report->sendTimeMicros;
+        }
+    }
+
+    if (pressReportTime) {
+        addSample(&result->press, pressReportTime - pressTime);
+    } else {
+        result->missingCount++;
+    }
+    if (releaseReportTime) {
+        addSample(&result->release, releaseReportTime - releaseTime);
+    } else {
+        result->missingCount++;
+    }
+    if (transitionCount > 2) {
+        result->spuriousCount += transitionCount - 2;
+    }
+}
+
+static trace_result_t runTrace(const bounce_trace_t *trace, debounce_strategy_t strategy, bool isAdaptive,
+    const char *strategyName)
+{
+    trace_result_t result = {0};
+
+    DebounceStrategy = strategy;
+    DebounceAdaptive = isAdaptive;
+    Debounce_ResetKeyStats();
+    Simulator_Init();
+    Simulator_AdvanceTime(SETTLE_MSEC);
+
+    srand(1);
+    for (uint8_t i = 0; i < CYCLE_COUNT; i++) {
+        runCycle(trace, &result);
+    }
+
+    printf("%-8s %-19s  %6.3f / %6.3f  %6.3f / %6.3f  %8u  %7u  %8u\n", trace->name, strategyName,
+        getAverageMsec(&result.press), result.press.max / 1000.0,
+        getAverageMsec(&result.release), result.release.max / 1000.0,
+        result.spuriousCount, result.missingCount,
+        isAdaptive ? DebounceKeyStats[SlotId_RightKeyboardHalf][keyId].debounceTime : DebounceTimePress);
+
+    return result;
+}
+
+static bool findKey(void)
+{
+    for (keyId = 0; keyId < RIGHT_KEY_MATRIX_KEY_COUNT; keyId++) {
+        key_action_t *action = &CurrentKeymap[LayerId_Base][SlotId_RightKeyboardHalf][keyId];
+        if (action->type == KeyActionType_Keystroke && action->keystroke.keystrokeType == KeystrokeType_Basic &&
+            action->keystroke.scancode && !action->keystroke.secondaryRole && !action->keystroke.modifiers) {
+            scancode = action->keystroke.scancode;
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1) {
+        DebounceTimePress = DebounceTimeRelease = atoi(argv[1]);
+        DebounceAdaptiveMaxTime = MAX(DebounceAdaptiveMaxTime, DebounceTimePress);
+    }
+
+    if (!findKey()) {
+        fprintf(stderr, "no basic keystroke on the base layer of the right keyboard half\n");
+        return 1;
+    }
+
+    printf("debounce time %u ms, %u cycles per trace\n", DebounceTimePress, CYCLE_COUNT);
+    printf("trace    strategy             press avg/max ms  release avg/max ms  spurious  missing  final ms\n");
+
+    bool isSuccess = true;
+    for (uint8_t traceId = 0; traceId < sizeof(traces) / sizeof(traces[0]); traceId++) {
+        uint32_t fixedSpuriousCounts[DebounceStrategy_Last + 1] = {0};
+        for (uint8_t i = 0; i < sizeof(strategies) / sizeof(strategies[0]); i++) {
+            trace_result_t result = runTrace(traces + traceId, strategies[i].strategy, strategies[i].isAdaptive,
+                strategies[i].name);
+            if (traceId == 0 && (result.spuriousCount || result.missingCount)) {
+                isSuccess = false;
+            }
+            if (!strategies[i].isAdaptive) {
+                fixedSpuriousCounts[strategies[i].strategy] = result.spuriousCount;
+            } else if (result.spuriousCount > fixedSpuriousCounts[strategies[i].strategy]) {
+                printf("%-8s %-19s  more spurious transitions than with the fixed debounce time\n", traces[traceId].name,
+                    strategies[i].name);
+                isSuccess = false;
+            }
+        }
+    }
+
+    return isSuccess ? 0 : 1;
+}
@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "simulator.h"
+#include "virtual_timer.h"
+#include "virtual_i2c_bus.h"
+#include "virtual_left_keyboard_half.h"
+#include "i2c_watchdog.h"
+#include "i2c_baud_rate.h"
+#include "init_peripherals.h"
+
+// Runs the slave scheduler with the adaptive baud rate of right/src/i2c_baud_rate.c against virtual buses that
+// NAK above various baud rates, like cables of various lengths would, and reports the baud rate that the
+// controller settles on, how long that took, how many times it raised and backed off the rate, and the polls
+// per second of the left keyboard half and the NAKs of the connected slaves at the end. The controller is
+// expected to settle on the highest step that the bus can take, which determines the exit status.
+//
+// Usage: i2c_baud_rate_benchmark [overspeedNakPerMille]
+
+#define RUN_SEC 120
+#define MEASURE_SEC 10
+#define START_BAUD_RATE 100000
+
+static const uint32_t baudRateSteps[] = {50000, 100000, 150000, 200000, 300000, 400000};
+static const uint32_t maxReliableBaudRates[] = {0, 350000, 250000, 175000, 120000, 75000};
+
+static uint16_t overspeedNakPerMille = 50;
+
+static uint32_t getExpectedBaudRate(uint32_t maxReliableBaudRateBps)
+{
+    uint32_t expectedBaudRateBps = baudRateSteps[0];
+    for (uint8_t i = 0; i < sizeof(baudRateSteps) / sizeof(baudRateSteps[0]); i++) {
+        if (!maxReliableBaudRateBps || baudRateSteps[i] <= maxReliableBaudRateBps) {
+            expectedBaudRateBps = baudRateSteps[i];
+        }
+    }
+    return expectedBaudRateBps;
+}
+
+static bool runBenchmark(uint32_t maxReliableBaudRateBps)
+{
+    VirtualI2cBus_Config.maxReliableBaudRateBps = maxReliableBaudRateBps;
+    VirtualI2cBus_Config.overspeedNakPerMille = overspeedNakPerMille;
+    Simulator_Config.isI2cBusSimulated = true;
+    Simulator_Config.i2cBaudRateBps = START_BAUD_RATE;
+    I2cBaudRate_IsAdaptive = true;
+    Simulator_Init();
+
+    Simulator_AdvanceTime((RUN_SEC - MEASURE_SEC) * 1000);
+    virtual_i2c_bus_stats_t startStats = VirtualI2cBus_Stats;
+    uint32_t startPollCount = VirtualLeftKeyboardHalf_State.txMessageCount;
+    uint32_t startRecoveryCount = I2cWatchdog_RecoveryCounter;
+    uint16_t startChangeCount = I2cBaudRate_ChangeCount;
+    Simulator_AdvanceTime(MEASURE_SEC * 1000);
+
+    uint16_t raiseCount = 0;
+    uint16_t backOffCount = 0;
+    uint32_t settleTime = 0;
+    for (uint16_t i = 0; i < MIN(I2cBaudRate_ChangeCount, I2C_BAUD_RATE_HISTORY_LENGTH); i++) {
+        i2c_baud_rate_change_t *change = I2cBaudRate_History + (I2cBaudRate_ChangeCount - 1 - i) % I2C_BAUD_RATE_HISTORY_LENGTH;
+        raiseCount += change->reason == I2cBaudRateChangeReason_Raise;
+        backOffCount += change->reason == I2cBaudRateChangeReason_BackOff;
+        if (change->baudRateBps == I2cMainBusRequestedBaudRateBps && !settleTime) {
+            settleTime = change->time;
+        }
+    }
+
+    uint32_t expectedBaudRateBps = getExpectedBaudRate(maxReliableBaudRateBps);
+    bool isSuccess = I2cMainBusRequestedBaudRateBps == expectedBaudRateBps &&
+        I2cBaudRate_ChangeCount == startChangeCount;
+    printf("%8u  %8u  %8u  %9.2f  %5u  %7u  %7.0f  %5u  %5u  %s\n",
+        maxReliableBaudRateBps, expectedBaudRateBps, I2cMainBusRequestedBaudRateBps, settleTime / 1000.0,
+        raiseCount, backOffCount,
+        (VirtualLeftKeyboardHalf_State.txMessageCount - startPollCount) / (double)MEASURE_SEC,
+        VirtualI2cBus_Stats.nakCount - startStats.nakCount,
+        I2cWatchdog_RecoveryCounter - startRecoveryCount,
+        isSuccess ? "ok" : "UNEXPECTED");
+    return isSuccess;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1) {
+        overspeedNakPerMille = atoi(argv[1]);
+    }
+
+    printf("starting at %u bps, %u per mille NAKs above the reliable baud rate, the last %u of %u s measured\n",
+        START_BAUD_RATE, overspeedNakPerMille, MEASURE_SEC, RUN_SEC);
+    printf("reliable  expected     final  settled s  raise  backoff  polls/s    nak  rcvr\n");
+
+    bool isSuccess = true;
+    for (uint8_t i = 0; i < sizeof(maxReliableBaudRates) / sizeof(maxReliableBaudRates[0]); i++) {
+        isSuccess &= runBenchmark(maxReliableBaudRates[i]);
+    }
+    return isSuccess ? 0 : 1;
+}
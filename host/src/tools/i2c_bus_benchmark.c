@@ -0,0 +1,293 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "simulator.h"
+#include "virtual_timer.h"
+#include "virtual_i2c_bus.h"
+#include "virtual_left_keyboard_half.h"
+#include "key_states.h"
+#include "module_key_events.h"
+#include "i2c_watchdog.h"
+#include "slave_scheduler.h"
+#include "i2c_error_logger.h"
+#include "slave_drivers/uhk_module_driver.h"
+#include "slave_drivers/is31fl3731_driver.h"
+
+// Runs the slave scheduler against the virtual I2C bus at various baud rates and reports how old the key states of
+// the left keyboard half are by the time they land in LeftKeyStates, how far the scan time of the queued key events
+// is off, the longest time between two polls of the left keyboard half, how long a change of LedDriverIntensities
+// takes to reach the PWM registers of the right LED driver and how many PWM register bytes per second the LED
+// drivers got according to the LED telemetry of the firmware, how busy the bus is, and how saturated it is according
+// to the bus meter of the firmware, which leaves out the polls that only ran ahead of their deadline because the bus
+// would have gone idle otherwise. Then every LED of the right LED driver is changed at once, and the time until the
+// change is displayed is reported along with the most displayed states that a change went through, which is 1 unless
+// a change tears. Finally, the left keyboard half gets disconnected and reconnected along with a key press, and the
+// time from the reconnection to the key state is reported.
+//
+// Usage: i2c_bus_benchmark [-n nakPerMille] [-t timeoutPerMille] [-r] [baudRateBps...]
+//
+// NAKs and timeouts are injected into the left keyboard half and the LED drivers, or with -r only into the LED
+// drivers, which then stand in for a flaky add-on.
+
+#define SETTLE_MSEC 1000
+#define EVENT_GAP_MSEC 20
+#define EVENT_TIMEOUT_MSEC 1000
+#define POLL_STEP_USEC 10
+#define LED_SAMPLE_COUNT 32
+#define FRAME_SAMPLE_COUNT 8
+#define RECONNECT_COUNT 16
+#define DISCONNECT_MSEC 50
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+} latency_stats_t;
+
+static uint16_t nakPerMille;
+static uint16_t timeoutPerMille;
+static bool isLeftKeyboardHalfReliable;
+
+static void addSample(latency_stats_t *stats, uint32_t micros)
+{
+    if (stats->count == 0 || micros < stats->min) {
+        stats->min = micros;
+    }
+    if (micros > stats->max) {
+        stats->max = micros;
+    }
+    stats->sum += micros;
+    stats->count++;
+}
+
+static double getAverageMsec(latency_stats_t *stats)
+{
+    return stats->count ? (double)stats->sum / stats->count / 1000.0 : 0;
+}
+
+// Advances the simulation in small steps until isDone() returns true and returns the elapsed time, or
+// UINT32_MAX if it didn't happen within EVENT_TIMEOUT_MSEC.
+static uint32_t waitFor(bool (*isDone)(uint8_t index, uint8_t value), uint8_t index, uint8_t value)
+{
+    uint32_t startTime = Simulator_GetTimeMicros();
+    while (!isDone(index, value)) {
+        if (Simulator_GetTimeMicros() - startTime >= EVENT_TIMEOUT_MSEC * 1000U) {
+            return UINT32_MAX;
+        }
+        Simulator_AdvanceTimeMicros(POLL_STEP_USEC);
+    }
+    return Simulator_GetTimeMicros() - startTime;
+}
+
+// The key states only count once UpdateUsbReports() takes them, after the identity of the module got verified.
+static bool isLeftKeyStateUpdated(uint8_t keyId, uint8_t isPressed)
+{
+    return UhkModuleStates[UhkModuleDriverId_LeftKeyboardHalf].isIdentityVerified &&
+        !!(LeftKeyStates[SlotId_LeftKeyboardHalf] & KEY_STATE_BIT(keyId)) == isPressed;
+}
+
+// Returns how far the scan time of the newest queued key event of the left keyboard half is from eventTime.
+static uint32_t getEventTimeError(uint32_t eventTime)
+{
+    module_key_event_queue_t *queue = ModuleKeyEventQueues + SlotId_LeftKeyboardHalf;
+    uint8_t newestEventId = (queue->head + MODULE_KEY_EVENT_QUEUE_LENGTH - 1) % MODULE_KEY_EVENT_QUEUE_LENGTH;
+    int32_t error = queue->events[newestEventId].timeMicros - eventTime;
+    return abs(error);
+}
+
+static bool isLedValueUpdated(uint8_t ledIndex, uint8_t value)
+{
+    return VirtualIs31fl3731_GetPwmValues(Simulator_LedDrivers + LedDriverId_Right)[ledIndex] == value;
+}
+
+static bool isLedFrameUpdated(uint8_t unused1, uint8_t unused2)
+{
+    const uint8_t *pwmValues = VirtualIs31fl3731_GetPwmValues(Simulator_LedDrivers + LedDriverId_Right);
+    for (uint8_t ledIndex = 0; ledIndex < LED_DRIVER_LED_COUNT; ledIndex++) {
+        if (pwmValues[ledIndex] != LedDriverValues[LedDriverId_Right][ledIndex]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void injectFaults(virtual_i2c_slave_t *slave)
+{
+    slave->nakPerMille = nakPerMille;
+    slave->timeoutPerMille = timeoutPerMille;
+}
+
+static bool runBenchmark(uint32_t baudRate)
+{
+    latency_stats_t keyStats = {0};
+    latency_stats_t eventTimeStats = {0};
+    latency_stats_t ledStats = {0};
+    latency_stats_t frameStats = {0};
+    uint32_t maxFrameStepCount = 0;
+    latency_stats_t reconnectStats = {0};
+    uint32_t missingCount = 0;
+
+    Simulator_Config.isI2cBusSimulated = true;
+    Simulator_Config.i2cBaudRateBps = baudRate;
+    Simulator_Init();
+    Simulator_AdvanceTime(SETTLE_MSEC);
+
+    uint8_t keyCount = UhkModuleStates[UhkModuleDriverId_LeftKeyboardHalf].keyCount;
+    if (!keyCount) {
+        printf("%7u  left keyboard half didn't connect\n", baudRate);
+        return false;
+    }
+
+    if (!isLeftKeyboardHalfReliable) {
+        injectFaults(&VirtualLeftKeyboardHalf_Slave);
+    }
+    for (uint8_t ledDriverId = 0; ledDriverId <= LedDriverId_Last; ledDriverId++) {
+        injectFaults(&Simulator_LedDrivers[ledDriverId].slave);
+    }
+
+    virtual_i2c_bus_stats_t startStats = VirtualI2cBus_Stats;
+    uint32_t startPollCount = VirtualLeftKeyboardHalf_State.txMessageCount;
+    uint32_t startRecoveryCount = I2cWatchdog_RecoveryCounter;
+    uint64_t startMicros = VirtualTimer_CurrentTimeMicros;
+    Slaves[SlaveId_LeftKeyboardHalf].maxPollIntervalUsec = 0;
+    ResetI2cTelemetry();
+    LedSlaveDriver_ResetTelemetry();
+
+    // Key events are spread over the scheduler cycle by the odd gap between them.
+    for (uint8_t keyId = 0; keyId < keyCount; keyId++) {
+        for (uint8_t i = 0; i < 2; i++) {
+            bool isPressed = i == 0;
+            uint32_t eventTime = Simulator_GetTimeMicros();
+            VirtualLeftKeyboardHalf_SetKeyState(keyId, isPressed);
+            uint32_t age = waitFor(isLeftKeyStateUpdated, keyId, isPressed);
+            if (age == UINT32_MAX) {
+                missingCount++;
+            } else {
+                addSample(&keyStats, age);
+                addSample(&eventTimeStats, getEventTimeError(eventTime));
+            }
+            Simulator_AdvanceTimeMicros(EVENT_GAP_MSEC * 1000U + 137U * keyId);
+        }
+    }
+
+    for (uint8_t i = 0; i < LED_SAMPLE_COUNT; i++) {
+        uint8_t ledIndex = (i * 37) % LED_DRIVER_LED_COUNT;
+        while (!LedSlaveDriver_IsLedEnabled(LedDriverId_Right, ledIndex)) {
+            ledIndex = (ledIndex + 1) % LED_DRIVER_LED_COUNT;
+        }
+        uint8_t intensity = LedDriverIntensities[LedDriverId_Right][ledIndex] ^ 0x80;
+        LedSlaveDriver_SetLedIntensity(LedDriverId_Right, ledIndex, intensity);
+        uint32_t lag = waitFor(isLedValueUpdated, ledIndex, LedDriverValues[LedDriverId_Right][ledIndex]);
+        if (lag == UINT32_MAX) {
+            missingCount++;
+        } else {
+            addSample(&ledStats, lag);
+        }
+        Simulator_AdvanceTimeMicros(EVENT_GAP_MSEC * 1000U + 211U * i);
+    }
+
+    double seconds = (VirtualTimer_CurrentTimeMicros - startMicros) / 1e6;
+    uint64_t busyMicros = VirtualI2cBus_Stats.busyMicros - startStats.busyMicros;
+    virtual_i2c_bus_stats_t endStats = VirtualI2cBus_Stats;
+    uint32_t pollCount = VirtualLeftKeyboardHalf_State.txMessageCount - startPollCount;
+    uint32_t recoveryCount = I2cWatchdog_RecoveryCounter - startRecoveryCount;
+    uint32_t maxPollIntervalUsec = Slaves[SlaveId_LeftKeyboardHalf].maxPollIntervalUsec;
+    uint32_t meteredUsec = I2cBusTelemetry.busyUsec - I2cBusTelemetry.spareUsec;
+    double saturation = meteredUsec / (double)(Simulator_GetTimeMicros() - I2cBusTelemetry.startMicros);
+    uint32_t ledByteCount = 0;
+    for (uint8_t ledDriverId = 0; ledDriverId <= LedDriverId_Last; ledDriverId++) {
+        ledByteCount += LedDriverTelemetry.pwmByteCount[ledDriverId];
+    }
+    double ledBytesPerSecond = ledByteCount / ((Simulator_GetTimeMicros() - LedDriverTelemetry.startMicros) / 1e6);
+
+    for (uint8_t i = 0; i < FRAME_SAMPLE_COUNT; i++) {
+        uint32_t startVisibleChangeCount = Simulator_LedDrivers[LedDriverId_Right].visibleChangeCount;
+        LedSlaveDriver_SetLedIntensities(LedDriverId_Right, 0x40 + 0x10 * i);
+        uint32_t lag = waitFor(isLedFrameUpdated, 0, 0);
+        if (lag == UINT32_MAX) {
+            missingCount++;
+        } else {
+            addSample(&frameStats, lag);
+            maxFrameStepCount = MAX(maxFrameStepCount,
+                Simulator_LedDrivers[LedDriverId_Right].visibleChangeCount - startVisibleChangeCount);
+        }
+        Simulator_AdvanceTimeMicros(EVENT_GAP_MSEC * 1000U);
+    }
+
+    for (uint8_t i = 0; i < RECONNECT_COUNT; i++) {
+        uint8_t keyId = (i * 7) % keyCount;
+        VirtualLeftKeyboardHalf_Slave.isConnected = false;
+        Simulator_AdvanceTimeMicros(DISCONNECT_MSEC * 1000U + 173U * i);
+        VirtualLeftKeyboardHalf_Slave.isConnected = true;
+        VirtualLeftKeyboardHalf_SetKeyState(keyId, true);
+        uint32_t lag = waitFor(isLeftKeyStateUpdated, keyId, true);
+        if (lag == UINT32_MAX) {
+            missingCount++;
+        } else {
+            addSample(&reconnectStats, lag);
+        }
+        VirtualLeftKeyboardHalf_SetKeyState(keyId, false);
+        Simulator_AdvanceTimeMicros(EVENT_GAP_MSEC * 1000U);
+    }
+
+    printf("%7u  %5.1f%%  %5.1f%%  %7.0f  %7.0f  %7.0f  %6.3f / %6.3f  %6.3f / %6.3f  %6.3f  %6.3f / %6.3f  %7.1f  %6.3f / %6.3f  %5u  %6.3f / %6.3f  %5u %5u %5u %5u\n",
+        baudRate,
+        busyMicros / (seconds * 1e4),
+        saturation * 100,
+        (endStats.transferCount - startStats.transferCount) / seconds,
+        (endStats.byteCount - startStats.byteCount) / seconds,
+        pollCount / seconds,
+        getAverageMsec(&keyStats), keyStats.max / 1000.0,
+        getAverageMsec(&eventTimeStats), eventTimeStats.max / 1000.0,
+        maxPollIntervalUsec / 1000.0,
+        getAverageMsec(&ledStats), ledStats.max / 1000.0,
+        ledBytesPerSecond,
+        getAverageMsec(&frameStats), frameStats.max / 1000.0,
+        maxFrameStepCount,
+        getAverageMsec(&reconnectStats), reconnectStats.max / 1000.0,
+        endStats.nakCount - startStats.nakCount,
+        endStats.timeoutCount - startStats.timeoutCount,
+        recoveryCount,
+        missingCount);
+
+    return missingCount == 0;
+}
+
+int main(int argc, char **argv)
+{
+    static const uint32_t defaultBaudRates[] = {50000, 100000, 200000, 400000};
+    int option;
+
+    while ((option = getopt(argc, argv, "n:t:r")) != -1) {
+        switch (option) {
+            case 'n':
+                nakPerMille = atoi(optarg);
+                break;
+            case 't':
+                timeoutPerMille = atoi(optarg);
+                break;
+            case 'r':
+                isLeftKeyboardHalfReliable = true;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n nakPerMille] [-t timeoutPerMille] [-r] [baudRateBps...]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    printf("   baud    util    satn   xfer/s  bytes/s  polls/s  key age avg/max ms  event err avg/max ms  poll ms  led lag avg/max ms  led B/s  frame avg/max ms  steps  reconnect avg/max ms   nak  tout  rcvr  miss\n");
+
+    bool isSuccess = true;
+    if (optind < argc) {
+        for (int i = optind; i < argc; i++) {
+            isSuccess &= runBenchmark(atoi(argv[i]));
+        }
+    } else {
+        for (uint8_t i = 0; i < sizeof(defaultBaudRates) / sizeof(defaultBaudRates[0]); i++) {
+            isSuccess &= runBenchmark(defaultBaudRates[i]);
+        }
+    }
+
+    return isSuccess ? 0 : 1;
+}
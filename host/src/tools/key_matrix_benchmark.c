@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "key_matrix.h"
+#include "right_key_matrix.h"
+
+// Measures how long KeyMatrix_ReadCols() takes to extract the column states of a row from the GPIO input
+// registers in KeyMatrixScanMode_PerPin and KeyMatrixScanMode_PortWide, and checks that both modes agree.
+// The pin tables are the ones of the right and the left keyboard half. On the host, PDIR is plain memory,
+// so the numbers understate the gain on the device where every PDIR read is a peripheral bus access.
+
+#define SAMPLE_COUNT 1024
+#define ITERATION_COUNT 10000000
+
+// Mirrors keyMatrix of left/src/main.c.
+static key_matrix_t leftKeyMatrix = {
+    .colNum = 7,
+    .rowNum = 5,
+    .cols = (key_matrix_pin_t[]) {
+        {PORTB, GPIOB, kCLOCK_PortB, 11},
+        {PORTA, GPIOA, kCLOCK_PortA,  6},
+        {PORTA, GPIOA, kCLOCK_PortA,  8},
+        {PORTB, GPIOB, kCLOCK_PortB,  0},
+        {PORTB, GPIOB, kCLOCK_PortB,  6},
+        {PORTA, GPIOA, kCLOCK_PortA,  3},
+        {PORTA, GPIOA, kCLOCK_PortA, 12}
+    },
+    .rows = (key_matrix_pin_t[]) {
+        {PORTB, GPIOB, kCLOCK_PortB,  7},
+        {PORTB, GPIOB, kCLOCK_PortB, 10},
+        {PORTA, GPIOA, kCLOCK_PortA,  5},
+        {PORTA, GPIOA, kCLOCK_PortA,  7},
+        {PORTA, GPIOA, kCLOCK_PortA,  4}
+    }
+};
+
+static uint32_t pdirSamples[SAMPLE_COUNT][HOST_GPIO_COUNT];
+
+static void setPdirs(uint16_t sampleId)
+{
+    for (uint8_t gpioId = 0; gpioId < HOST_GPIO_COUNT; gpioId++) {
+        HostGpios[gpioId].PDIR = pdirSamples[sampleId][gpioId];
+    }
+}
+
+static double getElapsedNanoseconds(struct timespec *start, struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+// Returns the average nanoseconds per KeyMatrix_ReadCols() call over every sample, without the time of
+// loading the samples into the PDIR registers.
+static double measure(key_matrix_t *keyMatrix, uint32_t *checksum)
+{
+    struct timespec start, middle, end;
+    uint32_t sum = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t i = 0; i < ITERATION_COUNT; i++) {
+        setPdirs(i % SAMPLE_COUNT);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &middle);
+    for (uint32_t i = 0; i < ITERATION_COUNT; i++) {
+        setPdirs(i % SAMPLE_COUNT);
+        sum += KeyMatrix_ReadCols(keyMatrix);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    *checksum = sum;
+    double nanoseconds = getElapsedNanoseconds(&middle, &end) - getElapsedNanoseconds(&start, &middle);
+    return nanoseconds / ITERATION_COUNT;
+}
+
+static uint8_t getPortWidePdirReadCount(key_matrix_t *keyMatrix)
+{
+    uint8_t readCount = 0;
+    for (uint8_t i = 0; i < keyMatrix->colRunNum; i++) {
+        if (i == 0 || keyMatrix->colRuns[i].gpio != keyMatrix->colRuns[i-1].gpio) {
+            readCount++;
+        }
+    }
+    return readCount;
+}
+
+static bool runBenchmark(const char *name, key_matrix_t *keyMatrix)
+{
+    key_matrix_t perPinMatrix = *keyMatrix;
+    key_matrix_t portWideMatrix = *keyMatrix;
+    perPinMatrix.scanMode = KeyMatrixScanMode_PerPin;
+    portWideMatrix.scanMode = KeyMatrixScanMode_PortWide;
+    KeyMatrix_Init(&perPinMatrix);
+    KeyMatrix_Init(&portWideMatrix);
+
+    uint32_t mismatchCount = 0;
+    for (uint16_t sampleId = 0; sampleId < SAMPLE_COUNT; sampleId++) {
+        setPdirs(sampleId);
+        if (KeyMatrix_ReadCols(&perPinMatrix) != KeyMatrix_ReadCols(&portWideMatrix)) {
+            mismatchCount++;
+        }
+    }
+
+    uint32_t perPinChecksum, portWideChecksum;
+    double perPinNanoseconds = measure(&perPinMatrix, &perPinChecksum);
+    double portWideNanoseconds = measure(&portWideMatrix, &portWideChecksum);
+
+    printf("%-6s per pin %5.2f ns/row (%u PDIR reads)  port wide %5.2f ns/row (%u PDIR reads, %u runs)  %s\n", name,
+        perPinNanoseconds, perPinMatrix.colNum, portWideNanoseconds, getPortWidePdirReadCount(&portWideMatrix),
+        portWideMatrix.colRunNum,
+        mismatchCount || perPinChecksum != portWideChecksum ? "MISMATCH" : "ok");
+
+    return !mismatchCount && perPinChecksum == portWideChecksum;
+}
+
+int main(void)
+{
+    srand(1);
+    for (uint16_t sampleId = 0; sampleId < SAMPLE_COUNT; sampleId++) {
+        for (uint8_t gpioId = 0; gpioId < HOST_GPIO_COUNT; gpioId++) {
+            pdirSamples[sampleId][gpioId] = (uint32_t)rand() << 16 ^ (uint32_t)rand();
+        }
+    }
+
+    bool isSuccess = runBenchmark("right", &RightKeyMatrix);
+    isSuccess &= runBenchmark("left", &leftKeyMatrix);
+    return isSuccess ? 0 : 1;
+}
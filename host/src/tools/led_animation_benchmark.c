@@ -0,0 +1,186 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "simulator.h"
+#include "virtual_timer.h"
+#include "init_peripherals.h"
+#include "slave_scheduler.h"
+#include "key_states.h"
+#include "led_animation.h"
+#include "slave_drivers/is31fl3731_driver.h"
+#include "slave_drivers/uhk_module_driver.h"
+#include "i2c_error_logger.h"
+
+// Measures how long LedAnimation_Update() takes per frame on the host for every effect, with random key presses
+// and layer switches, and an unlimited bus budget so that every frame is applied. Then the animations run against
+// the virtual I2C bus at 100 and 400 kHz while both halves are typed on, and the applied frames per second, the
+// share of the computed frames that got throttled, the bytes per second that the animations were charged against
+// their budget, the bytes per second that the LED drivers wrote to update their LEDs and the average and longest
+// time between two polls of the left keyboard half are reported, without and with every effect. The left half is
+// polled every UHK_MODULE_POLL_INTERVAL_USEC, and ahead of that whenever the bus would go idle otherwise. The exit
+// status tells whether both the charged and the written bytes stayed within the budget, whether the left half was
+// always polled within its interval, and whether the poll gaps with the effects match the ones without: the
+// average gap may only grow as much as the bus share of the animations allows, and the longest gap by the longest
+// write of an LED driver.
+//
+// Usage: led_animation_benchmark [maxBusSharePercent]
+
+#define CPU_FRAME_COUNT 20000
+#define CPU_KEY_PRESS_FRAME_INTERVAL 4
+#define CPU_LAYER_SWITCH_FRAME_INTERVAL 25
+#define SETTLE_MSEC 1000
+#define TYPING_MSEC 10000
+#define KEYSTROKE_GAP_MSEC 60
+#define KEYSTROKE_HOLD_MSEC 40
+
+typedef struct {
+    double averagePollGapUsec;
+    uint32_t maxPollGapUsec;
+    bool isSuccess;
+} bus_load_t;
+
+static const struct {
+    uint8_t effects;
+    const char *name;
+} effectSets[] = {
+    {LedAnimationEffect_Breathing, "breathing"},
+    {LedAnimationEffect_LayerFade, "layer fade"},
+    {LedAnimationEffect_Afterglow, "afterglow"},
+    {LedAnimationEffect_Breathing | LedAnimationEffect_LayerFade | LedAnimationEffect_Afterglow, "all"},
+};
+
+static double getElapsedNanoseconds(struct timespec *start, struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+static void measureCpuCost(uint8_t effects, const char *name)
+{
+    double totalNanoseconds = 0;
+    double maxNanoseconds = 0;
+
+    Simulator_Config.isI2cBusSimulated = false;
+    Simulator_Init();
+    I2cMainBusActualBaudRateBps = UINT32_MAX / 1000;
+    LedAnimation_MaxBusSharePercent = 100;
+    LedAnimation_SetEffects(effects);
+    LedAnimation_ResetStats();
+
+    srand(1);
+    for (uint32_t frameId = 0; frameId < CPU_FRAME_COUNT; frameId++) {
+        struct timespec start, end;
+
+        VirtualTimer_AdvanceMicros(1000000 / LedAnimation_FrameRateHz);
+        if (frameId % CPU_KEY_PRESS_FRAME_INTERVAL == 0) {
+            LedAnimation_KeysPressed(rand() % 2, KEY_STATE_BIT(rand() % LED_ANIMATION_KEY_COUNT));
+        }
+        if (frameId % CPU_LAYER_SWITCH_FRAME_INTERVAL == 0) {
+            LedAnimation_FadeLayer(rand() % (LayerId_Mouse + 1));
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        LedAnimation_Update();
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        double nanoseconds = getElapsedNanoseconds(&start, &end);
+        totalNanoseconds += nanoseconds;
+        maxNanoseconds = MAX(maxNanoseconds, nanoseconds);
+    }
+
+    printf("%-10s  %8.0f / %8.0f  %11.1f\n", name, totalNanoseconds / CPU_FRAME_COUNT, maxNanoseconds,
+        LedAnimationStats.appliedFrameCount ? (double)LedAnimationStats.chargedByteCount / LedAnimationStats.appliedFrameCount : 0);
+    LedAnimation_SetEffects(0);
+}
+
+static void scheduleTyping(uint32_t startMicros, uint32_t endMicros)
+{
+    for (uint32_t time = startMicros; time < endMicros; time += KEYSTROKE_GAP_MSEC * 1000) {
+        uint8_t slotId = rand() % 2;
+        uint8_t keyId = rand() % LED_ANIMATION_KEY_COUNT;
+        Simulator_ScheduleKeyEvent(time, slotId, keyId, true);
+        Simulator_ScheduleKeyEvent(time + KEYSTROKE_HOLD_MSEC * 1000, slotId, keyId, false);
+    }
+}
+
+// The animations take up to maxBusSharePercent of the bus, which leaves the polls the rest of it, and a poll waits
+// for one write of an LED driver at most.
+static bool arePollGapsMatching(const bus_load_t *withoutEffects, const bus_load_t *withEffects, uint32_t baudRate, uint8_t maxBusSharePercent)
+{
+    uint32_t maxLedWriteUsec = (uint64_t)(1 + PWM_REGISTER_BUFFER_LENGTH) * LED_ANIMATION_I2C_CLOCKS_PER_BYTE * 1000000 / baudRate;
+    return withEffects->averagePollGapUsec * (100 - maxBusSharePercent) <= withoutEffects->averagePollGapUsec * 100 &&
+        withEffects->maxPollGapUsec <= withoutEffects->maxPollGapUsec + maxLedWriteUsec;
+}
+
+// The poll gaps are compared with withoutEffects unless it is NULL.
+static bus_load_t measureBusLoad(uint32_t baudRate, uint8_t effects, uint8_t maxBusSharePercent, const bus_load_t *withoutEffects)
+{
+    Simulator_Config.isI2cBusSimulated = true;
+    Simulator_Config.i2cBaudRateBps = baudRate;
+    Simulator_Init();
+    LedAnimation_MaxBusSharePercent = maxBusSharePercent;
+    Simulator_AdvanceTime(SETTLE_MSEC);
+
+    LedAnimation_SetEffects(effects);
+    LedAnimation_ResetStats();
+    LedSlaveDriver_ResetTelemetry();
+    ResetI2cTelemetry();
+
+    srand(1);
+    uint32_t startMicros = Simulator_GetTimeMicros();
+    scheduleTyping(startMicros, startMicros + TYPING_MSEC * 1000);
+    Simulator_RunUntil(startMicros + TYPING_MSEC * 1000);
+
+    double seconds = TYPING_MSEC / 1000.0;
+    uint32_t budgetBytesPerSecond = I2cMainBusActualBaudRateBps / LED_ANIMATION_I2C_CLOCKS_PER_BYTE * maxBusSharePercent / 100;
+    uint32_t maxByteCount = budgetBytesPerSecond * TYPING_MSEC / 1000;
+    uint32_t ledByteCount = 0;
+    for (uint8_t ledDriverId = 0; ledDriverId <= LedDriverId_Last; ledDriverId++) {
+        ledByteCount += LedDriverTelemetry.updateByteCount[ledDriverId];
+    }
+    i2c_slave_telemetry_t *telemetry = I2cSlaveTelemetry + SlaveId_LeftKeyboardHalf;
+    bus_load_t busLoad = {
+        .averagePollGapUsec = telemetry->pollCount ? (double)telemetry->pollGapSumUsec / telemetry->pollCount : 0,
+        .maxPollGapUsec = telemetry->maxPollGapUsec,
+    };
+    bool isWithinBudget = LedAnimationStats.chargedByteCount <= maxByteCount && ledByteCount <= maxByteCount;
+    bool isPolledInTime = busLoad.maxPollGapUsec <= UHK_MODULE_POLL_INTERVAL_USEC;
+    bool isMatching = !withoutEffects || arePollGapsMatching(withoutEffects, &busLoad, baudRate, maxBusSharePercent);
+    busLoad.isSuccess = isWithinBudget && isPolledInTime && isMatching;
+
+    printf("%7u  %-4s  %9.1f  %8.1f%%  %7.0f / %7u  %7.0f  %5.3f / %5.3f  %s\n",
+        baudRate,
+        effects ? "all" : "none",
+        LedAnimationStats.appliedFrameCount / seconds,
+        LedAnimationStats.computedFrameCount ? 100.0 * LedAnimationStats.throttledFrameCount / LedAnimationStats.computedFrameCount : 0,
+        LedAnimationStats.chargedByteCount / seconds, budgetBytesPerSecond,
+        ledByteCount / seconds,
+        busLoad.averagePollGapUsec / 1000.0, busLoad.maxPollGapUsec / 1000.0,
+        !isWithinBudget ? "OVER BUDGET" : !isPolledInTime ? "POLL LATE" : !isMatching ? "POLLS DELAYED" : "ok");
+
+    LedAnimation_SetEffects(0);
+    return busLoad;
+}
+
+int main(int argc, char **argv)
+{
+    static const uint32_t baudRates[] = {100000, 400000};
+    uint8_t maxBusSharePercent = argc > 1 ? atoi(argv[1]) : LED_ANIMATION_DEFAULT_MAX_BUS_SHARE_PERCENT;
+
+    printf("%u frames at %u Hz\n", CPU_FRAME_COUNT, LedAnimation_FrameRateHz);
+    printf("effects     ns/frame avg/max   bytes/frame\n");
+    for (uint8_t i = 0; i < sizeof(effectSets) / sizeof(effectSets[0]); i++) {
+        measureCpuCost(effectSets[i].effects, effectSets[i].name);
+    }
+
+    printf("\n%u s of typing, %u%% of the bus\n", TYPING_MSEC / 1000, maxBusSharePercent);
+    printf("   baud  fx    applied/s  throttled  charged/budget B/s  led B/s  gap ms avg/max\n");
+    bool isSuccess = true;
+    for (uint8_t i = 0; i < sizeof(baudRates) / sizeof(baudRates[0]); i++) {
+        bus_load_t withoutEffects = measureBusLoad(baudRates[i], 0, maxBusSharePercent, NULL);
+        bus_load_t withEffects = measureBusLoad(baudRates[i], LedAnimationEffect_Breathing | LedAnimationEffect_LayerFade |
+            LedAnimationEffect_Afterglow, maxBusSharePercent, &withoutEffects);
+        isSuccess &= withoutEffects.isSuccess && withEffects.isSuccess;
+    }
+
+    return isSuccess ? 0 : 1;
+}
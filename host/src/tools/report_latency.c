@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <time.h>
+#include "simulator.h"
+#include "virtual_timer.h"
+#include "keymap.h"
+#include "key_scanner.h"
+#include "usb_interfaces/usb_interface_basic_keyboard.h"
+
+// Presses and releases every basic keystroke of the base layer of the right keyboard half one after the
+// other, and reports the virtual delay between the key event and the USB report that reflects it.
+// The wall clock time of the whole run is reported as well, which serves as a rough throughput measure of
+// the input pipeline.
+
+#define KEY_HOLD_MSEC 100
+#define KEY_GAP_MSEC 100
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+} latency_stats_t;
+
+static void addSample(latency_stats_t *stats, uint32_t micros)
+{
+    if (stats->count == 0 || micros < stats->min) {
+        stats->min = micros;
+    }
+    if (micros > stats->max) {
+        stats->max = micros;
+    }
+    stats->sum += micros;
+    stats->count++;
+}
+
+static void printStats(const char *name, latency_stats_t *stats)
+{
+    if (stats->count == 0) {
+        printf("%-8s no samples\n", name);
+        return;
+    }
+    printf("%-8s n=%-4u min=%6.3f ms  avg=%6.3f ms  max=%6.3f ms\n", name, stats->count,
+        stats->min / 1000.0, (double)stats->sum / stats->count / 1000.0, stats->max / 1000.0);
+}
+
+static bool containsScancode(const simulator_report_t *report, uint8_t scancode)
+{
+    const usb_basic_keyboard_report_t *basicReport = (const usb_basic_keyboard_report_t*)report->data;
+    for (uint8_t i = 0; i < USB_BASIC_KEYBOARD_MAX_KEYS; i++) {
+        if (basicReport->scancodes[i] == scancode) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Returns the send time of the first basic keyboard report queued at or after sinceMicros whose scancode
+// presence matches isPressed, or false if there is no such report.
+static bool findReport(uint32_t sinceMicros, uint8_t scancode, bool isPressed, uint32_t *sendTimeMicros)
+{
+    for (uint16_t i = 0; i < Simulator_GetReportCount(); i++) {
+        const simulator_report_t *report = Simulator_GetReport(i);
+        if (report->type != SimulatorReportType_BasicKeyboard || report->queueTimeMicros < sinceMicros) {
+            continue;
+        }
+        if (containsScancode(report, scancode) == isPressed) {
+            *sendTimeMicros = report->sendTimeMicros;
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(void)
+{
+    latency_stats_t pressStats = {0};
+    latency_stats_t releaseStats = {0};
+    uint32_t missingReportCount = 0;
+
+    Simulator_Init();
+    Simulator_AdvanceTime(KEY_GAP_MSEC);
+
+    clock_t startClock = clock();
+    uint64_t startMicros = VirtualTimer_CurrentTimeMicros;
+
+    for (uint8_t keyId = 0; keyId < RIGHT_KEY_MATRIX_KEY_COUNT; keyId++) {
+        key_action_t *action = &CurrentKeymap[LayerId_Base][SlotId_RightKeyboardHalf][keyId];
+        if (action->type != KeyActionType_Keystroke || action->keystroke.keystrokeType != KeystrokeType_Basic ||
+            !action->keystroke.scancode || action->keystroke.secondaryRole) {
+            continue;
+        }
+        uint8_t scancode = action->keystroke.scancode;
+
+        Simulator_ClearReports();
+        uint32_t pressTime = Simulator_GetTimeMicros();
+        Simulator_SetKeyState(SlotId_RightKeyboardHalf, keyId, true);
+        Simulator_AdvanceTime(KEY_HOLD_MSEC);
+        uint32_t releaseTime = Simulator_GetTimeMicros();
+        Simulator_SetKeyState(SlotId_RightKeyboardHalf, keyId, false);
+        Simulator_AdvanceTime(KEY_GAP_MSEC);
+
+        uint32_t sendTime;
+        if (findReport(pressTime, scancode, true, &sendTime)) {
+            addSample(&pressStats, sendTime - pressTime);
+        } else {
+            missingReportCount++;
+        }
+        if (findReport(releaseTime, scancode, false, &sendTime)) {
+            addSample(&releaseStats, sendTime - releaseTime);
+        } else {
+            missingReportCount++;
+        }
+    }
+
+    double wallSeconds = (double)(clock() - startClock) / CLOCKS_PER_SEC;
+    double virtualSeconds = (VirtualTimer_CurrentTimeMicros - startMicros) / 1e6;
+
+    printStats("press", &pressStats);
+    printStats("release", &releaseStats);
+    printf("missing  %u\n", missingReportCount);
+    printf("scanner  %u frames, row interval %u us, latency %u-%u us, max period deviation %u us\n",
+        KeyScanner_Stats.frameCount, KeyScanner_RowIntervalUsec, KeyScanner_Stats.minLatencyUsec,
+        KeyScanner_Stats.maxLatencyUsec, KeyScanner_Stats.maxPeriodDeviationUsec);
+    printf("speed    %.1f virtual s in %.3f wall s (%.0fx real time)\n",
+        virtualSeconds, wallSeconds, wallSeconds > 0 ? virtualSeconds / wallSeconds : 0);
+
+    return missingReportCount ? 1 : 0;
+}
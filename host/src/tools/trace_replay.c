@@ -0,0 +1,435 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "simulator.h"
+#include "keymap.h"
+#include "usb_report_updater.h"
+#include "usb_interfaces/usb_interface_basic_keyboard.h"
+
+// Replays typing traces through UpdateUsbReports() on the virtual clock and compares the emitted keystroke
+// stream with the annotated expectation of every trace. See traces/README.md for the trace format.
+//
+// Usage: trace_replay [-v] file.trace...
+
+#define MAX_TRACE_EVENTS 256
+#define MAX_TRACE_ROLES 16
+#define MAX_TOKENS 128
+#define MAX_TOKEN_LENGTH 16
+#define MAX_DELAYS 4096
+
+// Idle time between traces so that every trace starts from a released keyboard with settled timeouts.
+#define TRACE_GAP_MSEC 1000
+
+// How long the replay keeps running after the last event of a trace.
+#define TRACE_TAIL_MSEC 500
+
+typedef char token_t[MAX_TOKEN_LENGTH];
+
+typedef struct {
+    uint32_t timeMicros;
+    uint8_t slotId;
+    uint8_t keyId;
+    bool isPressed;
+} trace_event_t;
+
+typedef struct {
+    uint8_t slotId;
+    uint8_t keyId;
+    uint8_t secondaryRole;
+} trace_role_t;
+
+typedef struct {
+    trace_event_t events[MAX_TRACE_EVENTS];
+    uint16_t eventCount;
+    trace_role_t roles[MAX_TRACE_ROLES];
+    uint8_t roleCount;
+    token_t expected[MAX_TOKENS];
+    uint8_t expectedCount;
+    bool hasExpectation;
+} trace_t;
+
+static const struct {
+    const char *name;
+    uint8_t secondaryRole;
+} secondaryRoleNames[] = {
+    { "lctrl", SecondaryRole_LeftCtrl },
+    { "lshift", SecondaryRole_LeftShift },
+    { "lalt", SecondaryRole_LeftAlt },
+    { "lsuper", SecondaryRole_LeftSuper },
+    { "rctrl", SecondaryRole_RightCtrl },
+    { "rshift", SecondaryRole_RightShift },
+    { "ralt", SecondaryRole_RightAlt },
+    { "rsuper", SecondaryRole_RightSuper },
+    { "mod", SecondaryRole_Mod },
+    { "fn", SecondaryRole_Fn },
+    { "mouse", SecondaryRole_Mouse },
+};
+
+static const struct {
+    const char *name;
+    uint8_t scancode;
+} specialKeyNames[] = {
+    { "enter", HID_KEYBOARD_SC_ENTER },
+    { "esc", HID_KEYBOARD_SC_ESCAPE },
+    { "bksp", HID_KEYBOARD_SC_BACKSPACE },
+    { "tab", HID_KEYBOARD_SC_TAB },
+    { "space", HID_KEYBOARD_SC_SPACE },
+    { "semicolon", HID_KEYBOARD_SC_SEMICOLON_AND_COLON },
+    { "comma", HID_KEYBOARD_SC_COMMA_AND_LESS_THAN_SIGN },
+    { "dot", HID_KEYBOARD_SC_DOT_AND_GREATER_THAN_SIGN },
+};
+
+static key_action_t originalBaseLayer[SLOT_COUNT][MAX_KEY_COUNT_PER_MODULE];
+static uint32_t delays[MAX_DELAYS];
+static uint16_t delayCount;
+static bool isVerbose;
+
+// Key names
+
+static bool getScancodeByName(const char *name, uint8_t *scancode)
+{
+    if (name[0] && !name[1]) {
+        if ('a' <= name[0] && name[0] <= 'z') {
+            *scancode = HID_KEYBOARD_SC_A + name[0] - 'a';
+            return true;
+        }
+        if ('1' <= name[0] && name[0] <= '9') {
+            *scancode = HID_KEYBOARD_SC_1_AND_EXCLAMATION + name[0] - '1';
+            return true;
+        }
+        if (name[0] == '0') {
+            *scancode = HID_KEYBOARD_SC_0_AND_CLOSING_PARENTHESIS;
+            return true;
+        }
+    }
+    for (uint8_t i = 0; i < sizeof(specialKeyNames) / sizeof(specialKeyNames[0]); i++) {
+        if (strcmp(name, specialKeyNames[i].name) == 0) {
+            *scancode = specialKeyNames[i].scancode;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void getScancodeName(uint8_t scancode, char *name, size_t size)
+{
+    if (HID_KEYBOARD_SC_A <= scancode && scancode <= HID_KEYBOARD_SC_Z) {
+        snprintf(name, size, "%c", 'a' + scancode - HID_KEYBOARD_SC_A);
+        return;
+    }
+    if (HID_KEYBOARD_SC_1_AND_EXCLAMATION <= scancode && scancode <= HID_KEYBOARD_SC_0_AND_CLOSING_PARENTHESIS) {
+        snprintf(name, size, "%c", "1234567890"[scancode - HID_KEYBOARD_SC_1_AND_EXCLAMATION]);
+        return;
+    }
+    for (uint8_t i = 0; i < sizeof(specialKeyNames) / sizeof(specialKeyNames[0]); i++) {
+        if (specialKeyNames[i].scancode == scancode) {
+            snprintf(name, size, "%s", specialKeyNames[i].name);
+            return;
+        }
+    }
+    snprintf(name, size, "0x%02x", scancode);
+}
+
+// Keys are referred to by the scancode of their base layer action, or as <slotId>:<keyId>.
+static bool findKey(const char *name, uint8_t *slotId, uint8_t *keyId)
+{
+    unsigned int rawSlotId, rawKeyId;
+    if (sscanf(name, "%u:%u", &rawSlotId, &rawKeyId) == 2) {
+        if (rawSlotId >= SLOT_COUNT || rawKeyId >= MAX_KEY_COUNT_PER_MODULE) {
+            return false;
+        }
+        *slotId = rawSlotId;
+        *keyId = rawKeyId;
+        return true;
+    }
+
+    uint8_t scancode;
+    if (!getScancodeByName(name, &scancode)) {
+        return false;
+    }
+    for (uint8_t slot = 0; slot < SLOT_COUNT; slot++) {
+        for (uint8_t key = 0; key < MAX_KEY_COUNT_PER_MODULE; key++) {
+            key_action_t *action = &originalBaseLayer[slot][key];
+            if (action->type == KeyActionType_Keystroke && action->keystroke.keystrokeType == KeystrokeType_Basic &&
+                action->keystroke.scancode == scancode) {
+                *slotId = slot;
+                *keyId = key;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Parsing
+
+static bool parseTrace(const char *path, trace_t *trace)
+{
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return false;
+    }
+
+    memset(trace, 0, sizeof(*trace));
+    char line[512];
+    uint16_t lineNumber = 0;
+    bool isValid = true;
+
+    while (isValid && fgets(line, sizeof(line), file)) {
+        lineNumber++;
+        char *comment = strchr(line, '#');
+        if (comment) {
+            *comment = '\0';
+        }
+
+        char *command = strtok(line, " \t\r\n");
+        if (!command) {
+            continue;
+        }
+
+        if (strcmp(command, "press") == 0 || strcmp(command, "release") == 0) {
+            char *time = strtok(NULL, " \t\r\n");
+            char *keyName = strtok(NULL, " \t\r\n");
+            trace_event_t *event = trace->events + trace->eventCount;
+            if (!time || !keyName || trace->eventCount == MAX_TRACE_EVENTS ||
+                !findKey(keyName, &event->slotId, &event->keyId)) {
+                isValid = false;
+                break;
+            }
+            event->timeMicros = (uint32_t)(strtod(time, NULL) * 1000);
+            event->isPressed = command[0] == 'p';
+            trace->eventCount++;
+        } else if (strcmp(command, "role") == 0) {
+            char *keyName = strtok(NULL, " \t\r\n");
+            char *roleName = strtok(NULL, " \t\r\n");
+            trace_role_t *role = trace->roles + trace->roleCount;
+            if (!keyName || !roleName || trace->roleCount == MAX_TRACE_ROLES ||
+                !findKey(keyName, &role->slotId, &role->keyId)) {
+                isValid = false;
+                break;
+            }
+            role->secondaryRole = 0;
+            for (uint8_t i = 0; i < sizeof(secondaryRoleNames) / sizeof(secondaryRoleNames[0]); i++) {
+                if (strcmp(roleName, secondaryRoleNames[i].name) == 0) {
+                    role->secondaryRole = secondaryRoleNames[i].secondaryRole;
+                }
+            }
+            isValid = role->secondaryRole != 0;
+            trace->roleCount++;
+        } else if (strcmp(command, "expect") == 0) {
+            char *token;
+            trace->hasExpectation = true;
+            while ((token = strtok(NULL, " \t\r\n"))) {
+                if (trace->expectedCount == MAX_TOKENS) {
+                    isValid = false;
+                    break;
+                }
+                snprintf(trace->expected[trace->expectedCount++], MAX_TOKEN_LENGTH, "%s", token);
+            }
+        } else {
+            isValid = false;
+        }
+    }
+
+    fclose(file);
+    if (!isValid) {
+        fprintf(stderr, "%s:%u: invalid line\n", path, lineNumber);
+    }
+    return isValid;
+}
+
+// Replay
+
+static bool containsScancode(const usb_basic_keyboard_report_t *report, uint8_t scancode)
+{
+    for (uint8_t i = 0; i < USB_BASIC_KEYBOARD_MAX_KEYS; i++) {
+        if (report->scancodes[i] == scancode) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Every scancode that appears in a basic keyboard report becomes a token, prefixed by the modifiers of the
+// report, like "S-a" for a shifted a.
+static uint8_t collectTokens(token_t *tokens)
+{
+    usb_basic_keyboard_report_t previousReport = {0};
+    uint8_t tokenCount = 0;
+
+    for (uint16_t i = 0; i < Simulator_GetReportCount(); i++) {
+        const simulator_report_t *report = Simulator_GetReport(i);
+        if (report->type != SimulatorReportType_BasicKeyboard) {
+            continue;
+        }
+        const usb_basic_keyboard_report_t *basicReport = (const usb_basic_keyboard_report_t*)report->data;
+        for (uint8_t j = 0; j < USB_BASIC_KEYBOARD_MAX_KEYS; j++) {
+            uint8_t scancode = basicReport->scancodes[j];
+            if (!scancode || containsScancode(&previousReport, scancode) || tokenCount == MAX_TOKENS) {
+                continue;
+            }
+            char scancodeName[8];
+            uint8_t modifiers = basicReport->modifiers | basicReport->modifiers >> 4;
+            getScancodeName(scancode, scancodeName, sizeof(scancodeName));
+            snprintf(tokens[tokenCount++], MAX_TOKEN_LENGTH, "%s%s%s%s%s",
+                modifiers & HID_KEYBOARD_MODIFIER_LEFTCTRL ? "C-" : "",
+                modifiers & HID_KEYBOARD_MODIFIER_LEFTSHIFT ? "S-" : "",
+                modifiers & HID_KEYBOARD_MODIFIER_LEFTALT ? "A-" : "",
+                modifiers & HID_KEYBOARD_MODIFIER_LEFTGUI ? "G-" : "",
+                scancodeName);
+        }
+        previousReport = *basicReport;
+    }
+
+    return tokenCount;
+}
+
+// The number of wrong decisions is the edit distance of the emitted and the expected token streams, so that a
+// primary role emitted in place of a secondary one, a missing or a spurious keystroke all count as one.
+static uint8_t getEditDistance(token_t *a, uint8_t aCount, token_t *b, uint8_t bCount)
+{
+    uint8_t row[MAX_TOKENS + 1];
+    for (uint8_t j = 0; j <= bCount; j++) {
+        row[j] = j;
+    }
+    for (uint8_t i = 1; i <= aCount; i++) {
+        uint8_t diagonal = row[0];
+        row[0] = i;
+        for (uint8_t j = 1; j <= bCount; j++) {
+            uint8_t above = row[j];
+            uint8_t substitution = diagonal + (strcmp(a[i-1], b[j-1]) != 0);
+            row[j] = MIN(MIN(row[j-1] + 1, above + 1), substitution);
+            diagonal = above;
+        }
+    }
+    return row[bCount];
+}
+
+static void collectReleaseDelays(trace_t *trace, uint32_t startMicros)
+{
+    for (uint16_t i = 0; i < trace->eventCount; i++) {
+        trace_event_t *event = trace->events + i;
+        if (event->isPressed) {
+            continue;
+        }
+        uint32_t releaseMicros = startMicros + event->timeMicros;
+        for (uint16_t j = 0; j < Simulator_GetReportCount(); j++) {
+            const simulator_report_t *report = Simulator_GetReport(j);
+            if (report->type == SimulatorReportType_BasicKeyboard && report->queueTimeMicros >= releaseMicros) {
+                if (delayCount < MAX_DELAYS) {
+                    delays[delayCount++] = report->sendTimeMicros - releaseMicros;
+                }
+                break;
+            }
+        }
+    }
+}
+
+static uint8_t replayTrace(const char *path, trace_t *trace)
+{
+    memcpy(CurrentKeymap[LayerId_Base], originalBaseLayer, sizeof(originalBaseLayer));
+    for (uint8_t i = 0; i < trace->roleCount; i++) {
+        trace_role_t *role = trace->roles + i;
+        CurrentKeymap[LayerId_Base][role->slotId][role->keyId].keystroke.secondaryRole = role->secondaryRole;
+    }
+
+    Simulator_AdvanceTime(TRACE_GAP_MSEC);
+    Simulator_ClearReports();
+
+    uint32_t startMicros = Simulator_GetTimeMicros();
+    uint32_t endMicros = startMicros;
+    for (uint16_t i = 0; i < trace->eventCount; i++) {
+        trace_event_t *event = trace->events + i;
+        Simulator_ScheduleKeyEvent(startMicros + event->timeMicros, event->slotId, event->keyId, event->isPressed);
+        endMicros = MAX(endMicros, startMicros + event->timeMicros);
+    }
+    Simulator_RunUntil(endMicros + TRACE_TAIL_MSEC * 1000);
+
+    token_t emitted[MAX_TOKENS];
+    uint8_t emittedCount = collectTokens(emitted);
+    uint8_t wrongCount = trace->hasExpectation ?
+        getEditDistance(emitted, emittedCount, trace->expected, trace->expectedCount) : 0;
+    collectReleaseDelays(trace, startMicros);
+
+    printf("%-40s %s ", path, !trace->hasExpectation ? "----" : wrongCount ? "FAIL" : "ok  ");
+    for (uint8_t i = 0; i < emittedCount; i++) {
+        printf(" %s", emitted[i]);
+    }
+    if (wrongCount) {
+        printf("  (expected");
+        for (uint8_t i = 0; i < trace->expectedCount; i++) {
+            printf(" %s", trace->expected[i]);
+        }
+        printf(", %u wrong)", wrongCount);
+    }
+    printf("\n");
+
+    if (isVerbose) {
+        for (uint16_t i = 0; i < Simulator_GetReportCount(); i++) {
+            const simulator_report_t *report = Simulator_GetReport(i);
+            printf("    %8.3f ms type %u:", (report->sendTimeMicros - startMicros) / 1000.0, report->type);
+            for (uint8_t j = 0; j < report->length; j++) {
+                printf(" %02x", report->data[j]);
+            }
+            printf("\n");
+        }
+    }
+
+    return wrongCount;
+}
+
+// Statistics
+
+static int compareDelays(const void *a, const void *b)
+{
+    uint32_t delayA = *(const uint32_t*)a;
+    uint32_t delayB = *(const uint32_t*)b;
+    return delayA < delayB ? -1 : delayA > delayB;
+}
+
+static double getPercentile(uint8_t percentile)
+{
+    uint16_t index = (uint16_t)(((uint32_t)delayCount * percentile + 99) / 100);
+    return delays[index ? index - 1 : 0] / 1000.0;
+}
+
+int main(int argc, char **argv)
+{
+    static trace_t trace;
+    uint16_t traceCount = 0;
+    uint16_t failedTraceCount = 0;
+    uint32_t wrongCount = 0;
+
+    Simulator_Init();
+    memcpy(originalBaseLayer, CurrentKeymap[LayerId_Base], sizeof(originalBaseLayer));
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) {
+            isVerbose = true;
+            continue;
+        }
+        if (!parseTrace(argv[i], &trace)) {
+            return 2;
+        }
+        uint8_t traceWrongCount = replayTrace(argv[i], &trace);
+        wrongCount += traceWrongCount;
+        failedTraceCount += traceWrongCount > 0;
+        traceCount++;
+    }
+
+    if (traceCount == 0) {
+        fprintf(stderr, "Usage: %s [-v] file.trace...\n", argv[0]);
+        return 2;
+    }
+
+    printf("\ntraces   %u (%u failed)\n", traceCount, failedTraceCount);
+    printf("wrong    %u\n", wrongCount);
+    if (delayCount) {
+        qsort(delays, delayCount, sizeof(delays[0]), compareDelays);
+        printf("release  n=%u p50=%.3f ms p99=%.3f ms max=%.3f ms\n",
+            delayCount, getPercentile(50), getPercentile(99), delays[delayCount-1] / 1000.0);
+    }
+
+    return 0;
+}
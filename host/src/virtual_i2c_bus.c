@@ -0,0 +1,171 @@
+#include "virtual_i2c_bus.h"
+#include "virtual_timer.h"
+#include "slave_protocol.h"
+
+// Models the main I2C bus at the transfer level. A transfer occupies the bus for the time it takes to clock
+// its bytes at the configured baud rate, then the completion callback of the master handle gets called just
+// like the KSDK I2C interrupt handler would do.
+
+typedef enum {
+    TransferState_Idle,
+    TransferState_InProgress,
+    TransferState_Stuck,
+} transfer_state_t;
+
+virtual_i2c_bus_config_t VirtualI2cBus_Config = {
+    .baudRateBps = 100000,
+    .transferOverheadMicros = 10,
+    .randomSeed = 1,
+};
+
+virtual_i2c_bus_stats_t VirtualI2cBus_Stats;
+
+static virtual_i2c_slave_t *slaves[VIRTUAL_I2C_BUS_MAX_SLAVE_COUNT];
+static uint8_t slaveCount;
+static uint32_t randomState;
+
+static struct {
+    transfer_state_t state;
+    I2C_Type *base;
+    i2c_master_handle_t *handle;
+    uint64_t completionTimeMicros;
+    status_t status;
+    uint8_t readBuffer[I2C_MESSAGE_MAX_TOTAL_LENGTH];
+} transfer;
+
+static uint32_t getRandom(void)
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+static bool isRandomEvent(uint16_t perMille)
+{
+    return perMille && getRandom() % 1000 < perMille;
+}
+
+static virtual_i2c_slave_t *getSlave(uint8_t address)
+{
+    for (uint8_t i = 0; i < slaveCount; i++) {
+        if (slaves[i]->address == address) {
+            return slaves[i];
+        }
+    }
+    return NULL;
+}
+
+// Start or repeated start condition, address byte and data bytes of 9 clocks each including the acknowledge bit,
+// then a stop condition unless the transfer keeps the bus for a repeated start.
+static uint32_t getTransferMicros(size_t byteCount, uint32_t flags)
+{
+    uint32_t bitCount = 1 + 9 * (1 + byteCount) + (flags & kI2C_TransferNoStopFlag ? 0 : 1);
+    return (uint32_t)((uint64_t)bitCount * 1000000U / VirtualI2cBus_Config.baudRateBps) +
+        VirtualI2cBus_Config.transferOverheadMicros;
+}
+
+void VirtualI2cBus_Init(void)
+{
+    slaveCount = 0;
+    randomState = VirtualI2cBus_Config.randomSeed ?: 1;
+    memset(&transfer, 0, sizeof(transfer));
+    memset(&VirtualI2cBus_Stats, 0, sizeof(VirtualI2cBus_Stats));
+}
+
+void VirtualI2cBus_AddSlave(virtual_i2c_slave_t *slave)
+{
+    if (slaveCount < VIRTUAL_I2C_BUS_MAX_SLAVE_COUNT) {
+        slaves[slaveCount++] = slave;
+    }
+}
+
+status_t VirtualI2cBus_StartTransfer(I2C_Type *base, i2c_master_handle_t *handle, i2c_master_transfer_t *xfer)
+{
+    if (transfer.state != TransferState_Idle) {
+        return kStatus_I2C_Busy;
+    }
+
+    handle->transfer = *xfer;
+    handle->transferSize = xfer->dataSize;
+    transfer.base = base;
+    transfer.handle = handle;
+    transfer.status = kStatus_Success;
+
+    virtual_i2c_slave_t *slave = getSlave(xfer->slaveAddress);
+    size_t byteCount = xfer->dataSize;
+
+    bool isOverspeed = VirtualI2cBus_Config.maxReliableBaudRateBps &&
+        VirtualI2cBus_Config.baudRateBps > VirtualI2cBus_Config.maxReliableBaudRateBps;
+
+    if (!slave || !slave->isConnected || isRandomEvent(slave->nakPerMille) ||
+        (isOverspeed && isRandomEvent(VirtualI2cBus_Config.overspeedNakPerMille))) {
+        transfer.status = kStatus_I2C_Nak;
+        byteCount = 0;
+        VirtualI2cBus_Stats.nakCount++;
+    } else if (isRandomEvent(slave->timeoutPerMille)) {
+        transfer.state = TransferState_Stuck;
+        VirtualI2cBus_Stats.timeoutCount++;
+        return kStatus_Success;
+    } else if (xfer->direction == kI2C_Read) {
+        size_t length = MIN(xfer->dataSize, sizeof(transfer.readBuffer));
+        memset(transfer.readBuffer, 0xff, length);
+        slave->transmit(slave, transfer.readBuffer, length);
+
+        // The patched KSDK of the firmware ends message reads, marked by userData, after the length byte.
+        if (handle->userData) {
+            byteCount = MIN(byteCount, I2C_MESSAGE_HEADER_LENGTH + transfer.readBuffer[0]);
+        }
+    }
+
+    uint32_t transferMicros = getTransferMicros(byteCount, xfer->flags);
+    transfer.completionTimeMicros = VirtualTimer_CurrentTimeMicros + transferMicros;
+    transfer.state = TransferState_InProgress;
+    handle->transferSize = byteCount;
+
+    VirtualI2cBus_Stats.transferCount++;
+    VirtualI2cBus_Stats.byteCount += byteCount;
+    VirtualI2cBus_Stats.busyMicros += transferMicros;
+    return kStatus_Success;
+}
+
+void VirtualI2cBus_AbortTransfer(void)
+{
+    transfer.state = TransferState_Idle;
+}
+
+uint32_t VirtualI2cBus_GetMicrosUntilCompletion(void)
+{
+    if (transfer.state != TransferState_InProgress) {
+        return VIRTUAL_I2C_BUS_NO_EVENT;
+    }
+    if (transfer.completionTimeMicros <= VirtualTimer_CurrentTimeMicros) {
+        return 0;
+    }
+    return (uint32_t)(transfer.completionTimeMicros - VirtualTimer_CurrentTimeMicros);
+}
+
+void VirtualI2cBus_Update(void)
+{
+    if (transfer.state != TransferState_InProgress || transfer.completionTimeMicros > VirtualTimer_CurrentTimeMicros) {
+        return;
+    }
+
+    i2c_master_handle_t *handle = transfer.handle;
+    i2c_master_transfer_t *xfer = &handle->transfer;
+
+    if (transfer.status == kStatus_Success) {
+        virtual_i2c_slave_t *slave = getSlave(xfer->slaveAddress);
+        if (xfer->direction == kI2C_Write) {
+            slave->receive(slave, xfer->data, xfer->dataSize);
+        } else {
+            memcpy(xfer->data, transfer.readBuffer, handle->transferSize);
+        }
+    }
+
+    transfer.state = TransferState_Idle;
+    I2C_Watchdog++;
+    if (handle->completionCallback) {
+        handle->completionCallback(transfer.base, handle, transfer.status, handle->userData);
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef __VIRTUAL_I2C_BUS_H__
+#define __VIRTUAL_I2C_BUS_H__
+
+// Includes:
+
+    #include "fsl_i2c.h"
+
+// Macros:
+
+    #define VIRTUAL_I2C_BUS_MAX_SLAVE_COUNT 8
+    #define VIRTUAL_I2C_BUS_NO_EVENT UINT32_MAX
+
+// Typedefs:
+
+    typedef struct virtual_i2c_slave virtual_i2c_slave_t;
+
+    // Called when a write transfer addressed to the slave completes.
+    typedef void (virtual_i2c_slave_receive_t)(virtual_i2c_slave_t *slave, const uint8_t *data, size_t length);
+
+    // Called when a read transfer addressed to the slave starts, just like the transmit event of the KSDK I2C
+    // slave driver. The bytes that the slave leaves untouched read 0xff.
+    typedef void (virtual_i2c_slave_transmit_t)(virtual_i2c_slave_t *slave, uint8_t *data, size_t length);
+
+    struct virtual_i2c_slave {
+        uint8_t address;
+        bool isConnected;
+        uint16_t nakPerMille;       // Probability of a NAK of the address byte
+        uint16_t timeoutPerMille;   // Probability of the slave holding the bus, so that the transfer never completes
+        virtual_i2c_slave_receive_t *receive;
+        virtual_i2c_slave_transmit_t *transmit;
+    };
+
+    typedef struct {
+        uint32_t baudRateBps;
+        uint16_t transferOverheadMicros;  // Interrupt and driver time between transfers
+        uint32_t maxReliableBaudRateBps;  // Like with a long cable, every transfer above this baud rate NAKs with
+        uint16_t overspeedNakPerMille;    // the given probability, 0 for no limit
+        uint32_t randomSeed;
+    } virtual_i2c_bus_config_t;
+
+    typedef struct {
+        uint32_t transferCount;
+        uint32_t byteCount;
+        uint32_t nakCount;
+        uint32_t timeoutCount;
+        uint64_t busyMicros;
+    } virtual_i2c_bus_stats_t;
+
+// Variables:
+
+    extern virtual_i2c_bus_config_t VirtualI2cBus_Config;
+    extern virtual_i2c_bus_stats_t VirtualI2cBus_Stats;
+
+// Functions:
+
+    void VirtualI2cBus_Init(void);
+    void VirtualI2cBus_AddSlave(virtual_i2c_slave_t *slave);
+
+    status_t VirtualI2cBus_StartTransfer(I2C_Type *base, i2c_master_handle_t *handle, i2c_master_transfer_t *xfer);
+    void VirtualI2cBus_AbortTransfer(void);
+    uint32_t VirtualI2cBus_GetMicrosUntilCompletion(void);
+    void VirtualI2cBus_Update(void);
+
+#endif
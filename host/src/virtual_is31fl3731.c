@@ -0,0 +1,77 @@
+#include "virtual_is31fl3731.h"
+
+// Register level model of the IS31FL3731 LED driver. The first byte of a write sets the register pointer
+// of the selected page which auto-increments with every further byte, and register 0xFD selects the page.
+// Only the picture mode is modelled, where the picture display register selects the displayed frame.
+
+static uint8_t getDisplayedFrame(virtual_is31fl3731_t *ledDriver)
+{
+    return ledDriver->functionRegisters[LED_DRIVER_REGISTER_PICTURE_DISPLAY] & (VIRTUAL_IS31FL3731_FRAME_COUNT - 1);
+}
+
+static uint8_t *getRegister(virtual_is31fl3731_t *ledDriver, uint8_t registerAddress)
+{
+    if (ledDriver->page == LED_DRIVER_FRAME_FUNCTION) {
+        return registerAddress < VIRTUAL_IS31FL3731_FUNCTION_REGISTER_COUNT
+            ? ledDriver->functionRegisters + registerAddress
+            : NULL;
+    }
+    if (ledDriver->page < VIRTUAL_IS31FL3731_FRAME_COUNT && registerAddress < VIRTUAL_IS31FL3731_FRAME_REGISTER_COUNT) {
+        return ledDriver->frames[ledDriver->page] + registerAddress;
+    }
+    return NULL;
+}
+
+static void receive(virtual_i2c_slave_t *slave, const uint8_t *data, size_t length)
+{
+    virtual_is31fl3731_t *ledDriver = (virtual_is31fl3731_t*)slave;
+
+    if (length < 2) {
+        return;
+    }
+
+    uint8_t registerAddress = data[0];
+    if (registerAddress == LED_DRIVER_REGISTER_FRAME) {
+        ledDriver->page = data[1];
+        return;
+    }
+
+    uint8_t displayedPwmValues[LED_DRIVER_LED_COUNT];
+    memcpy(displayedPwmValues, VirtualIs31fl3731_GetPwmValues(ledDriver), LED_DRIVER_LED_COUNT);
+
+    for (size_t i = 1; i < length; i++, registerAddress++) {
+        uint8_t *reg = getRegister(ledDriver, registerAddress);
+        if (!reg) {
+            continue;
+        }
+        *reg = data[i];
+        if (ledDriver->page != LED_DRIVER_FRAME_FUNCTION && registerAddress >= FRAME_REGISTER_PWM_FIRST) {
+            ledDriver->pwmByteCount++;
+        }
+    }
+
+    if (memcmp(displayedPwmValues, VirtualIs31fl3731_GetPwmValues(ledDriver), LED_DRIVER_LED_COUNT)) {
+        ledDriver->visibleChangeCount++;
+    }
+}
+
+static void transmit(virtual_i2c_slave_t *slave, uint8_t *data, size_t length)
+{
+}
+
+void VirtualIs31fl3731_Init(virtual_is31fl3731_t *ledDriver, uint8_t i2cAddress)
+{
+    memset(ledDriver, 0, sizeof(virtual_is31fl3731_t));
+    ledDriver->slave = (virtual_i2c_slave_t){
+        .address = i2cAddress,
+        .isConnected = true,
+        .receive = receive,
+        .transmit = transmit,
+    };
+}
+
+// Returns the PWM values of the displayed frame.
+const uint8_t *VirtualIs31fl3731_GetPwmValues(virtual_is31fl3731_t *ledDriver)
+{
+    return ledDriver->frames[getDisplayedFrame(ledDriver)] + FRAME_REGISTER_PWM_FIRST;
+}
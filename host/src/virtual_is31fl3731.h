@@ -0,0 +1,31 @@
+#ifndef __VIRTUAL_IS31FL3731_H__
+#define __VIRTUAL_IS31FL3731_H__
+
+// Includes:
+
+    #include "virtual_i2c_bus.h"
+    #include "peripherals/led_driver.h"
+
+// Macros:
+
+    #define VIRTUAL_IS31FL3731_FRAME_COUNT 8
+    #define VIRTUAL_IS31FL3731_FRAME_REGISTER_COUNT (FRAME_REGISTER_PWM_LAST + 1)
+    #define VIRTUAL_IS31FL3731_FUNCTION_REGISTER_COUNT 0x0D
+
+// Typedefs:
+
+    typedef struct {
+        virtual_i2c_slave_t slave;  // Must be the first member, the I2C callbacks cast it back to the model
+        uint8_t page;
+        uint8_t frames[VIRTUAL_IS31FL3731_FRAME_COUNT][VIRTUAL_IS31FL3731_FRAME_REGISTER_COUNT];
+        uint8_t functionRegisters[VIRTUAL_IS31FL3731_FUNCTION_REGISTER_COUNT];
+        uint32_t pwmByteCount;  // PWM register bytes written to any frame, including the ones that didn't change
+        uint32_t visibleChangeCount;  // Writes that changed the displayed PWM values, a torn update counts several times
+    } virtual_is31fl3731_t;
+
+// Functions:
+
+    void VirtualIs31fl3731_Init(virtual_is31fl3731_t *ledDriver, uint8_t i2cAddress);
+    const uint8_t *VirtualIs31fl3731_GetPwmValues(virtual_is31fl3731_t *ledDriver);
+
+#endif
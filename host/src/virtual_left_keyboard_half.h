@@ -0,0 +1,27 @@
+#ifndef __VIRTUAL_LEFT_KEYBOARD_HALF_H__
+#define __VIRTUAL_LEFT_KEYBOARD_HALF_H__
+
+// Includes:
+
+    #include "virtual_i2c_bus.h"
+
+// Typedefs:
+
+    typedef struct {
+        uint8_t ledPwmBrightness;
+        uint32_t resetCount;
+        uint32_t rxMessageCount;
+        uint32_t txMessageCount;
+    } virtual_left_keyboard_half_state_t;
+
+// Variables:
+
+    extern virtual_i2c_slave_t VirtualLeftKeyboardHalf_Slave;
+    extern virtual_left_keyboard_half_state_t VirtualLeftKeyboardHalf_State;
+
+// Functions:
+
+    void VirtualLeftKeyboardHalf_Init(void);
+    void VirtualLeftKeyboardHalf_SetKeyState(uint8_t keyId, bool isPressed);
+
+#endif
@@ -0,0 +1,65 @@
+#include "virtual_timer.h"
+
+// Host implementation of timer.h driven by a virtual clock instead of PIT_TIMER_HANDLER.
+// CurrentTime is incremented exactly as the PIT interrupt would do it, once per TIMER_INTERVAL_MSEC.
+
+volatile uint32_t CurrentTime;
+uint64_t VirtualTimer_CurrentTimeMicros;
+
+void VirtualTimer_Reset(void)
+{
+    CurrentTime = 0;
+    VirtualTimer_CurrentTimeMicros = 0;
+}
+
+void VirtualTimer_AdvanceMicros(uint32_t micros)
+{
+    uint64_t previousTicks = VirtualTimer_CurrentTimeMicros / (1000U * TIMER_INTERVAL_MSEC);
+    VirtualTimer_CurrentTimeMicros += micros;
+    uint64_t currentTicks = VirtualTimer_CurrentTimeMicros / (1000U * TIMER_INTERVAL_MSEC);
+    CurrentTime += (uint32_t)(currentTicks - previousTicks);
+}
+
+void Timer_Init(void)
+{
+}
+
+uint32_t Timer_GetCurrentTimeMicros()
+{
+    return (uint32_t)VirtualTimer_CurrentTimeMicros;
+}
+
+void Timer_SetCurrentTimeMicros(uint32_t *time)
+{
+    *time = Timer_GetCurrentTimeMicros();
+}
+
+uint32_t Timer_GetElapsedTime(uint32_t *time)
+{
+    return CurrentTime - *time;
+}
+
+uint32_t Timer_GetElapsedTimeMicros(uint32_t *time)
+{
+    return Timer_GetCurrentTimeMicros() - *time;
+}
+
+uint32_t Timer_GetElapsedTimeAndSetCurrent(uint32_t *time)
+{
+    uint32_t elapsedTime = Timer_GetElapsedTime(time);
+    *time = CurrentTime;
+    return elapsedTime;
+}
+
+uint32_t Timer_GetElapsedTimeAndSetCurrentMicros(uint32_t *time)
+{
+    uint32_t elapsedTime = Timer_GetElapsedTimeMicros(time);
+    *time = Timer_GetCurrentTimeMicros();
+    return elapsedTime;
+}
+
+// Busy waiting would never end on the host, so the delay simply consumes virtual time.
+void Timer_Delay(uint32_t length)
+{
+    VirtualTimer_AdvanceMicros(length * 1000U * TIMER_INTERVAL_MSEC);
+}
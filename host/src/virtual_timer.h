@@ -0,0 +1,18 @@
+#ifndef __VIRTUAL_TIMER_H__
+#define __VIRTUAL_TIMER_H__
+
+// Includes:
+
+    #include <stdint.h>
+    #include "timer.h"
+
+// Variables:
+
+    extern uint64_t VirtualTimer_CurrentTimeMicros;
+
+// Functions:
+
+    void VirtualTimer_Reset(void);
+    void VirtualTimer_AdvanceMicros(uint32_t micros);
+
+#endif
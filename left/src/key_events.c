@@ -0,0 +1,116 @@
+#include "key_events.h"
+#include "main.h"
+#include "module.h"
+#include "bool_array_converter.h"
+
+// The key changes seen by the key scanner since the last SlaveCommand_RequestKeyEvents, in scan order. Every
+// event carries the number of scanner ticks since the previous one, so that the master can tell how far apart
+// they happened even if several of them arrive in the same reply. Key delta replies leave their events at the
+// front of the queue until the master acknowledges them.
+
+static slave_key_event_t events[KEY_EVENT_QUEUE_LENGTH];
+static uint8_t eventCount;
+static bool isOverflowed;
+static uint16_t ticksSinceLastEvent = UINT16_MAX;
+
+static uint8_t sequence;
+static uint8_t sentEventCount;  // Events of the last key delta reply that aren't acknowledged yet
+static bool isResyncPending;    // The last key delta reply reported an overflow that isn't acknowledged yet
+
+// Called by the key scanner on every row scan.
+void KeyEvents_Tick(void)
+{
+    if (ticksSinceLastEvent < UINT16_MAX) {
+        ticksSinceLastEvent++;
+    }
+}
+
+void KeyEvents_Push(uint8_t keyId, bool isPressed)
+{
+    if (eventCount == KEY_EVENT_QUEUE_LENGTH) {
+        isOverflowed = true;
+    } else {
+        slave_key_event_t *event = events + eventCount++;
+        event->keyIdAndState = keyId | (isPressed ? SLAVE_KEY_EVENT_PRESSED : 0);
+        event->tickDelta = MIN(ticksSinceLastEvent, UINT8_MAX);
+    }
+    ticksSinceLastEvent = 0;
+}
+
+// Drains the queue into a SlaveCommand_RequestKeyEvents reply and returns its length. The key states are
+// appended in the same critical section if requested or if events were lost, so they reflect every event.
+uint8_t KeyEvents_Serialize(uint8_t *buffer, bool includeKeyStates)
+{
+    slave_key_events_header_t *header = (slave_key_events_header_t*)buffer;
+    uint32_t primask = DisableGlobalIRQ();
+
+    includeKeyStates |= isOverflowed;
+    header->flags = (isOverflowed ? SlaveKeyEventsFlag_Overflow : 0) | (includeKeyStates ? SlaveKeyEventsFlag_KeyStates : 0);
+    header->eventCount = isOverflowed ? 0 : eventCount;
+    header->ticksSinceLastEvent = ticksSinceLastEvent;
+    uint8_t length = sizeof(slave_key_events_header_t);
+    memcpy(buffer + length, events, header->eventCount * sizeof(slave_key_event_t));
+    length += header->eventCount * sizeof(slave_key_event_t);
+    if (includeKeyStates) {
+        KeyMatrix_GetKeyStateBits(&keyMatrix, buffer + length);
+        length += BOOL_BYTES_TO_BITS_COUNT(MODULE_KEY_COUNT);
+    }
+
+    eventCount = 0;
+    sentEventCount = 0;
+    isOverflowed = false;
+    isResyncPending = false;
+
+    EnableGlobalIRQ(primask);
+    return length;
+}
+
+// Serializes a SlaveCommand_RequestKeyDeltas reply and returns its length. The acknowledged events are dropped
+// first, the unacknowledged ones are sent again. An overflow is reported with the key states, which are taken
+// again until the master acknowledges the overflow.
+uint8_t KeyEvents_SerializeDeltas(uint8_t *buffer, uint8_t requestFlags)
+{
+    uint32_t primask = DisableGlobalIRQ();
+
+    if (requestFlags >> SLAVE_KEY_DELTAS_ACK_SHIFT == sequence) {
+        eventCount -= sentEventCount;
+        memmove(events, events + sentEventCount, eventCount * sizeof(slave_key_event_t));
+        isResyncPending = false;
+    }
+    if (isOverflowed) {
+        isOverflowed = false;
+        isResyncPending = true;
+    }
+    if (isResyncPending) {
+        eventCount = 0;
+    }
+    sentEventCount = eventCount;
+
+    bool includeKeyStates = (requestFlags & SlaveKeyDeltasRequest_KeyStates) || isResyncPending;
+    if (!eventCount && !includeKeyStates) {
+        buffer[0] = sequence;
+        EnableGlobalIRQ(primask);
+        return 1;
+    }
+
+    sequence = (sequence + 1) & SLAVE_KEY_DELTAS_SEQUENCE_MASK;
+    buffer[0] = sequence |
+        (isResyncPending ? SlaveKeyDeltasFlag_Overflow : 0) |
+        (includeKeyStates ? SlaveKeyDeltasFlag_KeyStates : 0) |
+        (eventCount ? SlaveKeyDeltasFlag_Events : 0);
+    uint8_t length = 1;
+    if (eventCount) {
+        buffer[length++] = eventCount;
+        memcpy(buffer + length, &ticksSinceLastEvent, sizeof(ticksSinceLastEvent));
+        length += sizeof(ticksSinceLastEvent);
+        memcpy(buffer + length, events, eventCount * sizeof(slave_key_event_t));
+        length += eventCount * sizeof(slave_key_event_t);
+    }
+    if (includeKeyStates) {
+        KeyMatrix_GetKeyStateBits(&keyMatrix, buffer + length);
+        length += BOOL_BYTES_TO_BITS_COUNT(MODULE_KEY_COUNT);
+    }
+
+    EnableGlobalIRQ(primask);
+    return length;
+}
@@ -0,0 +1,20 @@
+#ifndef __KEY_EVENTS_H__
+#define __KEY_EVENTS_H__
+
+// Includes:
+
+    #include "fsl_common.h"
+    #include "slave_protocol.h"
+
+// Macros:
+
+    #define KEY_EVENT_QUEUE_LENGTH 32
+
+// Functions:
+
+    void KeyEvents_Tick(void);
+    void KeyEvents_Push(uint8_t keyId, bool isPressed);
+    uint8_t KeyEvents_Serialize(uint8_t *buffer, bool includeKeyStates);
+    uint8_t KeyEvents_SerializeDeltas(uint8_t *buffer, uint8_t requestFlags);
+
+#endif
@@ -1,10 +1,24 @@
 #include "fsl_lptmr.h"
 #include "key_scanner.h"
 #include "i2c_watchdog.h"
+#include "key_events.h"
 
 void KEY_SCANNER_HANDLER(void)
 {
+    uint8_t rowId = keyMatrix.currentRowNum;
+    uint32_t previousRowState = keyMatrix.rowStates[rowId];
+
     KeyMatrix_ScanRow(&keyMatrix);
+    KeyEvents_Tick();
+
+    uint32_t rowState = keyMatrix.rowStates[rowId];
+    uint32_t changedCols = rowState ^ previousRowState;
+    for (uint8_t colId = 0; changedCols; colId++, changedCols >>= 1) {
+        if (changedCols & 1) {
+            KeyEvents_Push(rowId * KEYBOARD_MATRIX_COLS_NUM + colId, rowState & (1 << colId));
+        }
+    }
+
     RunWatchdog();
     LPTMR_ClearStatusFlags(KEY_SCANNER_LPTMR_BASEADDR, kLPTMR_TimerCompareFlag);
 }
@@ -10,6 +10,7 @@ DEFINE_BOOTLOADER_CONFIG_AREA(I2C_ADDRESS_LEFT_KEYBOARD_HALF_BOOTLOADER)
 key_matrix_t keyMatrix = {
     .colNum = KEYBOARD_MATRIX_COLS_NUM,
     .rowNum = KEYBOARD_MATRIX_ROWS_NUM,
+    .scanMode = KeyMatrixScanMode_PortWide,
     .cols = (key_matrix_pin_t[]) {
         {PORTB, GPIOB, kCLOCK_PortB, 11},
         {PORTA, GPIOA, kCLOCK_PortA,  6},
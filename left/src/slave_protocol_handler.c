@@ -11,6 +11,8 @@
 #include "bootloader.h"
 #include "module.h"
 #include "versions.h"
+#include "key_scanner.h"
+#include "key_events.h"
 
 i2c_message_t RxMessage;
 i2c_message_t TxMessage;
@@ -27,8 +29,47 @@ static version_t firmwareVersion = {
     FIRMWARE_PATCH_VERSION,
 };
 
+// The master reads the reply of a request either in a separate transfer or after a repeated start that directly
+// follows the request. Either way, a read is only answered with the reply of the request received since the
+// previous read, so that a read after a truncated or corrupted request can't be taken for the reply of an older one.
+static bool isRequestPending;
+
+// Applies a command that has no reply. Returns false if the command isn't one of them.
+static bool applyCommand(uint8_t commandId, const uint8_t *value, uint8_t length)
+{
+    switch (commandId) {
+        case SlaveCommand_SetTestLed:
+            if (length >= 1) {
+                TestLed_Set(value[0]);
+            }
+            return true;
+        case SlaveCommand_SetLedPwmBrightness:
+            if (length >= 1) {
+                LedPwm_SetBrightness(value[0]);
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void applyBatch(void)
+{
+    uint16_t position = 1;
+    while (position + sizeof(slave_batch_command_header_t) <= RxMessage.length) {
+        slave_batch_command_header_t *header = (slave_batch_command_header_t*)(RxMessage.data + position);
+        position += sizeof(slave_batch_command_header_t);
+        if (position + header->length > RxMessage.length) {
+            break;
+        }
+        applyCommand(header->commandId, RxMessage.data + position, header->length);
+        position += header->length;
+    }
+}
+
 void SlaveRxHandler(void)
 {
+    isRequestPending = false;
     if (!CRC16_IsMessageValid(&RxMessage)) {
         TxMessage.length = 0;
         return;
@@ -39,21 +80,29 @@ void SlaveRxHandler(void)
         case SlaveCommand_JumpToBootloader:
             NVIC_SystemReset();
             break;
-        case SlaveCommand_SetTestLed:
+        case SlaveCommand_Batch:
             TxMessage.length = 0;
-            bool isLedOn = RxMessage.data[1];
-            TestLed_Set(isLedOn);
+            applyBatch();
             break;
-        case SlaveCommand_SetLedPwmBrightness:
-            TxMessage.length = 0;
-            uint8_t brightnessPercent = RxMessage.data[1];
-            LedPwm_SetBrightness(brightnessPercent);
+        default:
+            if (applyCommand(commandId, RxMessage.data + 1, RxMessage.length ? RxMessage.length - 1 : 0)) {
+                TxMessage.length = 0;
+            } else {
+                isRequestPending = true;
+            }
             break;
     }
 }
 
 void SlaveTxHandler(void)
 {
+    TxMessage.length = 0;
+    if (!isRequestPending) {
+        CRC16_UpdateMessageChecksum(&TxMessage);
+        return;
+    }
+    isRequestPending = false;
+
     uint8_t commandId = RxMessage.data[0];
     switch (commandId) {
         case SlaveCommand_RequestProperty: {
@@ -89,13 +138,37 @@ void SlaveTxHandler(void)
                     TxMessage.length = 1;
                     break;
                 }
+                case SlaveProperty_KeyEventTickUsec: {
+                    uint16_t keyEventTickUsec = KEY_SCANNER_INTERVAL_USEC;
+                    memcpy(TxMessage.data, &keyEventTickUsec, sizeof(keyEventTickUsec));
+                    TxMessage.length = sizeof(keyEventTickUsec);
+                    break;
+                }
+                case SlaveProperty_Identity: {
+                    slave_identity_t *identity = (slave_identity_t*)TxMessage.data;
+                    memcpy(identity->sync, SlaveSyncString, SLAVE_SYNC_STRING_LENGTH);
+                    identity->moduleProtocolVersion = moduleProtocolVersion;
+                    identity->firmwareVersion = firmwareVersion;
+                    identity->moduleId = MODULE_ID;
+                    identity->keyCount = MODULE_KEY_COUNT;
+                    identity->pointerCount = MODULE_POINTER_COUNT;
+                    identity->keyEventTickUsec = KEY_SCANNER_INTERVAL_USEC;
+                    TxMessage.length = sizeof(slave_identity_t);
+                    break;
+                }
             }
             break;
         }
         case SlaveCommand_RequestKeyStates:
-            BoolBytesToBits(keyMatrix.keyStates, TxMessage.data, MODULE_KEY_COUNT);
+            KeyMatrix_GetKeyStateBits(&keyMatrix, TxMessage.data);
             TxMessage.length = BOOL_BYTES_TO_BITS_COUNT(MODULE_KEY_COUNT);
             break;
+        case SlaveCommand_RequestKeyEvents:
+            TxMessage.length = KeyEvents_Serialize(TxMessage.data, RxMessage.data[1]);
+            break;
+        case SlaveCommand_RequestKeyDeltas:
+            TxMessage.length = KeyEvents_SerializeDeltas(TxMessage.data, RxMessage.data[1]);
+            break;
     }
 
     CRC16_UpdateMessageChecksum(&TxMessage);
@@ -9,6 +9,7 @@
 #include "slave_scheduler.h"
 #include "slave_drivers/is31fl3731_driver.h"
 #include "config.h"
+#include "debounce.h"
 
 static parser_error_t parseModuleConfiguration(config_buffer_t *buffer)
 {
@@ -90,6 +91,47 @@ parser_error_t ParseConfig(config_buffer_t *buffer)
         return ParserError_InvalidMouseKineticProperty;
     }
 
+    // Debouncing, which is only present as of user config 4.2.0
+
+    bool hasDebounceProperties = dataModelMajorVersion > 4 || (dataModelMajorVersion == 4 && dataModelMinorVersion >= 2);
+    bool hasAdaptiveDebounceProperties = dataModelMajorVersion > 4 || (dataModelMajorVersion == 4 && dataModelMinorVersion >= 3);
+    uint8_t debounceStrategy = DebounceStrategy_Eager;
+    uint8_t debounceTimePress = DEBOUNCE_DEFAULT_TIME_MSEC;
+    uint8_t debounceTimeRelease = DEBOUNCE_DEFAULT_TIME_MSEC;
+    uint8_t slotDebounceStrategies[SLOT_COUNT] = {DebounceStrategy_UseGlobal};
+    bool debounceAdaptive = false;
+    uint8_t debounceAdaptiveMinTime = DEBOUNCE_ADAPTIVE_DEFAULT_MIN_TIME_MSEC;
+    uint8_t debounceAdaptiveMaxTime = DEBOUNCE_ADAPTIVE_DEFAULT_MAX_TIME_MSEC;
+
+    if (hasDebounceProperties) {
+        debounceStrategy = ReadUInt8(buffer);
+        debounceTimePress = ReadUInt8(buffer);
+        debounceTimeRelease = ReadUInt8(buffer);
+        for (uint8_t slotId = 0; slotId < SLOT_COUNT; slotId++) {
+            slotDebounceStrategies[slotId] = ReadUInt8(buffer);
+            if (slotDebounceStrategies[slotId] > DebounceStrategy_Last) {
+                return ParserError_InvalidDebounceStrategy;
+            }
+        }
+        if (debounceStrategy == DebounceStrategy_UseGlobal || debounceStrategy > DebounceStrategy_Last) {
+            return ParserError_InvalidDebounceStrategy;
+        }
+        if (debounceTimePress > DEBOUNCE_MAX_TIME_MSEC || debounceTimeRelease > DEBOUNCE_MAX_TIME_MSEC) {
+            return ParserError_InvalidDebounceTime;
+        }
+    }
+
+    // Adaptive debouncing, which is only present as of user config 4.3.0
+
+    if (hasAdaptiveDebounceProperties) {
+        debounceAdaptive = ReadBool(buffer);
+        debounceAdaptiveMinTime = ReadUInt8(buffer);
+        debounceAdaptiveMaxTime = ReadUInt8(buffer);
+        if (debounceAdaptiveMinTime > debounceAdaptiveMaxTime || debounceAdaptiveMaxTime > DEBOUNCE_MAX_TIME_MSEC) {
+            return ParserError_InvalidDebounceTime;
+        }
+    }
+
     // Module configurations
 
     uint16_t moduleConfigurationCount = ReadCompactLength(buffer);
@@ -162,6 +204,21 @@ parser_error_t ParseConfig(config_buffer_t *buffer)
         MouseScrollState.baseSpeed = mouseScrollBaseSpeed;
         MouseScrollState.acceleratedSpeed = mouseScrollAcceleratedSpeed;
 
+        // Update debouncing. Older configs leave the values set via UsbCommand_SetVariable() alone.
+
+        if (hasDebounceProperties) {
+            DebounceStrategy = debounceStrategy;
+            DebounceTimePress = debounceTimePress;
+            DebounceTimeRelease = debounceTimeRelease;
+            for (uint8_t slotId = 0; slotId < SLOT_COUNT; slotId++) {
+                SlotDebounceStrategies[slotId] = slotDebounceStrategies[slotId];
+            }
+            DebounceAdaptive = debounceAdaptive;
+            DebounceAdaptiveMinTime = debounceAdaptiveMinTime;
+            DebounceAdaptiveMaxTime = debounceAdaptiveMaxTime;
+            Debounce_ResetKeyStats();
+        }
+
         // Update counts
 
         AllKeymapsCount = keymapCount;
@@ -23,6 +23,8 @@
         ParserError_InvalidMacroCount                   = 12,
         ParserError_InvalidSerializedPlayMacroAction    = 13,
         ParserError_InvalidMouseKineticProperty         = 14,
+        ParserError_InvalidDebounceStrategy             = 15,
+        ParserError_InvalidDebounceTime                 = 16,
     } parser_error_t;
 
 // Functions:
@@ -0,0 +1,251 @@
+#include "debounce.h"
+#include "key_states.h"
+#include "timer.h"
+
+uint8_t DebounceTimePress = DEBOUNCE_DEFAULT_TIME_MSEC, DebounceTimeRelease = DEBOUNCE_DEFAULT_TIME_MSEC;
+debounce_strategy_t DebounceStrategy = DebounceStrategy_Eager;
+debounce_strategy_t SlotDebounceStrategies[SLOT_COUNT];
+bool DebounceAdaptive = false;
+uint8_t DebounceAdaptiveMinTime = DEBOUNCE_ADAPTIVE_DEFAULT_MIN_TIME_MSEC;
+uint8_t DebounceAdaptiveMaxTime = DEBOUNCE_ADAPTIVE_DEFAULT_MAX_TIME_MSEC;
+debounce_key_stats_t DebounceKeyStats[SLOT_COUNT][MAX_KEY_COUNT_PER_MODULE];
+
+static uint32_t previousUpdateTime;
+static uint64_t previousRawStates[SLOT_COUNT];
+static uint64_t settlingKeys[SLOT_COUNT];
+static uint64_t edgeOriginStates[SLOT_COUNT];
+
+static uint8_t clampDebounceTime(uint16_t debounceTime)
+{
+    return MAX(DebounceAdaptiveMinTime, MIN(DebounceAdaptiveMaxTime, debounceTime));
+}
+
+static void growDebounceTime(debounce_key_stats_t *stats, uint16_t time)
+{
+    if (2 * time > stats->debounceTime) {
+        stats->debounceTime = clampDebounceTime(2 * time);
+    }
+}
+
+// The debounce time never shrinks below twice the shortest glitch time and twice the longest glitch spacing of
+// the key, so that the noise that it has shown once stays within the lockout.
+static uint8_t getMinDebounceTime(debounce_key_stats_t *stats)
+{
+    uint16_t minTime = 2 * stats->maxGlitchSpacing;
+    if (stats->shortestGlitchTime != UINT8_MAX) {
+        minTime = MAX(minTime, 2 * stats->shortestGlitchTime);
+    }
+    return clampDebounceTime(minTime);
+}
+
+// Shrinks the debounce time toward twice the longest settle time of the last DEBOUNCE_ADAPTIVE_SHRINK_EDGE_COUNT
+// edges once they have settled.
+static void adaptDebounceTime(debounce_key_stats_t *stats, uint8_t settleTime)
+{
+    stats->maxSettleTime = MAX(stats->maxSettleTime, settleTime);
+    if (++stats->shrinkEdgeCount >= DEBOUNCE_ADAPTIVE_SHRINK_EDGE_COUNT) {
+        uint8_t targetTime = MAX(clampDebounceTime(2 * stats->maxSettleTime), getMinDebounceTime(stats));
+        if (stats->debounceTime > targetTime) {
+            stats->debounceTime -= (stats->debounceTime - targetTime + 1) / 2;
+        }
+        stats->maxSettleTime = 0;
+        stats->shrinkEdgeCount = 0;
+    }
+}
+
+static void countChatter(debounce_key_stats_t *stats)
+{
+    if (stats->chatterCount < UINT16_MAX) {
+        stats->chatterCount++;
+    }
+}
+
+// Every transition within the debounce time of the start of its edge, or of the edge before it when it starts a
+// new one, grows the debounce time right away. An edge that settles back to the state that it started from is a
+// glitch, which grows the debounce time to twice its time from the start of the edge before it, as the lockout of
+// that edge should have covered it. Glitches beyond DebounceAdaptiveMaxTime can't be covered, so they are only
+// counted.
+static void trackChatter(uint8_t slotId, uint8_t keyId, bool isTransition, bool isPressed)
+{
+    debounce_key_stats_t *stats = &DebounceKeyStats[slotId][keyId];
+    uint64_t keyBit = KEY_STATE_BIT(keyId);
+    uint16_t now = CurrentTime;
+
+    if (!stats->debounceTime) {
+        stats->debounceTime = clampDebounceTime(MAX(DebounceTimePress, DebounceTimeRelease));
+        stats->shortestGlitchTime = UINT8_MAX;
+        stats->edgeStartTime = now - UINT8_MAX;
+    }
+
+    if (isTransition) {
+        uint16_t edgeTime;
+        if (settlingKeys[slotId] & keyBit) {
+            uint16_t glitchTime = now - stats->lastTransitionTime;
+            stats->shortestGlitchTime = MIN(stats->shortestGlitchTime, glitchTime);
+            countChatter(stats);
+            edgeTime = now - stats->edgeStartTime;
+        } else {
+            settlingKeys[slotId] |= keyBit;
+            edgeOriginStates[slotId] = (edgeOriginStates[slotId] & ~keyBit) | (isPressed ? 0 : keyBit);
+            stats->previousEdgeStartTime = stats->edgeStartTime;
+            stats->edgeStartTime = now;
+            if (stats->edgeCount < UINT16_MAX) {
+                stats->edgeCount++;
+            }
+            edgeTime = now - stats->previousEdgeStartTime;
+        }
+        stats->lastTransitionTime = now;
+
+        if (edgeTime <= stats->debounceTime) {
+            growDebounceTime(stats, edgeTime);
+        }
+    } else if ((uint16_t)(now - stats->lastTransitionTime) >= DEBOUNCE_ADAPTIVE_MAX_GLITCH_MSEC) {
+        settlingKeys[slotId] &= ~keyBit;
+        if (!(edgeOriginStates[slotId] & keyBit) == !isPressed) {
+            uint16_t glitchSpacing = stats->edgeStartTime - stats->previousEdgeStartTime;
+            if (glitchSpacing <= DebounceAdaptiveMaxTime) {
+                stats->maxGlitchSpacing = MAX(stats->maxGlitchSpacing, glitchSpacing);
+                growDebounceTime(stats, glitchSpacing);
+            }
+            countChatter(stats);
+        }
+        adaptDebounceTime(stats, MIN((uint16_t)(stats->lastTransitionTime - stats->edgeStartTime), UINT8_MAX));
+    }
+}
+
+// A key that hasn't had an edge since the statistics were reset, such as one that is still locked out from before,
+// keeps the fixed debounce time until its adaptive debounce time starts from it.
+static uint8_t getDebounceTime(uint8_t slotId, uint8_t keyId, bool isPress)
+{
+    uint8_t adaptiveDebounceTime = DebounceKeyStats[slotId][keyId].debounceTime;
+    if (DebounceAdaptive && adaptiveDebounceTime) {
+        return adaptiveDebounceTime;
+    }
+    return isPress ? DebounceTimePress : DebounceTimeRelease;
+}
+
+// The current bitmap holds the raw states of the last scan on entry and the debounced states on return.
+// Only the keys that changed or are still debouncing are visited, every other key keeps its state.
+
+static void debounceEager(uint8_t slotId, uint8_t keyId)
+{
+    slot_key_states_t *slotKeyStates = &SlotKeyStates[slotId];
+    key_state_t *keyState = &KeyStates[slotId][keyId];
+    uint64_t keyBit = KEY_STATE_BIT(keyId);
+
+    if (slotKeyStates->debouncing & keyBit) {
+        uint8_t debounceTimeOut = getDebounceTime(slotId, keyId, slotKeyStates->previous & keyBit);
+        if ((uint8_t)(CurrentTime - keyState->timestamp) > debounceTimeOut) {
+            slotKeyStates->debouncing &= ~keyBit;
+        } else {
+            slotKeyStates->current = (slotKeyStates->current & ~keyBit) | (slotKeyStates->previous & keyBit);
+        }
+    } else {
+        keyState->timestamp = CurrentTime;
+        slotKeyStates->debouncing |= keyBit;
+    }
+}
+
+static void debounceDeferred(uint8_t slotId, uint8_t keyId)
+{
+    slot_key_states_t *slotKeyStates = &SlotKeyStates[slotId];
+    key_state_t *keyState = &KeyStates[slotId][keyId];
+    uint64_t keyBit = KEY_STATE_BIT(keyId);
+
+    if (!((slotKeyStates->current ^ slotKeyStates->previous) & keyBit)) {
+        // Bounced back before the debounce time elapsed.
+        slotKeyStates->debouncing &= ~keyBit;
+        return;
+    }
+
+    uint8_t debounceTimeOut = getDebounceTime(slotId, keyId, !(slotKeyStates->previous & keyBit));
+    if (!(slotKeyStates->debouncing & keyBit)) {
+        keyState->timestamp = CurrentTime;
+        slotKeyStates->debouncing |= keyBit;
+    } else if ((uint8_t)(CurrentTime - keyState->timestamp) > debounceTimeOut) {
+        slotKeyStates->debouncing &= ~keyBit;
+        return;
+    }
+    slotKeyStates->current ^= keyBit;
+}
+
+static void debounceIntegrator(uint8_t slotId, uint8_t keyId, uint8_t elapsedTime)
+{
+    slot_key_states_t *slotKeyStates = &SlotKeyStates[slotId];
+    key_state_t *keyState = &KeyStates[slotId][keyId];
+    uint64_t keyBit = KEY_STATE_BIT(keyId);
+
+    if (!((slotKeyStates->current ^ slotKeyStates->previous) & keyBit)) {
+        keyState->integratedTime = keyState->integratedTime > elapsedTime ? keyState->integratedTime - elapsedTime : 0;
+        if (!keyState->integratedTime) {
+            slotKeyStates->debouncing &= ~keyBit;
+        }
+        return;
+    }
+
+    uint8_t debounceTimeOut = getDebounceTime(slotId, keyId, !(slotKeyStates->previous & keyBit));
+    uint16_t integratedTime = keyState->integratedTime + elapsedTime;
+    if (integratedTime > debounceTimeOut) {
+        keyState->integratedTime = 0;
+        slotKeyStates->debouncing &= ~keyBit;
+    } else {
+        keyState->integratedTime = integratedTime;
+        slotKeyStates->debouncing |= keyBit;
+        slotKeyStates->current ^= keyBit;
+    }
+}
+
+debounce_strategy_t Debounce_GetSlotStrategy(uint8_t slotId)
+{
+    debounce_strategy_t strategy = SlotDebounceStrategies[slotId];
+    return strategy == DebounceStrategy_UseGlobal ? DebounceStrategy : strategy;
+}
+
+void Debounce_UpdateKeyStates(void)
+{
+    uint32_t elapsedTime = CurrentTime - previousUpdateTime;
+    previousUpdateTime = CurrentTime;
+    if (elapsedTime > UINT8_MAX) {
+        elapsedTime = UINT8_MAX;
+    }
+
+    for (uint8_t slotId = 0; slotId < SLOT_COUNT; slotId++) {
+        slot_key_states_t *slotKeyStates = &SlotKeyStates[slotId];
+        debounce_strategy_t strategy = Debounce_GetSlotStrategy(slotId);
+        uint64_t transitions = slotKeyStates->current ^ previousRawStates[slotId];
+        uint64_t keysToVisit = (slotKeyStates->current ^ slotKeyStates->previous) | slotKeyStates->debouncing;
+
+        previousRawStates[slotId] = slotKeyStates->current;
+
+        if (DebounceAdaptive) {
+            uint64_t keysToTrack = transitions | settlingKeys[slotId];
+            while (keysToTrack) {
+                uint8_t keyId = KeyStates_PopKeyId(&keysToTrack);
+                uint64_t keyBit = KEY_STATE_BIT(keyId);
+                trackChatter(slotId, keyId, transitions & keyBit, slotKeyStates->current & keyBit);
+            }
+        }
+
+        while (keysToVisit) {
+            uint8_t keyId = KeyStates_PopKeyId(&keysToVisit);
+            switch (strategy) {
+                case DebounceStrategy_Deferred:
+                    debounceDeferred(slotId, keyId);
+                    break;
+                case DebounceStrategy_Integrator:
+                    debounceIntegrator(slotId, keyId, elapsedTime);
+                    break;
+                default:
+                    debounceEager(slotId, keyId);
+                    break;
+            }
+        }
+    }
+}
+
+void Debounce_ResetKeyStats(void)
+{
+    memset(DebounceKeyStats, 0, sizeof(DebounceKeyStats));
+    memset(settlingKeys, 0, sizeof(settlingKeys));
+    memset(edgeOriginStates, 0, sizeof(edgeOriginStates));
+}
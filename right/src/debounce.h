@@ -0,0 +1,77 @@
+#ifndef __DEBOUNCE_H__
+#define __DEBOUNCE_H__
+
+// Includes:
+
+    #include "fsl_common.h"
+    #include "slot.h"
+    #include "module.h"
+
+// Macros:
+
+    #define DEBOUNCE_DEFAULT_TIME_MSEC 50
+
+    // The 8-bit debounce timers can't exceed 255 ms, so a debounce time of 255 ms would never run out.
+    #define DEBOUNCE_MAX_TIME_MSEC 254
+
+    #define DEBOUNCE_ADAPTIVE_DEFAULT_MIN_TIME_MSEC 5
+    #define DEBOUNCE_ADAPTIVE_DEFAULT_MAX_TIME_MSEC DEBOUNCE_DEFAULT_TIME_MSEC
+
+    // Transitions closer to the previous one than this are chatter, as nobody can tap a key that fast.
+    #define DEBOUNCE_ADAPTIVE_MAX_GLITCH_MSEC 20
+
+    // The debounce time of a key shrinks toward twice its longest settle time once every this many edges, but never
+    // below twice its shortest glitch time or its longest glitch spacing.
+    #define DEBOUNCE_ADAPTIVE_SHRINK_EDGE_COUNT 8
+
+// Typedefs:
+
+    // The worst-case latency that a strategy adds to a key event, on top of scanning and USB polling.
+    // The debounce time is DebounceTimePress for presses and DebounceTimeRelease for releases, or the debounceTime of
+    // the key with DebounceAdaptive.
+    typedef enum {
+        DebounceStrategy_UseGlobal,   // Only valid per slot: use DebounceStrategy
+        DebounceStrategy_Eager,       // 0 ms. An edge is reported right away, then the key is locked for the debounce time
+                                      // of that edge, so an opposite edge within the lockout is delayed by up to that time.
+        DebounceStrategy_Deferred,    // The debounce time, counted from the last bounce. An edge is only reported once the
+                                      // key has been stable for the debounce time, every bounce restarts the wait.
+        DebounceStrategy_Integrator,  // The debounce time plus twice the bounce time spent in the old state. The time spent in
+                                      // the new state is integrated, the time spent in the old state is subtracted, and the
+                                      // edge is reported once the integral exceeds the debounce time.
+        DebounceStrategy_Last = DebounceStrategy_Integrator,
+    } debounce_strategy_t;
+
+    // The chatter statistics of a key. An edge starts with a transition after a stable period and settles once
+    // no transition follows within DEBOUNCE_ADAPTIVE_MAX_GLITCH_MSEC. An edge that settles back to the state that
+    // it started from is a glitch.
+    typedef struct {
+        uint8_t debounceTime;        // The effective debounce time of both edges with DebounceAdaptive, 0 until the first edge,
+                                     // which starts it at the fixed debounce time
+        uint8_t maxSettleTime;       // The longest time from the first to the last transition of an edge since the last shrink
+        uint8_t shortestGlitchTime;  // The shortest time between two transitions of an edge, UINT8_MAX if there was none
+        uint8_t maxGlitchSpacing;    // The longest time from the start of an edge to a glitch within DebounceAdaptiveMaxTime
+                                     // of it, 0 if there was none
+        uint8_t shrinkEdgeCount;     // Edges since the last shrink
+        uint16_t edgeCount;
+        uint16_t chatterCount;       // Transitions of edges other than the first one, and glitches
+        uint16_t previousEdgeStartTime;
+        uint16_t edgeStartTime;
+        uint16_t lastTransitionTime;
+    } debounce_key_stats_t;
+
+// Variables:
+
+    extern uint8_t DebounceTimePress, DebounceTimeRelease;
+    extern debounce_strategy_t DebounceStrategy;
+    extern debounce_strategy_t SlotDebounceStrategies[SLOT_COUNT];
+    extern bool DebounceAdaptive;
+    extern uint8_t DebounceAdaptiveMinTime, DebounceAdaptiveMaxTime;
+    extern debounce_key_stats_t DebounceKeyStats[SLOT_COUNT][MAX_KEY_COUNT_PER_MODULE];
+
+// Functions:
+
+    debounce_strategy_t Debounce_GetSlotStrategy(uint8_t slotId);
+    void Debounce_UpdateKeyStates(void);
+    void Debounce_ResetKeyStats(void);
+
+#endif
@@ -1,11 +1,19 @@
 #include "i2c.h"
 #include "crc16.h"
+#include "timer.h"
 
 i2c_master_handle_t I2cMasterHandle;
 i2c_master_transfer_t masterTransfer;
+uint32_t I2cRepeatedStartMicros;
+
+static i2c_message_t *writeReadRxMessage;
+static uint16_t writeReadTxByteCount;
+static i2c_master_transfer_callback_t writeReadCallback;
 
 status_t I2cAsyncWrite(uint8_t i2cAddress, uint8_t *data, size_t dataSize)
 {
+    writeReadTxByteCount = 0;
+    masterTransfer.flags = kI2C_TransferDefaultFlag;
     masterTransfer.slaveAddress = i2cAddress;
     masterTransfer.direction = kI2C_Write;
     masterTransfer.data = data;
@@ -16,6 +24,8 @@ status_t I2cAsyncWrite(uint8_t i2cAddress, uint8_t *data, size_t dataSize)
 
 status_t I2cAsyncWriteMessage(uint8_t i2cAddress, i2c_message_t *message)
 {
+    writeReadTxByteCount = 0;
+    masterTransfer.flags = kI2C_TransferDefaultFlag;
     masterTransfer.slaveAddress = i2cAddress;
     masterTransfer.direction = kI2C_Write;
     masterTransfer.data = (uint8_t*)message;
@@ -27,6 +37,8 @@ status_t I2cAsyncWriteMessage(uint8_t i2cAddress, i2c_message_t *message)
 
 status_t I2cAsyncRead(uint8_t i2cAddress, uint8_t *data, size_t dataSize)
 {
+    writeReadTxByteCount = 0;
+    masterTransfer.flags = kI2C_TransferDefaultFlag;
     masterTransfer.slaveAddress = i2cAddress;
     masterTransfer.direction = kI2C_Read;
     masterTransfer.data = data;
@@ -37,6 +49,8 @@ status_t I2cAsyncRead(uint8_t i2cAddress, uint8_t *data, size_t dataSize)
 
 status_t I2cAsyncReadMessage(uint8_t i2cAddress, i2c_message_t *message)
 {
+    writeReadTxByteCount = 0;
+    masterTransfer.flags = kI2C_TransferDefaultFlag;
     masterTransfer.slaveAddress = i2cAddress;
     masterTransfer.direction = kI2C_Read;
     masterTransfer.data = (uint8_t*)message;
@@ -44,3 +58,58 @@ status_t I2cAsyncReadMessage(uint8_t i2cAddress, i2c_message_t *message)
     I2cMasterHandle.userData = (void*)1;
     return I2C_MasterTransferNonBlocking(I2C_MAIN_BUS_BASEADDR, &I2cMasterHandle, &masterTransfer);
 }
+
+// Called from the I2C interrupt when the write of I2cAsyncWriteReadMessage() completes. The bus is still held
+// without a stop condition, so the read is started with a repeated start right away, and the original callback
+// of the handle only gets called when the read completes or either part fails.
+static void writeReadMessageCallback(I2C_Type *base, i2c_master_handle_t *handle, status_t status, void *userData)
+{
+    handle->completionCallback = writeReadCallback;
+
+    if (status == kStatus_Success) {
+        I2cRepeatedStartMicros = Timer_GetCurrentTimeMicros();
+        masterTransfer.flags = kI2C_TransferRepeatedStartFlag;
+        masterTransfer.direction = kI2C_Read;
+        masterTransfer.data = (uint8_t*)writeReadRxMessage;
+        masterTransfer.dataSize = I2C_MESSAGE_MAX_TOTAL_LENGTH;
+        handle->userData = (void*)1;
+        status = I2C_MasterTransferNonBlocking(base, handle, &masterTransfer);
+        if (status == kStatus_Success) {
+            return;
+        }
+    }
+
+    handle->completionCallback(base, handle, status, handle->userData);
+}
+
+status_t I2cAsyncWriteReadMessage(uint8_t i2cAddress, i2c_message_t *txMessage, i2c_message_t *rxMessage)
+{
+    masterTransfer.flags = kI2C_TransferNoStopFlag;
+    masterTransfer.slaveAddress = i2cAddress;
+    masterTransfer.direction = kI2C_Write;
+    masterTransfer.data = (uint8_t*)txMessage;
+    masterTransfer.dataSize = I2C_MESSAGE_HEADER_LENGTH + txMessage->length;
+    CRC16_UpdateMessageChecksum(txMessage);
+
+    writeReadTxByteCount = masterTransfer.dataSize;
+    writeReadRxMessage = rxMessage;
+    writeReadCallback = I2cMasterHandle.completionCallback;
+    I2cMasterHandle.completionCallback = writeReadMessageCallback;
+    I2cMasterHandle.userData = NULL;
+
+    status_t status = I2C_MasterTransferNonBlocking(I2C_MAIN_BUS_BASEADDR, &I2cMasterHandle, &masterTransfer);
+    if (status != kStatus_Success) {
+        I2cMasterHandle.completionCallback = writeReadCallback;
+    }
+    return status;
+}
+
+uint16_t I2cGetTransferByteCount(void)
+{
+    uint16_t byteCount = masterTransfer.dataSize;
+    if (masterTransfer.direction == kI2C_Read && I2cMasterHandle.userData) {
+        i2c_message_t *message = (i2c_message_t*)masterTransfer.data;
+        byteCount = MIN(I2C_MESSAGE_HEADER_LENGTH + message->length, I2C_MESSAGE_MAX_TOTAL_LENGTH);
+    }
+    return writeReadTxByteCount + byteCount;
+}
@@ -48,6 +48,7 @@
 // Variables:
 
     extern i2c_master_handle_t I2cMasterHandle;
+    extern uint32_t I2cRepeatedStartMicros;  // When the read of the last I2cAsyncWriteReadMessage() started
 
 // Functions:
 
@@ -56,4 +57,12 @@
     status_t I2cAsyncWriteMessage(uint8_t i2cAddress, i2c_message_t *message);
     status_t I2cAsyncReadMessage(uint8_t i2cAddress, i2c_message_t *message);
 
+    // Writes txMessage, then reads the reply into rxMessage after a repeated start, as one bus transaction
+    // that completes with a single callback.
+    status_t I2cAsyncWriteReadMessage(uint8_t i2cAddress, i2c_message_t *txMessage, i2c_message_t *rxMessage);
+
+    // Returns the data bytes of the last successfully completed transfer, including the write of a combined
+    // transfer. Message reads end after the length byte, so their size is taken from the received length.
+    uint16_t I2cGetTransferByteCount(void);
+
 #endif
@@ -0,0 +1,127 @@
+#include "i2c.h"
+#include "i2c_baud_rate.h"
+#include "i2c_watchdog.h"
+#include "init_peripherals.h"
+#include "timer.h"
+
+bool I2cBaudRate_IsAdaptive;
+uint16_t I2cBaudRate_ChangeCount;
+i2c_baud_rate_change_t I2cBaudRate_History[I2C_BAUD_RATE_HISTORY_LENGTH];
+
+static const uint32_t baudRateSteps[] = {50000, 100000, 150000, 200000, 300000, 400000};
+
+#define BAUD_RATE_STEP_COUNT (sizeof(baudRateSteps) / sizeof(baudRateSteps[0]))
+
+static uint32_t windowStartMicros;
+static uint32_t windowRecoveryCount;
+static uint16_t windowTransferCount;
+static uint16_t windowErrorCount;
+static uint8_t stableWindowCount;
+static uint8_t ceilingStep = BAUD_RATE_STEP_COUNT;  // Steps from this one up are not to be tried
+static uint16_t ceilingWindowCount;                 // Windows until the ceiling is lifted
+
+static void startWindow(uint32_t now)
+{
+    windowStartMicros = now;
+    windowRecoveryCount = I2cWatchdog_RecoveryCounter;
+    windowTransferCount = 0;
+    windowErrorCount = 0;
+}
+
+static void recordChange(i2c_baud_rate_change_reason_t reason, uint16_t errorPerMille)
+{
+    i2c_baud_rate_change_t *change = I2cBaudRate_History + I2cBaudRate_ChangeCount % I2C_BAUD_RATE_HISTORY_LENGTH;
+    change->baudRateBps = I2cMainBusRequestedBaudRateBps;
+    change->time = CurrentTime;
+    change->errorPerMille = errorPerMille;
+    change->reason = reason;
+    I2cBaudRate_ChangeCount++;
+}
+
+// Only the divider of the running bus changes, so unlike ReinitI2cMainBus(), this neither aborts a transfer
+// nor restarts the slave scheduler.
+static void setStep(uint8_t step, i2c_baud_rate_change_reason_t reason, uint16_t errorPerMille)
+{
+    I2cMainBusRequestedBaudRateBps = baudRateSteps[step];
+    I2C_MasterSetBaudRate(I2C_MAIN_BUS_BASEADDR, I2cMainBusRequestedBaudRateBps, CLOCK_GetFreq(I2C_MAIN_BUS_CLK_SRC));
+    I2cMainBusActualBaudRateBps = I2C_ActualBaudRate;
+    recordChange(reason, errorPerMille);
+}
+
+// Returns the index of the highest step below the current baud rate, or -1.
+static int8_t getLowerStep(void)
+{
+    int8_t step = BAUD_RATE_STEP_COUNT - 1;
+    while (step >= 0 && baudRateSteps[step] >= I2cMainBusRequestedBaudRateBps) {
+        step--;
+    }
+    return step;
+}
+
+void I2cBaudRate_SetAdaptive(bool isAdaptive)
+{
+    I2cBaudRate_IsAdaptive = isAdaptive;
+    stableWindowCount = 0;
+    ceilingStep = BAUD_RATE_STEP_COUNT;
+    ceilingWindowCount = 0;
+    startWindow(Timer_GetCurrentTimeMicros());
+}
+
+void I2cBaudRate_RecordManualChange(void)
+{
+    recordChange(I2cBaudRateChangeReason_Manual, 0);
+    I2cBaudRate_SetAdaptive(I2cBaudRate_IsAdaptive);
+}
+
+void I2cBaudRate_LogTransfer(bool wasSlaveConnected, status_t status)
+{
+    // Absent slaves NAK every probe, which says nothing about the signal quality.
+    if (!wasSlaveConnected) {
+        return;
+    }
+    windowTransferCount++;
+    if (status != kStatus_Success) {
+        windowErrorCount++;
+    }
+}
+
+void I2cBaudRate_Update(uint32_t now)
+{
+    if (!I2cBaudRate_IsAdaptive || now - windowStartMicros < I2C_BAUD_RATE_WINDOW_USEC) {
+        return;
+    }
+
+    bool isRecovered = I2cWatchdog_RecoveryCounter != windowRecoveryCount;
+    if (!isRecovered && windowTransferCount < I2C_BAUD_RATE_MIN_WINDOW_TRANSFER_COUNT) {
+        return;
+    }
+
+    uint16_t errorPerMille = windowTransferCount ? windowErrorCount * 1000U / windowTransferCount : 1000;
+    int8_t lowerStep = getLowerStep();
+    uint8_t higherStep = lowerStep + 1;
+    if (higherStep < BAUD_RATE_STEP_COUNT && baudRateSteps[higherStep] == I2cMainBusRequestedBaudRateBps) {
+        higherStep++;
+    }
+
+    if (ceilingWindowCount && !--ceilingWindowCount) {
+        ceilingStep = BAUD_RATE_STEP_COUNT;
+    }
+
+    if (isRecovered || errorPerMille > I2C_BAUD_RATE_BACK_OFF_ERROR_PER_MILLE) {
+        stableWindowCount = 0;
+        if (lowerStep >= 0) {
+            ceilingStep = lowerStep + 1;
+            ceilingWindowCount = I2C_BAUD_RATE_RETRY_WINDOW_COUNT;
+            setStep(lowerStep, I2cBaudRateChangeReason_BackOff, errorPerMille);
+        }
+    } else if (errorPerMille > I2C_BAUD_RATE_RAISE_MAX_ERROR_PER_MILLE) {
+        stableWindowCount = 0;
+    } else if (++stableWindowCount >= I2C_BAUD_RATE_RAISE_WINDOW_COUNT) {
+        stableWindowCount = 0;
+        if (higherStep < ceilingStep) {
+            setStep(higherStep, I2cBaudRateChangeReason_Raise, errorPerMille);
+        }
+    }
+
+    startWindow(now);
+}
@@ -0,0 +1,56 @@
+#ifndef __I2C_BAUD_RATE_H__
+#define __I2C_BAUD_RATE_H__
+
+// Includes:
+
+    #include "fsl_common.h"
+
+// Macros:
+
+    // With I2cBaudRate_IsAdaptive, the errors of the transfers to connected slaves are counted over windows of
+    // this length that span at least I2C_BAUD_RATE_MIN_WINDOW_TRANSFER_COUNT transfers.
+    #define I2C_BAUD_RATE_WINDOW_USEC 250000
+    #define I2C_BAUD_RATE_MIN_WINDOW_TRANSFER_COUNT 100
+
+    // The baud rate is raised by a step after this many windows in a row with no more errors than
+    // I2C_BAUD_RATE_RAISE_MAX_ERROR_PER_MILLE, and backed off by a step after a window with more errors than
+    // I2C_BAUD_RATE_BACK_OFF_ERROR_PER_MILLE or a watchdog recovery. A rate that had to be backed off from is
+    // only retried after I2C_BAUD_RATE_RETRY_WINDOW_COUNT windows.
+    #define I2C_BAUD_RATE_RAISE_WINDOW_COUNT 8
+    #define I2C_BAUD_RATE_RAISE_MAX_ERROR_PER_MILLE 1
+    #define I2C_BAUD_RATE_BACK_OFF_ERROR_PER_MILLE 10
+    #define I2C_BAUD_RATE_RETRY_WINDOW_COUNT 240
+
+    #define I2C_BAUD_RATE_HISTORY_LENGTH 8
+
+// Typedefs:
+
+    typedef enum {
+        I2cBaudRateChangeReason_Manual,
+        I2cBaudRateChangeReason_Raise,
+        I2cBaudRateChangeReason_BackOff,
+    } i2c_baud_rate_change_reason_t;
+
+    typedef struct {
+        uint32_t baudRateBps;
+        uint32_t time;           // CurrentTime of the change
+        uint16_t errorPerMille;  // The error rate of the window that led to the change
+        i2c_baud_rate_change_reason_t reason;
+    } i2c_baud_rate_change_t;
+
+// Variables:
+
+    extern bool I2cBaudRate_IsAdaptive;
+    extern uint16_t I2cBaudRate_ChangeCount;
+    extern i2c_baud_rate_change_t I2cBaudRate_History[I2C_BAUD_RATE_HISTORY_LENGTH];  // Indexed by the change count
+
+// Functions:
+
+    void I2cBaudRate_SetAdaptive(bool isAdaptive);
+    void I2cBaudRate_RecordManualChange(void);
+    void I2cBaudRate_LogTransfer(bool wasSlaveConnected, status_t status);
+
+    // Must only be called between two transfers of the main bus.
+    void I2cBaudRate_Update(uint32_t now);
+
+#endif
@@ -1,7 +1,10 @@
 #include "fsl_i2c.h"
 #include "i2c_error_logger.h"
+#include "timer.h"
 
 i2c_slave_error_counter_t I2cSlaveErrorCounters[MAX_SLAVE_COUNT];
+i2c_slave_telemetry_t I2cSlaveTelemetry[MAX_SLAVE_COUNT];
+i2c_bus_telemetry_t I2cBusTelemetry;
 
 void LogI2cError(uint8_t slaveId, status_t status)
 {
@@ -23,3 +26,58 @@ void LogI2cError(uint8_t slaveId, status_t status)
         currentI2cError->count = 1;
     }
 }
+
+static uint8_t getHistogramBucket(uint32_t transferUsec)
+{
+    uint8_t bucket = 0;
+    for (uint32_t limitUsec = I2C_TRANSFER_HISTOGRAM_MIN_USEC; transferUsec >= limitUsec; limitUsec <<= 1) {
+        if (++bucket == I2C_TRANSFER_HISTOGRAM_BUCKET_COUNT - 1) {
+            break;
+        }
+    }
+    return bucket;
+}
+
+void LogI2cTransfer(uint8_t slaveId, status_t status, uint32_t transferUsec, uint16_t byteCount, bool isSpare)
+{
+    I2cBusTelemetry.busyUsec += transferUsec;
+    if (isSpare) {
+        I2cBusTelemetry.spareUsec += transferUsec;
+    }
+    if (status != kStatus_Success) {
+        return;
+    }
+
+    i2c_slave_telemetry_t *telemetry = I2cSlaveTelemetry + slaveId;
+    telemetry->transferCount++;
+    telemetry->byteCount += byteCount;
+    telemetry->transferUsecHistogram[getHistogramBucket(transferUsec)]++;
+}
+
+void LogI2cPoll(uint8_t slaveId, uint32_t pollGapUsec)
+{
+    i2c_slave_telemetry_t *telemetry = I2cSlaveTelemetry + slaveId;
+    telemetry->pollCount++;
+    telemetry->pollGapSumUsec += pollGapUsec;
+    if (pollGapUsec > telemetry->maxPollGapUsec) {
+        telemetry->maxPollGapUsec = pollGapUsec;
+    }
+}
+
+void LogI2cRecovery(uint8_t slaveId, uint32_t recoveryUsec)
+{
+    i2c_slave_telemetry_t *telemetry = I2cSlaveTelemetry + slaveId;
+    telemetry->recoveryCount++;
+    telemetry->recoveryUsecSum += recoveryUsec;
+    if (recoveryUsec > telemetry->maxRecoveryUsec) {
+        telemetry->maxRecoveryUsec = recoveryUsec;
+    }
+}
+
+void ResetI2cTelemetry(void)
+{
+    memset(I2cSlaveTelemetry, 0, sizeof(I2cSlaveTelemetry));
+    I2cBusTelemetry.busyUsec = 0;
+    I2cBusTelemetry.spareUsec = 0;
+    I2cBusTelemetry.startMicros = Timer_GetCurrentTimeMicros();
+}
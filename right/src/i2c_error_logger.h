@@ -10,6 +10,11 @@
 
     #define MAX_LOGGED_I2C_ERROR_TYPES_PER_SLAVE 7
 
+    // Bucket 0 counts the transfers shorter than I2C_TRANSFER_HISTOGRAM_MIN_USEC, every further bucket doubles
+    // the limit, and the last bucket counts everything longer.
+    #define I2C_TRANSFER_HISTOGRAM_BUCKET_COUNT 8
+    #define I2C_TRANSFER_HISTOGRAM_MIN_USEC 128
+
 // Typedefs:
 
     typedef struct {
@@ -22,12 +27,40 @@
         i2c_error_count_t errors[MAX_LOGGED_I2C_ERROR_TYPES_PER_SLAVE];
     } i2c_slave_error_counter_t;
 
+    typedef struct {
+        uint32_t transferCount;    // Successful transfers, a combined write-then-read counts as one
+        uint32_t byteCount;        // Data bytes of the successful transfers in both directions
+        uint32_t transferUsecHistogram[I2C_TRANSFER_HISTOGRAM_BUCKET_COUNT];
+        uint32_t pollCount;        // Polls that started while the slave was connected
+        uint64_t pollGapSumUsec;   // The time between the starts of two such polls
+        uint32_t maxPollGapUsec;
+        uint32_t recoveryCount;    // Bus recoveries after a transfer to the slave got stuck
+        uint32_t recoveryUsecSum;  // The time from the start of the stuck transfer to the recovery of the bus
+        uint32_t maxRecoveryUsec;
+    } i2c_slave_telemetry_t;
+
+    // Every transfer keeps the bus busy from its start to its completion callback, failed ones included. The slave
+    // scheduler never lets the bus go idle but polls ahead of the deadlines instead, so the bus is only as
+    // saturated as its busy time minus the spare time of such polls. The counters are meant to be read and reset
+    // well within the 71 minutes after which the microsecond timer wraps.
+    typedef struct {
+        uint32_t startMicros;
+        uint32_t busyUsec;
+        uint32_t spareUsec;
+    } i2c_bus_telemetry_t;
+
 // Variables:
 
     extern i2c_slave_error_counter_t I2cSlaveErrorCounters[MAX_SLAVE_COUNT];
+    extern i2c_slave_telemetry_t I2cSlaveTelemetry[MAX_SLAVE_COUNT];
+    extern i2c_bus_telemetry_t I2cBusTelemetry;
 
 // Functions:
 
     void LogI2cError(uint8_t slaveId, status_t status);
+    void LogI2cTransfer(uint8_t slaveId, status_t status, uint32_t transferUsec, uint16_t byteCount, bool isSpare);
+    void LogI2cPoll(uint8_t slaveId, uint32_t pollGapUsec);
+    void LogI2cRecovery(uint8_t slaveId, uint32_t recoveryUsec);
+    void ResetI2cTelemetry(void);
 
 #endif
@@ -12,8 +12,9 @@ uint32_t I2cWatchdog_RecoveryCounter;
 
 static uint32_t prevWatchdogCounter;
 
-// This function restarts and reinstalls the I2C handler when the I2C bus gets unresponsive
+// This function recovers the I2C bus and reinstalls the I2C handler when the I2C bus gets unresponsive
 // by a misbehaving I2C slave, or by disconnecting the left keyboard half or an add-on module.
+// Only the slave of the stuck transfer gets disconnected, the other slaves carry on where they were.
 // This method relies on a patched KSDK which increments I2C_Watchdog upon I2C transfers.
 void PIT_I2C_WATCHDOG_HANDLER(void)
 {
@@ -21,7 +22,7 @@ void PIT_I2C_WATCHDOG_HANDLER(void)
 
     if (I2C_Watchdog == prevWatchdogCounter) { // Restart I2C if there haven't been any interrupts recently
         I2cWatchdog_RecoveryCounter++;
-        ReinitI2cMainBus();
+        RecoverI2cMainBus();
     }
 
     prevWatchdogCounter = I2C_Watchdog;
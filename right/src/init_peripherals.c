@@ -15,6 +15,7 @@
 #include "usb_api.h"
 #include "slave_scheduler.h"
 #include "bootloader/wormhole.h"
+#include "crc16.h"
 
 bool IsBusPalOn;
 volatile uint32_t I2cMainBusRequestedBaudRateBps = I2C_MAIN_BUS_NORMAL_BAUD_RATE;
@@ -64,6 +65,7 @@ static void initInterruptPriorities(void)
 {
     NVIC_SetPriority(PIT_I2C_WATCHDOG_IRQ_ID,  1);
     NVIC_SetPriority(I2C_EEPROM_BUS_IRQ_ID,    0);
+    NVIC_SetPriority(PIT_KEY_SCANNER_IRQ_ID,   2);
     NVIC_SetPriority(PIT_TIMER_IRQ_ID,         3);
     NVIC_SetPriority(I2C_MAIN_BUS_IRQ_ID,      4);
     NVIC_SetPriority(USB_IRQ_ID,               4);
@@ -137,6 +139,16 @@ void ReinitI2cMainBus(void)
     InitSlaveScheduler();
 }
 
+// Aborts the stuck transfer and clears the bus by clocking SCL until the slave releases SDA, like
+// ReinitI2cMainBus(), but only the slave of the stuck transfer loses its state.
+void RecoverI2cMainBus(void)
+{
+    I2C_MasterTransferAbort(I2C_MAIN_BUS_BASEADDR, &I2cMasterHandle);
+    I2C_MasterDeinit(I2C_MAIN_BUS_BASEADDR);
+    initI2cBus(&i2cMainBus);
+    RecoverSlaveScheduler();
+}
+
 static void initI2c(void)
 {
     initI2cBus(&i2cMainBus);
@@ -152,6 +164,7 @@ void InitPeripherals(void)
     InitResetButton();
     InitMergeSensor();
     ADC_Init();
+    CRC16_Init();
     initI2c();
     TestLed_Init();
     LedPwm_Init();
@@ -33,5 +33,6 @@
 
     void InitPeripherals(void);
     void ReinitI2cMainBus(void);
+    void RecoverI2cMainBus(void);
 
 #endif
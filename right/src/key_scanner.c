@@ -0,0 +1,101 @@
+#include "fsl_pit.h"
+#include "key_scanner.h"
+#include "timer.h"
+#include "profiler.h"
+
+uint16_t KeyScanner_RowIntervalUsec = KEY_SCANNER_DEFAULT_ROW_INTERVAL_USEC;
+volatile key_scanner_stats_t KeyScanner_Stats;
+
+static uint32_t timerClockFrequency;
+static uint32_t timerPeriodCount;
+static uint16_t previousLatencyUsec;
+static bool isPreviousLatencyValid;
+static uint32_t frameRowStates[RIGHT_KEY_MATRIX_ROWS_NUM];
+
+static void updateStats(uint16_t latencyUsec)
+{
+    if (latencyUsec < KeyScanner_Stats.minLatencyUsec) {
+        KeyScanner_Stats.minLatencyUsec = latencyUsec;
+    }
+    if (latencyUsec > KeyScanner_Stats.maxLatencyUsec) {
+        KeyScanner_Stats.maxLatencyUsec = latencyUsec;
+    }
+
+    // The timer fires at a constant rate, so the sampling period only deviates by the difference of latencies.
+    if (isPreviousLatencyValid) {
+        uint16_t periodDeviationUsec = latencyUsec > previousLatencyUsec
+            ? latencyUsec - previousLatencyUsec
+            : previousLatencyUsec - latencyUsec;
+        if (periodDeviationUsec > KeyScanner_Stats.maxPeriodDeviationUsec) {
+            KeyScanner_Stats.maxPeriodDeviationUsec = periodDeviationUsec;
+        }
+    }
+    previousLatencyUsec = latencyUsec;
+    isPreviousLatencyValid = true;
+}
+
+// Scans one row of the matrix per interrupt and publishes the key states once every row has been scanned,
+// so the sampling rate doesn't depend on how busy the main loop is.
+void PIT_KEY_SCANNER_HANDLER(void)
+{
+    uint32_t elapsedCount = timerPeriodCount - PIT_GetCurrentTimerCount(PIT, PIT_KEY_SCANNER_CHANNEL);
+    updateStats(COUNT_TO_USEC(elapsedCount, timerClockFrequency));
+
+    PROFILER_START(ScanRow);
+    KeyMatrix_ScanRow(&RightKeyMatrix);
+    PROFILER_STOP(ScanRow);
+    ++MatrixScanCounter;
+
+    if (RightKeyMatrix.currentRowNum == 0) {
+        memcpy(frameRowStates, RightKeyMatrix.rowStates, sizeof(frameRowStates));
+        KeyScanner_Stats.frameCount++;
+    }
+
+    PIT_ClearStatusFlags(PIT, PIT_KEY_SCANNER_CHANNEL, kPIT_TimerFlag);
+}
+
+void KeyScanner_ResetStats(void)
+{
+    uint32_t primask = DisableGlobalIRQ();
+    KeyScanner_Stats.frameCount = 0;
+    KeyScanner_Stats.minLatencyUsec = UINT16_MAX;
+    KeyScanner_Stats.maxLatencyUsec = 0;
+    KeyScanner_Stats.maxPeriodDeviationUsec = 0;
+    isPreviousLatencyValid = false;
+    EnableGlobalIRQ(primask);
+}
+
+void KeyScanner_SetRowInterval(uint16_t rowIntervalUsec)
+{
+    KeyScanner_RowIntervalUsec = MAX(rowIntervalUsec, KEY_SCANNER_MIN_ROW_INTERVAL_USEC);
+    timerPeriodCount = USEC_TO_COUNT(KeyScanner_RowIntervalUsec, timerClockFrequency);
+    PIT_SetTimerPeriod(PIT, PIT_KEY_SCANNER_CHANNEL, timerPeriodCount);
+    KeyScanner_ResetStats();
+}
+
+// Returns the key states of the last completely scanned frame, bit n being the state of key n.
+uint64_t KeyScanner_GetFrame(void)
+{
+    uint32_t rowStates[RIGHT_KEY_MATRIX_ROWS_NUM];
+
+    uint32_t primask = DisableGlobalIRQ();
+    memcpy(rowStates, frameRowStates, sizeof(rowStates));
+    EnableGlobalIRQ(primask);
+
+    uint64_t keyStates = 0;
+    for (uint8_t rowId = 0; rowId < RIGHT_KEY_MATRIX_ROWS_NUM; rowId++) {
+        keyStates |= (uint64_t)rowStates[rowId] << (rowId * RIGHT_KEY_MATRIX_COLS_NUM);
+    }
+    return keyStates;
+}
+
+void InitKeyScanner(void)
+{
+    timerClockFrequency = PIT_SOURCE_CLOCK;
+    KeyMatrix_Init(&RightKeyMatrix);
+    KeyScanner_SetRowInterval(KeyScanner_RowIntervalUsec);
+
+    PIT_EnableInterrupts(PIT, PIT_KEY_SCANNER_CHANNEL, kPIT_TimerInterruptEnable);
+    EnableIRQ(PIT_KEY_SCANNER_IRQ_ID);
+    PIT_StartTimer(PIT, PIT_KEY_SCANNER_CHANNEL);
+}
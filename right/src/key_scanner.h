@@ -0,0 +1,35 @@
+#ifndef __KEY_SCANNER_H__
+#define __KEY_SCANNER_H__
+
+// Includes:
+
+    #include "fsl_common.h"
+    #include "right_key_matrix.h"
+
+// Macros:
+
+    #define KEY_SCANNER_DEFAULT_ROW_INTERVAL_USEC (1000 / RIGHT_KEY_MATRIX_ROWS_NUM)
+    #define KEY_SCANNER_MIN_ROW_INTERVAL_USEC 50
+
+// Typedefs:
+
+    typedef struct {
+        uint32_t frameCount;
+        uint16_t minLatencyUsec;             // Delay between the timer firing and the row getting sampled
+        uint16_t maxLatencyUsec;
+        uint16_t maxPeriodDeviationUsec;     // Largest difference of two consecutive row sampling periods and the row interval
+    } key_scanner_stats_t;
+
+// Variables:
+
+    extern uint16_t KeyScanner_RowIntervalUsec;
+    extern volatile key_scanner_stats_t KeyScanner_Stats;
+
+// Functions:
+
+    void InitKeyScanner(void);
+    void KeyScanner_SetRowInterval(uint16_t rowIntervalUsec);
+    void KeyScanner_ResetStats(void);
+    uint64_t KeyScanner_GetFrame(void);
+
+#endif
@@ -1,4 +1,5 @@
 #include "key_states.h"
 
 key_state_t KeyStates[SLOT_COUNT][MAX_KEY_COUNT_PER_MODULE];
-key_state_t LeftKeyStates[SLOT_COUNT][MAX_KEY_COUNT_PER_MODULE];
+slot_key_states_t SlotKeyStates[SLOT_COUNT];
+volatile uint64_t LeftKeyStates[SLOT_COUNT];
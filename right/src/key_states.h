@@ -7,19 +7,61 @@
     #include "slot.h"
     #include "module.h"
 
+// Macros:
+
+    #define KEY_STATE_BIT(keyId) ((uint64_t)1 << (keyId))
+
 // Typedefs:
 
+    // The per key part of the key states. Its address identifies the key in the secondary role engine.
     typedef struct {
-        uint8_t timestamp;
-        bool previous : 1;
-        bool current : 1;
-        bool suppressed : 1;
-        bool debouncing : 1;
+        uint8_t timestamp;       // When debouncing started, used by the eager and deferred debounce strategies
+        uint8_t integratedTime;  // Used by the integrator debounce strategy
     } key_state_t;
 
+    // The states of every key of a slot, one bit per key ID, so that the keys which changed or are held can be
+    // found without visiting every key.
+    typedef struct {
+        uint64_t previous;
+        uint64_t current;
+        uint64_t suppressed;
+        uint64_t debouncing;
+    } slot_key_states_t;
+
 // Variables:
 
     extern key_state_t KeyStates[SLOT_COUNT][MAX_KEY_COUNT_PER_MODULE];
-    extern key_state_t LeftKeyStates[SLOT_COUNT][MAX_KEY_COUNT_PER_MODULE];
+    extern slot_key_states_t SlotKeyStates[SLOT_COUNT];
+    extern volatile uint64_t LeftKeyStates[SLOT_COUNT];
+
+// Functions:
+
+    static inline bool KeyStates_IsPressed(uint8_t slotId, uint8_t keyId)
+    {
+        return SlotKeyStates[slotId].current & KEY_STATE_BIT(keyId);
+    }
+
+    static inline bool KeyStates_WasPressed(uint8_t slotId, uint8_t keyId)
+    {
+        return SlotKeyStates[slotId].previous & KEY_STATE_BIT(keyId);
+    }
+
+    static inline bool KeyStates_IsSuppressed(uint8_t slotId, uint8_t keyId)
+    {
+        return SlotKeyStates[slotId].suppressed & KEY_STATE_BIT(keyId);
+    }
+
+    static inline void KeyStates_Suppress(uint8_t slotId, uint8_t keyId)
+    {
+        SlotKeyStates[slotId].suppressed |= KEY_STATE_BIT(keyId);
+    }
+
+    // Clears the lowest set bit of the bitmap and returns its key ID. The bitmap must not be zero.
+    static inline uint8_t KeyStates_PopKeyId(uint64_t *bitmap)
+    {
+        uint8_t keyId = __builtin_ctzll(*bitmap);
+        *bitmap &= *bitmap - 1;
+        return keyId;
+    }
 
 #endif
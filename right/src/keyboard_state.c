@@ -5,6 +5,7 @@
 #include "keymap.h"
 #include "timer.h"
 #include "arrays.h"
+#include "module_key_events.h"
 
 keyboard_state_t State = {
         .stateType = 0,
@@ -19,6 +20,10 @@ key_action_t *resolveAction(key_ref_t *ref) {
     return &CurrentKeymap[State.activeLayer][ref->slotId][ref->keyId];
 }
 
+bool isPressed(key_ref_t *ref) {
+    return KeyStates_IsPressed(ref->slotId, ref->keyId);
+}
+
 uint8_t secondaryRole(key_ref_t *ref) {
     key_action_t *action = resolveAction(ref);
     return action->type == KeyActionType_Keystroke ? action->keystroke.secondaryRole : 0;
@@ -87,7 +92,7 @@ void updateActiveKey(key_state_t *keyState, uint8_t slotId, uint8_t keyId) {
 
     pending_key_t key = {
             .activated = false,
-            .enqueueTime = CurrentTime,
+            .enqueueTime = slotId == SlotId_LeftKeyboardHalf ? ModuleKeyEvents_GetKeyTime(slotId, keyId) : CurrentTime,
             .keyRef = ref
     };
 
@@ -108,10 +113,11 @@ void scheduleForImmediateExecution(pending_key_t *key) {
     State.scheduledForImmediateExecution[index] = *key;
     State.releasedActionKeyEnqueueTime = key->enqueueTime;
 
-    if (!key->keyRef.state->current) {
-        pending_key_t immediateKey = State.scheduledForImmediateExecution[index];
-        immediateKey.keyRef.state->previous = false;
-        immediateKey.keyRef.state->timestamp = CurrentTime;
-        immediateKey.keyRef.state->debouncing = true;
+    if (!isPressed(&key->keyRef)) {
+        key_ref_t *ref = &State.scheduledForImmediateExecution[index].keyRef;
+        uint64_t keyBit = KEY_STATE_BIT(ref->keyId);
+        SlotKeyStates[ref->slotId].previous &= ~keyBit;
+        SlotKeyStates[ref->slotId].debouncing |= keyBit;
+        ref->state->timestamp = CurrentTime;
     }
 }
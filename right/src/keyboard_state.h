@@ -14,7 +14,8 @@ typedef struct {
 } key_ref_t;
 
 typedef struct {
-    // timestamp of the enqueueing the key press (when it started to wait which role to emit)
+    // timestamp of the enqueueing the key press (when it started to wait which role to emit), or of the scan of the
+    // key press for the left half, whose key events arrive later than they were scanned
     uint32_t enqueueTime;
     // related key info ref
     key_ref_t keyRef;
@@ -59,6 +60,7 @@ pending_key_t* modifier(uint8_t index);
 pending_key_t* action(uint8_t index);
 key_action_t *resolveAction(key_ref_t *ref);
 
+bool isPressed(key_ref_t *ref);
 uint8_t secondaryRole(key_ref_t *ref);
 bool isTracked(key_ref_t *ref);
 void updateLongestPressedKey();
@@ -13,16 +13,15 @@ void updateLayerStates(void)
     memset(toggledLayers, false, LAYER_COUNT);
 
     for (uint8_t slotId=0; slotId<SLOT_COUNT; slotId++) {
-        for (uint8_t keyId=0; keyId<MAX_KEY_COUNT_PER_MODULE; keyId++) {
-            key_state_t *keyState = &KeyStates[slotId][keyId];
-            if (keyState->current && !keyState->suppressed) {
-                key_action_t action = CurrentKeymap[LayerId_Base][slotId][keyId];
-                if (action.type == KeyActionType_SwitchLayer) {
-                    if (action.switchLayer.mode != SwitchLayerMode_Toggle) {
-                        heldLayers[action.switchLayer.layer] = true;
-                    } else if (!keyState->previous) {
-                        toggledLayers[action.switchLayer.layer] = true;
-                    }
+        uint64_t heldKeys = SlotKeyStates[slotId].current & ~SlotKeyStates[slotId].suppressed;
+        while (heldKeys) {
+            uint8_t keyId = KeyStates_PopKeyId(&heldKeys);
+            key_action_t action = CurrentKeymap[LayerId_Base][slotId][keyId];
+            if (action.type == KeyActionType_SwitchLayer) {
+                if (action.switchLayer.mode != SwitchLayerMode_Toggle) {
+                    heldLayers[action.switchLayer.layer] = true;
+                } else if (!KeyStates_WasPressed(slotId, keyId)) {
+                    toggledLayers[action.switchLayer.layer] = true;
                 }
             }
         }
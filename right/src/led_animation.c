@@ -0,0 +1,247 @@
+#include "led_animation.h"
+#include "led_display.h"
+#include "slave_drivers/is31fl3731_driver.h"
+#include "key_states.h"
+#include "slot.h"
+#include "init_peripherals.h"
+#include "usb_composite_device.h"
+#include "timer.h"
+#include "slave_scheduler.h"
+
+uint8_t LedAnimation_Effects;
+uint8_t LedAnimation_FrameRateHz = LED_ANIMATION_DEFAULT_FRAME_RATE_HZ;
+uint8_t LedAnimation_MaxBusSharePercent = LED_ANIMATION_DEFAULT_MAX_BUS_SHARE_PERCENT;
+uint16_t LedAnimation_BreathingPeriodMsec = LED_ANIMATION_DEFAULT_BREATHING_PERIOD_MSEC;
+uint16_t LedAnimation_LayerFadeMsec = LED_ANIMATION_DEFAULT_LAYER_FADE_MSEC;
+uint16_t LedAnimation_AfterglowMsec = LED_ANIMATION_DEFAULT_AFTERGLOW_MSEC;
+led_animation_stats_t LedAnimationStats;
+
+#define TABLE_SEGMENT_COUNT(table) (sizeof(table) / sizeof(table[0]) - 1)
+
+// The tables are sampled at equal steps and interpolated linearly, 256 being a level of 1.
+
+// (1 - cos) / 2 over a full period.
+static const uint16_t breathingTable[] = {
+    0, 1, 2, 6, 10, 15, 22, 29, 37, 47, 57,
+    68, 79, 91, 103, 115, 128, 141, 153, 165, 177, 188,
+    199, 209, 219, 227, 234, 241, 246, 250, 254, 255, 256,
+    255, 254, 250, 246, 241, 234, 227, 219, 209, 199, 188,
+    177, 165, 153, 141, 128, 115, 103, 91, 79, 68, 57,
+    47, 37, 29, 22, 15, 10, 6, 2, 1, 0,
+};
+
+// An exponential decay to 0.
+static const uint16_t afterglowTable[] = {
+    256, 225, 198, 174, 153, 135, 118, 104, 91, 80, 70,
+    61, 53, 47, 41, 35, 31, 26, 23, 19, 17, 14,
+    12, 10, 8, 7, 5, 4, 3, 2, 1, 1, 0,
+};
+
+// A smoothstep from 0 to 1.
+static const uint16_t fadeTable[] = {
+    0, 1, 3, 6, 11, 17, 24, 31, 40, 49, 59,
+    70, 81, 92, 104, 116, 128, 140, 152, 164, 175, 186,
+    197, 207, 216, 225, 232, 239, 245, 250, 253, 255, 256,
+};
+
+static uint32_t previousFrameTime;
+static uint32_t budgetMilliBytes;
+static led_animation_change_t changes[LED_ANIMATION_MAX_CHANGE_COUNT];
+static uint8_t changeCount;
+
+static layer_id_t fadeFromLayer;
+static layer_id_t fadeToLayer;
+static uint32_t fadeStartTime;
+
+static uint64_t glowingKeys[LED_DRIVER_MAX_COUNT];
+static uint32_t keyPressTimes[LED_DRIVER_MAX_COUNT][LED_ANIMATION_KEY_COUNT];
+
+// Returns the level of the table at position, where the table spans length with segmentCount segments.
+// position must be less than length.
+static uint16_t interpolate(const uint16_t *table, uint8_t segmentCount, uint32_t position, uint32_t length)
+{
+    uint32_t scaledPosition = position * segmentCount * 256 / length;
+    uint8_t segmentId = scaledPosition / 256;
+    int32_t start = table[segmentId];
+    int32_t end = table[segmentId + 1];
+    return start + (end - start) * (int32_t)(scaledPosition % 256) / 256;
+}
+
+static uint8_t scale(uint8_t value, uint16_t level)
+{
+    return value * level / 256;
+}
+
+static void addChange(uint8_t ledDriverId, uint8_t ledIndex, uint8_t value)
+{
+    if (LedDriverIntensities[ledDriverId][ledIndex] != value) {
+        changes[changeCount++] = (led_animation_change_t){ledDriverId, ledIndex, value};
+    }
+}
+
+static void computeKeyLeds(void)
+{
+    uint16_t idleLevel = LedAnimation_Effects & LedAnimationEffect_Afterglow ? LED_ANIMATION_AFTERGLOW_IDLE_LEVEL : 256;
+    if (LedAnimation_Effects & LedAnimationEffect_Breathing && LedAnimation_BreathingPeriodMsec) {
+        uint16_t breathingLevel = interpolate(breathingTable, TABLE_SEGMENT_COUNT(breathingTable),
+            CurrentTime % LedAnimation_BreathingPeriodMsec, LedAnimation_BreathingPeriodMsec);
+        idleLevel = idleLevel * (256 - breathingLevel * (256 - LED_ANIMATION_BREATHING_MIN_LEVEL) / 256) / 256;
+    }
+    uint8_t idleIntensity = scale(UINT8_MAX, idleLevel);
+
+    for (uint8_t ledDriverId=0; ledDriverId<=LedDriverId_Last; ledDriverId++) {
+        for (uint8_t keyId=0; keyId<LED_ANIMATION_KEY_COUNT; keyId++) {
+            uint8_t ledIndex = LED_ANIMATION_KEY_LED_INDEX(keyId);
+            if (!LedSlaveDriver_IsLedEnabled(ledDriverId, ledIndex)) {
+                continue;
+            }
+
+            uint8_t value = idleIntensity;
+            if (glowingKeys[ledDriverId] & KEY_STATE_BIT(keyId)) {
+                uint32_t glowTime = CurrentTime - keyPressTimes[ledDriverId][keyId];
+                if (glowTime < LedAnimation_AfterglowMsec) {
+                    uint16_t glowLevel = interpolate(afterglowTable, TABLE_SEGMENT_COUNT(afterglowTable), glowTime, LedAnimation_AfterglowMsec);
+                    value += scale(UINT8_MAX - value, glowLevel);
+                } else {
+                    glowingKeys[ledDriverId] &= ~KEY_STATE_BIT(keyId);
+                }
+            }
+            addChange(ledDriverId, ledIndex, value);
+        }
+    }
+}
+
+static void computeLayerLeds(void)
+{
+    uint32_t fadeTime = CurrentTime - fadeStartTime;
+    uint16_t fadeLevel = fadeTime < LedAnimation_LayerFadeMsec
+        ? interpolate(fadeTable, TABLE_SEGMENT_COUNT(fadeTable), fadeTime, LedAnimation_LayerFadeMsec)
+        : 256;
+
+    for (layer_id_t layerId=LayerId_Mod; layerId<=LayerId_Mouse; layerId++) {
+        uint16_t level = layerId == fadeToLayer ? fadeLevel : layerId == fadeFromLayer ? 256 - fadeLevel : 0;
+        addChange(LedDriverId_Left, LED_DISPLAY_LAYER_LED_INDEX(layerId), scale(UINT8_MAX, level));
+    }
+}
+
+static uint16_t getChangeByteCount(void)
+{
+    uint32_t leds[LED_DRIVER_MAX_COUNT][LED_DRIVER_DIRTY_WORD_COUNT] = {0};
+    for (uint8_t i=0; i<changeCount; i++) {
+        leds[changes[i].ledDriverId][changes[i].ledIndex / 32] |= 1UL << (changes[i].ledIndex % 32);
+    }
+
+    uint16_t byteCount = 0;
+    for (uint8_t ledDriverId=0; ledDriverId<=LedDriverId_Last; ledDriverId++) {
+        byteCount += LedSlaveDriver_GetUpdateByteCount(leds[ledDriverId]);
+    }
+    return byteCount;
+}
+
+// The changes are applied all at once, so that the LED drivers never display part of a frame.
+static void applyChanges(void)
+{
+    LedSlaveDriver_BeginUpdate();
+    for (uint8_t i=0; i<changeCount; i++) {
+        LedSlaveDriver_SetLedIntensity(changes[i].ledDriverId, changes[i].ledIndex, changes[i].value);
+    }
+    LedSlaveDriver_EndUpdate();
+}
+
+void LedAnimation_SetEffects(uint8_t effects)
+{
+    uint8_t keyEffects = LedAnimationEffect_Breathing | LedAnimationEffect_Afterglow;
+    bool areKeyEffectsDisabled = LedAnimation_Effects & keyEffects && !(effects & keyEffects);
+
+    if (!LedAnimation_Effects) {
+        previousFrameTime = CurrentTime;
+        budgetMilliBytes = 0;
+    }
+    LedAnimation_Effects = effects;
+    if (areKeyEffectsDisabled) {
+        LedSlaveDriver_UpdateLeds();
+    }
+}
+
+void LedAnimation_FadeLayer(layer_id_t layerId)
+{
+    if (layerId != fadeToLayer) {
+        fadeFromLayer = fadeToLayer;
+        fadeToLayer = layerId;
+        fadeStartTime = CurrentTime;
+    }
+}
+
+void LedAnimation_KeysPressed(uint8_t slotId, uint64_t keys)
+{
+    if (!(LedAnimation_Effects & LedAnimationEffect_Afterglow) || slotId > SlotId_LeftKeyboardHalf) {
+        return;
+    }
+
+    uint8_t ledDriverId = slotId == SlotId_RightKeyboardHalf ? LedDriverId_Right : LedDriverId_Left;
+
+    keys &= KEY_STATE_BIT(LED_ANIMATION_KEY_COUNT) - 1;
+    glowingKeys[ledDriverId] |= keys;
+    while (keys) {
+        keyPressTimes[ledDriverId][KeyStates_PopKeyId(&keys)] = CurrentTime;
+    }
+}
+
+// Computes a frame at LedAnimation_FrameRateHz and writes its changes to LedDriverIntensities, as long as the bytes
+// that the LED drivers take to write them stay within LedAnimation_MaxBusSharePercent. A frame that doesn't fit yet
+// is skipped, and the budget is saved up until the frame at hand fits, so that the frame rate drops instead.
+// Otherwise, only the budget of one frame period is carried over, so that the frames after an idle period can't
+// burst above the bus share. The LED drivers only get the bus for one write at a time between two polls of the
+// modules, so the polls follow each other as closely as without the animations, apart from that write. The frames
+// are skipped while the polls leave no room for a write before their deadline, see SlaveScheduler_IsSqueezing.
+void LedAnimation_Update(void)
+{
+    if (!LedAnimation_Effects || !LedAnimation_FrameRateHz || SleepModeActive) {
+        return;
+    }
+
+    uint32_t framePeriodMsec = 1000 / LedAnimation_FrameRateHz;
+    uint32_t elapsedTime = CurrentTime - previousFrameTime;
+    if (elapsedTime < framePeriodMsec) {
+        return;
+    }
+    previousFrameTime = CurrentTime;
+
+    uint32_t budgetBytesPerSecond = I2cMainBusActualBaudRateBps / LED_ANIMATION_I2C_CLOCKS_PER_BYTE * LedAnimation_MaxBusSharePercent / 100;
+    uint64_t milliBytes = budgetMilliBytes + (uint64_t)elapsedTime * budgetBytesPerSecond;
+
+    LedAnimationStats.computedFrameCount++;
+    if (SlaveScheduler_IsSqueezing) {
+        budgetMilliBytes = MIN(milliBytes, framePeriodMsec * budgetBytesPerSecond);
+        LedAnimationStats.throttledFrameCount++;
+        return;
+    }
+
+    changeCount = 0;
+    if (LedAnimation_Effects & (LedAnimationEffect_Breathing | LedAnimationEffect_Afterglow)) {
+        computeKeyLeds();
+    }
+    if (LedAnimation_Effects & LedAnimationEffect_LayerFade) {
+        computeLayerLeds();
+    }
+
+    uint16_t byteCount = getChangeByteCount();
+    if (milliBytes < byteCount * 1000) {
+        budgetMilliBytes = milliBytes;
+        LedAnimationStats.throttledFrameCount++;
+        return;
+    }
+    budgetMilliBytes = MIN(milliBytes - byteCount * 1000, framePeriodMsec * budgetBytesPerSecond);
+    if (!changeCount) {
+        return;
+    }
+
+    applyChanges();
+    LedAnimationStats.appliedFrameCount++;
+    LedAnimationStats.chargedByteCount += byteCount;
+}
+
+void LedAnimation_ResetStats(void)
+{
+    memset(&LedAnimationStats, 0, sizeof(LedAnimationStats));
+}
@@ -0,0 +1,74 @@
+#ifndef __LED_ANIMATION_H__
+#define __LED_ANIMATION_H__
+
+// Includes:
+
+    #include "fsl_common.h"
+    #include "layer.h"
+
+// Macros:
+
+    #define LED_ANIMATION_DEFAULT_FRAME_RATE_HZ 50
+    #define LED_ANIMATION_DEFAULT_MAX_BUS_SHARE_PERCENT 10
+    #define LED_ANIMATION_DEFAULT_BREATHING_PERIOD_MSEC 4000
+    #define LED_ANIMATION_DEFAULT_LAYER_FADE_MSEC 200
+    #define LED_ANIMATION_DEFAULT_AFTERGLOW_MSEC 600
+
+    // The levels of the key LED intensities, where 256 is the full intensity. The breathing key backlight dims down
+    // to LED_ANIMATION_BREATHING_MIN_LEVEL of its idle level. With the afterglow, the keys idle at
+    // LED_ANIMATION_AFTERGLOW_IDLE_LEVEL, so that pressed keys can glow brighter.
+    #define LED_ANIMATION_BREATHING_MIN_LEVEL 64
+    #define LED_ANIMATION_AFTERGLOW_IDLE_LEVEL 128
+
+    // Key n of a keyboard half is at row n / 7 and column n % 7 of its key matrix, and its LED is at the same row
+    // and column of the key LED rows of the LED driver of the half, every other row of 8 LEDs.
+    #define LED_ANIMATION_KEY_MATRIX_COLS_NUM 7
+    #define LED_ANIMATION_KEY_COUNT 35
+    #define LED_ANIMATION_KEY_LED_INDEX(keyId) \
+        (16 * ((keyId) / LED_ANIMATION_KEY_MATRIX_COLS_NUM) + (keyId) % LED_ANIMATION_KEY_MATRIX_COLS_NUM)
+
+    #define LED_ANIMATION_MAX_CHANGE_COUNT (2 * LED_ANIMATION_KEY_COUNT + LayerId_Mouse)
+
+    // An I2C byte takes 9 clocks with its acknowledge bit.
+    #define LED_ANIMATION_I2C_CLOCKS_PER_BYTE 9
+
+// Typedefs:
+
+    typedef enum {
+        LedAnimationEffect_Breathing = 1 << 0,  // The key backlight slowly dims and brightens
+        LedAnimationEffect_LayerFade = 1 << 1,  // The layer LEDs cross-fade when the active layer changes
+        LedAnimationEffect_Afterglow = 1 << 2,  // Pressed keys light up fully and fade back to the idle level
+    } led_animation_effect_t;
+
+    typedef struct {
+        uint8_t ledDriverId;
+        uint8_t ledIndex;
+        uint8_t value;
+    } led_animation_change_t;
+
+    typedef struct {
+        uint32_t computedFrameCount;
+        uint32_t appliedFrameCount;    // Frames with changes that were written to LedDriverIntensities
+        uint32_t throttledFrameCount;  // Frames that were skipped to stay within the budget or to keep the polls in time
+        uint32_t chargedByteCount;     // Bytes that the LED drivers take at most to write the applied frames, see LedSlaveDriver_GetUpdateByteCount()
+    } led_animation_stats_t;
+
+// Variables:
+
+    extern uint8_t LedAnimation_Effects;
+    extern uint8_t LedAnimation_FrameRateHz;
+    extern uint8_t LedAnimation_MaxBusSharePercent;  // The share of the main bus baud rate that the changes may take
+    extern uint16_t LedAnimation_BreathingPeriodMsec;
+    extern uint16_t LedAnimation_LayerFadeMsec;
+    extern uint16_t LedAnimation_AfterglowMsec;
+    extern led_animation_stats_t LedAnimationStats;
+
+// Functions:
+
+    void LedAnimation_SetEffects(uint8_t effects);
+    void LedAnimation_FadeLayer(layer_id_t layerId);
+    void LedAnimation_KeysPressed(uint8_t slotId, uint64_t keys);
+    void LedAnimation_Update(void);
+    void LedAnimation_ResetStats(void);
+
+#endif
@@ -2,12 +2,20 @@
 #include "slave_drivers/is31fl3731_driver.h"
 #include "layer.h"
 #include "keymap.h"
+#include "led_animation.h"
 
 uint8_t IconsAndLayerTextsBrightness = 0xff;
 uint8_t AlphanumericSegmentsBrightness = 0xff;
-bool ledIconStates[LedDisplayIcon_Last];
+bool ledIconStates[LedDisplayIcon_Last + 1];
 char LedDisplay_DebugString[] = "   ";
 
+// What the display shows, so that the setters only touch LedDriverIntensities when it changes.
+// LedDisplay_UpdateAll() invalidates it, as the LED driver may have overwritten the intensities.
+static bool isDisplayedStateValid;
+static bool isDisplayedLayerValid;
+static uint64_t displayedSegments;
+static layer_id_t displayedLayerId;
+
 static const uint16_t capitalLetterToSegmentMap[] = {
     0b0000000011110111,
     0b0001001010001111,
@@ -61,6 +69,13 @@ static uint16_t characterToSegmentMap(char character)
     return 0;
 }
 
+static void setSegmentLed(uint8_t ledIndex, uint64_t segments, uint64_t changedSegments, uint8_t bit)
+{
+    if (changedSegments & (uint64_t)1 << bit) {
+        LedSlaveDriver_SetLedIntensity(LedDriverId_Left, ledIndex, segments & (uint64_t)1 << bit ? UINT8_MAX : 0);
+    }
+}
+
 void LedDisplay_SetText(uint8_t length, const char* text)
 {
     uint64_t allSegmentSets = 0;
@@ -74,44 +89,71 @@ void LedDisplay_SetText(uint8_t length, const char* text)
             allSegmentSets |= characterToSegmentMap(text[0]);
     }
 
-    LedDriverValues[LedDriverId_Left][11] = allSegmentSets & 0b00000001 ? AlphanumericSegmentsBrightness : 0;
-    LedDriverValues[LedDriverId_Left][12] = allSegmentSets & 0b00000010 ? AlphanumericSegmentsBrightness : 0;
-    allSegmentSets >>= 2;
+    uint64_t changedSegments = isDisplayedStateValid ? allSegmentSets ^ displayedSegments : UINT64_MAX;
+    if (!changedSegments) {
+        return;
+    }
+    displayedSegments = allSegmentSets;
+
+    // Only the segments that differ from the displayed text are written.
+    LedSlaveDriver_BeginUpdate();
+    setSegmentLed(11, allSegmentSets, changedSegments, 0);
+    setSegmentLed(12, allSegmentSets, changedSegments, 1);
 
+    uint8_t bit = 2;
     for (uint8_t i = 24; i <= 136; i += 16) {
-        for (uint8_t j = 0; j < 5; j++) {
-            LedDriverValues[LedDriverId_Left][i + j] = allSegmentSets & 1 << j ? AlphanumericSegmentsBrightness : 0;
+        for (uint8_t j = 0; j < 5; j++, bit++) {
+            setSegmentLed(i + j, allSegmentSets, changedSegments, bit);
         }
-        allSegmentSets >>= 5;
     }
+    LedSlaveDriver_EndUpdate();
 }
 
 void LedDisplay_SetLayer(layer_id_t layerId)
 {
-    for (uint8_t i = 13; i <= 45; i += 16) {
-        LedDriverValues[LedDriverId_Left][i] = 0;
+    if (LedAnimation_Effects & LedAnimationEffect_LayerFade) {
+        isDisplayedLayerValid = false;
+        LedAnimation_FadeLayer(layerId);
+        return;
     }
 
-    if (layerId >= LayerId_Mod && layerId <= LayerId_Mouse) {
-        LedDriverValues[LedDriverId_Left][16 * layerId - 3] = IconsAndLayerTextsBrightness;
+    // This is called on every report update, so the layer LEDs are only written when the layer changes.
+    if (isDisplayedLayerValid && layerId == displayedLayerId) {
+        return;
     }
+    isDisplayedLayerValid = true;
+    displayedLayerId = layerId;
+
+    LedSlaveDriver_BeginUpdate();
+    for (layer_id_t i = LayerId_Mod; i <= LayerId_Mouse; i++) {
+        LedSlaveDriver_SetLedIntensity(LedDriverId_Left, LED_DISPLAY_LAYER_LED_INDEX(i), i == layerId ? UINT8_MAX : 0);
+    }
+    LedSlaveDriver_EndUpdate();
 }
 
 bool LedDisplay_GetIcon(led_display_icon_t icon)
 {
-    return LedDriverValues[LedDriverId_Left][8 + icon];
+    return LedDriverIntensities[LedDriverId_Left][8 + icon];
+}
+
+static void showIcon(led_display_icon_t icon)
+{
+    LedSlaveDriver_SetLedIntensity(LedDriverId_Left, icon + 8, ledIconStates[icon] ? UINT8_MAX : 0);
 }
 
 void LedDisplay_SetIcon(led_display_icon_t icon, bool isEnabled)
 {
+    if (isDisplayedStateValid && ledIconStates[icon] == isEnabled) {
+        return;
+    }
     ledIconStates[icon] = isEnabled;
-    LedDriverValues[LedDriverId_Left][icon + 8] = isEnabled ? IconsAndLayerTextsBrightness : 0;
+    showIcon(icon);
 }
 
 void LedDisplay_UpdateIcons(void)
 {
     for (led_display_icon_t i=0; i<=LedDisplayIcon_Last; i++) {
-        LedDisplay_SetIcon(i, ledIconStates[i]);
+        showIcon(i);
     }
 }
 
@@ -125,8 +167,15 @@ void LedDisplay_UpdateText(void)
 #endif
 }
 
+// Shows the icons and the text again regardless of what the display is supposed to show, and makes the next
+// LedDisplay_SetLayer() write the layer LEDs.
 void LedDisplay_UpdateAll(void)
 {
+    isDisplayedStateValid = false;
+    isDisplayedLayerValid = false;
+    LedSlaveDriver_BeginUpdate();
     LedDisplay_UpdateIcons();
     LedDisplay_UpdateText();
+    LedSlaveDriver_EndUpdate();
+    isDisplayedStateValid = true;
 }
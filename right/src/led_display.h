@@ -11,6 +11,8 @@
 
     #define LED_DISPLAY_DEBUG_MODE 0
 
+    #define LED_DISPLAY_LAYER_LED_INDEX(layerId) (16 * (layerId) - 3)
+
 // Typedefs:
 
     typedef enum {
@@ -6,11 +6,12 @@
 #include "bus_pal_hardware.h"
 #include "command.h"
 #include "eeprom.h"
-#include "right_key_matrix.h"
+#include "key_scanner.h"
 #include "usb_commands/usb_command_apply_config.h"
 #include "peripherals/reset_button.h"
 #include "config_parser/config_globals.h"
 #include "usb_report_updater.h"
+#include "profiler.h"
 
 static bool IsEepromInitialized = false;
 static bool IsConfigInitialized = false;
@@ -33,6 +34,7 @@ int main(void)
 {
     InitClock();
     InitPeripherals();
+    PROFILER_INIT();
 
     IsFactoryResetModeEnabled = RESET_BUTTON_IS_PRESSED;
 
@@ -43,7 +45,7 @@ int main(void)
         handleUsbBusPalCommand();
     } else {
         InitSlaveScheduler();
-        KeyMatrix_Init(&RightKeyMatrix);
+        InitKeyScanner();
         InitUsb();
 
         while (1) {
@@ -51,8 +53,6 @@ int main(void)
                 UsbCommand_ApplyConfig();
                 IsConfigInitialized = true;
             }
-            KeyMatrix_ScanRow(&RightKeyMatrix);
-            ++MatrixScanCounter;
             UpdateUsbReports();
             __WFI();
         }
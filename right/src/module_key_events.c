@@ -0,0 +1,81 @@
+#include "module_key_events.h"
+#include "key_states.h"
+#include "timer.h"
+
+module_key_event_queue_t ModuleKeyEventQueues[SLOT_COUNT];
+
+// Returns false if the queue is full, in which case the key states are resynchronized from LeftKeyStates.
+bool ModuleKeyEvents_Push(uint8_t slotId, uint8_t keyId, bool isPressed, uint32_t timeMicros)
+{
+    module_key_event_queue_t *queue = ModuleKeyEventQueues + slotId;
+    uint8_t nextHead = (queue->head + 1) % MODULE_KEY_EVENT_QUEUE_LENGTH;
+
+    if (nextHead == queue->tail) {
+        queue->isResyncRequested = true;
+        return false;
+    }
+
+    module_key_event_t *event = queue->events + queue->head;
+    event->timeMicros = timeMicros;
+    event->keyId = keyId;
+    event->isPressed = isPressed;
+    queue->head = nextHead;
+    return true;
+}
+
+// Makes the next replay drop the queued events and take the key states of LeftKeyStates, which the slave
+// driver must have updated beforehand.
+void ModuleKeyEvents_Resync(uint8_t slotId)
+{
+    ModuleKeyEventQueues[slotId].isResyncRequested = true;
+}
+
+// Applies the queued events in order and returns the resulting key states. At most one event is applied per
+// key and call, so that a press and a release that arrive in the same poll are reported in separate updates.
+uint64_t ModuleKeyEvents_Replay(uint8_t slotId)
+{
+    module_key_event_queue_t *queue = ModuleKeyEventQueues + slotId;
+
+    if (queue->isResyncRequested) {
+        // The I2C interrupt pushes events and updates LeftKeyStates together, so they must be taken together, or
+        // the events pushed in between would be replayed on top of key states that already include them.
+        uint32_t now = Timer_GetCurrentTimeMicros();
+        uint32_t primask = DisableGlobalIRQ();
+        queue->isResyncRequested = false;
+        queue->tail = queue->head;
+        uint64_t changedKeys = queue->keyStates ^ LeftKeyStates[slotId];
+        queue->keyStates = LeftKeyStates[slotId];
+        EnableGlobalIRQ(primask);
+        while (changedKeys) {
+            queue->keyTimesMicros[KeyStates_PopKeyId(&changedKeys)] = now;
+        }
+        return queue->keyStates;
+    }
+
+    uint64_t replayedKeys = 0;
+    while (queue->tail != queue->head) {
+        module_key_event_t *event = queue->events + queue->tail;
+        uint64_t keyBit = KEY_STATE_BIT(event->keyId);
+        if (replayedKeys & keyBit) {
+            break;
+        }
+        replayedKeys |= keyBit;
+        if (event->isPressed) {
+            queue->keyStates |= keyBit;
+        } else {
+            queue->keyStates &= ~keyBit;
+        }
+        queue->keyTimesMicros[event->keyId] = event->timeMicros;
+        queue->tail = (queue->tail + 1) % MODULE_KEY_EVENT_QUEUE_LENGTH;
+    }
+
+    return queue->keyStates;
+}
+
+// Returns when the key changed to its replayed state, in CurrentTime milliseconds, so that the keys of the module
+// are ordered and timed against the keys of the right half by when they were scanned rather than when they arrived.
+uint32_t ModuleKeyEvents_GetKeyTime(uint8_t slotId, uint8_t keyId)
+{
+    uint32_t ageUsec = Timer_GetCurrentTimeMicros() - ModuleKeyEventQueues[slotId].keyTimesMicros[keyId];
+    return CurrentTime - ageUsec / 1000;
+}
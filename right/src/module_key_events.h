@@ -0,0 +1,44 @@
+#ifndef __MODULE_KEY_EVENTS_H__
+#define __MODULE_KEY_EVENTS_H__
+
+// Includes:
+
+    #include "fsl_common.h"
+    #include "slot.h"
+    #include "module.h"
+
+// Macros:
+
+    #define MODULE_KEY_EVENT_QUEUE_LENGTH 32
+
+// Typedefs:
+
+    typedef struct {
+        uint32_t timeMicros;  // When the module scanned the change, in Timer_GetCurrentTimeMicros() time
+        uint8_t keyId;
+        bool isPressed;
+    } module_key_event_t;
+
+    // Filled by the slave driver from the I2C interrupt and drained by UpdateUsbReports() from the main loop.
+    typedef struct {
+        module_key_event_t events[MODULE_KEY_EVENT_QUEUE_LENGTH];
+        volatile uint8_t head;
+        volatile uint8_t tail;
+        volatile bool isResyncRequested;  // Drop the events and take the key states of LeftKeyStates
+        uint64_t keyStates;               // The key states after the last replayed event
+        // The scan time of the last replayed event of every key, or the time of the resync that changed it
+        uint32_t keyTimesMicros[MAX_KEY_COUNT_PER_MODULE];
+    } module_key_event_queue_t;
+
+// Variables:
+
+    extern module_key_event_queue_t ModuleKeyEventQueues[SLOT_COUNT];
+
+// Functions:
+
+    bool ModuleKeyEvents_Push(uint8_t slotId, uint8_t keyId, bool isPressed, uint32_t timeMicros);
+    void ModuleKeyEvents_Resync(uint8_t slotId);
+    uint64_t ModuleKeyEvents_Replay(uint8_t slotId);
+    uint32_t ModuleKeyEvents_GetKeyTime(uint8_t slotId, uint8_t keyId);
+
+#endif
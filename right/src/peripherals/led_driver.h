@@ -16,8 +16,10 @@
     #define LED_DRIVER_SDB_CLOCK kCLOCK_PortA
     #define LED_DRIVER_SDB_PIN   2
 
-    #define LED_DRIVER_REGISTER_SHUTDOWN 0x0A
-    #define LED_DRIVER_REGISTER_FRAME    0xFD
+    #define LED_DRIVER_REGISTER_CONFIGURATION   0x00
+    #define LED_DRIVER_REGISTER_PICTURE_DISPLAY 0x01
+    #define LED_DRIVER_REGISTER_SHUTDOWN        0x0A
+    #define LED_DRIVER_REGISTER_FRAME           0xFD
 
     #define LED_DRIVER_FRAME_1 0
     #define LED_DRIVER_FRAME_2 1
@@ -42,6 +44,8 @@
     #define SHUTDOWN_MODE_SHUTDOWN 0
     #define SHUTDOWN_MODE_NORMAL   1
 
+    #define CONFIGURATION_MODE_PICTURE 0x00
+
 // Functions:
 
     void InitLedDriver(void);
@@ -0,0 +1,54 @@
+#include "profiler.h"
+
+#if PROFILER_ENABLED
+
+profiler_stage_stats_t ProfilerStageStats[ProfilerStage_Count];
+
+void Profiler_Init(void)
+{
+#ifndef HOST_BUILD
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    for (profiler_stage_t stage = 0; stage < ProfilerStage_Count; stage++) {
+        Profiler_Reset(stage);
+    }
+}
+
+static uint8_t getHistogramBucket(uint32_t cycles)
+{
+    uint8_t log2 = cycles ? 31 - __builtin_clz(cycles) : 0;
+    if (log2 < PROFILER_HISTOGRAM_FIRST_BUCKET_LOG2) {
+        return 0;
+    }
+    return MIN(log2 - PROFILER_HISTOGRAM_FIRST_BUCKET_LOG2 + 1, PROFILER_HISTOGRAM_BUCKET_COUNT - 1);
+}
+
+void Profiler_Record(profiler_stage_t stage, uint32_t cycles)
+{
+    profiler_stage_stats_t *stats = ProfilerStageStats + stage;
+
+    if (cycles < stats->minCycles) {
+        stats->minCycles = cycles;
+    }
+    if (cycles > stats->maxCycles) {
+        stats->maxCycles = cycles;
+    }
+    stats->totalCycles += cycles;
+    stats->sampleCount++;
+
+    uint16_t *bucket = stats->histogram + getHistogramBucket(cycles);
+    if (*bucket < UINT16_MAX) {
+        (*bucket)++;
+    }
+}
+
+void Profiler_Reset(profiler_stage_t stage)
+{
+    profiler_stage_stats_t *stats = ProfilerStageStats + stage;
+    memset(stats, 0, sizeof(profiler_stage_stats_t));
+    stats->minCycles = UINT32_MAX;
+}
+
+#endif
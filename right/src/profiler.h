@@ -0,0 +1,74 @@
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+// Includes:
+
+    #include "fsl_common.h"
+
+// Macros:
+
+    // Set to 1 to record the cycle counts of the main loop stages. When 0, the PROFILER_* macros expand
+    // to nothing and the profiler takes no code or RAM.
+    #ifndef PROFILER_ENABLED
+        #define PROFILER_ENABLED 0
+    #endif
+
+    // Histogram bucket i counts samples of [2^(i+4), 2^(i+5)) cycles, except the first bucket which
+    // counts everything below 32 cycles and the last one which counts everything above.
+    #define PROFILER_HISTOGRAM_BUCKET_COUNT 12
+    #define PROFILER_HISTOGRAM_FIRST_BUCKET_LOG2 5
+
+    #ifdef HOST_BUILD
+        #define PROFILER_GET_CYCLE_COUNT() 0
+    #else
+        #define PROFILER_GET_CYCLE_COUNT() (DWT->CYCCNT)
+    #endif
+
+    #if PROFILER_ENABLED
+        #define PROFILER_INIT() Profiler_Init()
+        #define PROFILER_START(stage) uint32_t profilerStartCycles_##stage = PROFILER_GET_CYCLE_COUNT()
+        #define PROFILER_STOP(stage) \
+            Profiler_Record(ProfilerStage_##stage, PROFILER_GET_CYCLE_COUNT() - profilerStartCycles_##stage)
+    #else
+        #define PROFILER_INIT()
+        #define PROFILER_START(stage)
+        #define PROFILER_STOP(stage)
+    #endif
+
+// Typedefs:
+
+    typedef enum {
+        ProfilerStage_ScanRow,
+        ProfilerStage_UpdateUsbReports,
+        ProfilerStage_KeyStates,             // Debounce_UpdateKeyStates() and updateActiveKey() of the held keys
+        ProfilerStage_GetActiveLayer,
+        ProfilerStage_SecondaryRole,         // The state handlers of the secondary role state machine
+        ProfilerStage_ProcessMouseActions,
+        ProfilerStage_SendKeyboardEvents,
+        ProfilerStage_LedAnimation,
+        ProfilerStage_Count,
+    } profiler_stage_t;
+
+    typedef struct {
+        uint32_t sampleCount;
+        uint32_t minCycles;
+        uint32_t maxCycles;
+        uint64_t totalCycles;
+        uint16_t histogram[PROFILER_HISTOGRAM_BUCKET_COUNT];
+    } profiler_stage_stats_t;
+
+// Variables:
+
+#if PROFILER_ENABLED
+    extern profiler_stage_stats_t ProfilerStageStats[ProfilerStage_Count];
+#endif
+
+// Functions:
+
+#if PROFILER_ENABLED
+    void Profiler_Init(void);
+    void Profiler_Record(profiler_stage_t stage, uint32_t cycles);
+    void Profiler_Reset(profiler_stage_t stage);
+#endif
+
+#endif
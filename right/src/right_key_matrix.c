@@ -5,6 +5,7 @@ uint32_t MatrixScanCounter;
 key_matrix_t RightKeyMatrix = {
     .colNum = RIGHT_KEY_MATRIX_COLS_NUM,
     .rowNum = RIGHT_KEY_MATRIX_ROWS_NUM,
+    .scanMode = KeyMatrixScanMode_PortWide,
     .cols = (key_matrix_pin_t[]){
         {PORTA, GPIOA, kCLOCK_PortA, 5},
         {PORTB, GPIOB, kCLOCK_PortB, 16},
@@ -2,9 +2,13 @@
 #include "slave_drivers/is31fl3731_driver.h"
 #include "slave_scheduler.h"
 #include "led_display.h"
+#include "timer.h"
 
 uint8_t KeyBacklightBrightness = 0xff;
+uint8_t LedDriverIntensities[LED_DRIVER_MAX_COUNT][LED_DRIVER_LED_COUNT];
+uint8_t LedZoneLevels[LedZone_Last + 1] = {0xff, 0xff, 0xff, 0xff};
 uint8_t LedDriverValues[LED_DRIVER_MAX_COUNT][LED_DRIVER_LED_COUNT];
+led_driver_telemetry_t LedDriverTelemetry;
 
 static led_driver_state_t ledDriverStates[LED_DRIVER_MAX_COUNT] = {
     {
@@ -57,25 +61,205 @@ static led_driver_state_t ledDriverStates[LED_DRIVER_MAX_COUNT] = {
     },
 };
 
+// Maps perceived brightness to PWM values with a gamma of 2.2, so that the levels look evenly spaced. Every
+// nonzero level stays lit.
+static const uint8_t gammaTable[] = {
+    0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2,
+    3, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 6,
+    6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10, 11, 11, 11, 12,
+    12, 13, 13, 13, 14, 14, 15, 15, 16, 16, 17, 17, 18, 18, 19, 19,
+    20, 20, 21, 22, 22, 23, 23, 24, 25, 25, 26, 26, 27, 28, 28, 29,
+    30, 30, 31, 32, 33, 33, 34, 35, 35, 36, 37, 38, 39, 39, 40, 41,
+    42, 43, 43, 44, 45, 46, 47, 48, 49, 49, 50, 51, 52, 53, 54, 55,
+    56, 57, 58, 59, 60, 61, 62, 63, 64, 65, 66, 67, 68, 69, 70, 71,
+    73, 74, 75, 76, 77, 78, 79, 81, 82, 83, 84, 85, 87, 88, 89, 90,
+    91, 93, 94, 95, 97, 98, 99, 100, 102, 103, 105, 106, 107, 109, 110, 111,
+    113, 114, 116, 117, 119, 120, 121, 123, 124, 126, 127, 129, 130, 132, 133, 135,
+    137, 138, 140, 141, 143, 145, 146, 148, 149, 151, 153, 154, 156, 158, 159, 161,
+    163, 165, 166, 168, 170, 172, 173, 175, 177, 179, 181, 182, 184, 186, 188, 190,
+    192, 194, 196, 197, 199, 201, 203, 205, 207, 209, 211, 213, 215, 217, 219, 221,
+    223, 225, 227, 229, 231, 234, 236, 238, 240, 242, 244, 246, 248, 251, 253, 255,
+};
+
 static uint8_t setFunctionFrameBuffer[] = {LED_DRIVER_REGISTER_FRAME, LED_DRIVER_FRAME_FUNCTION};
 static uint8_t setShutdownModeNormalBuffer[] = {LED_DRIVER_REGISTER_SHUTDOWN, SHUTDOWN_MODE_NORMAL};
+static uint8_t setPictureModeBuffer[] = {LED_DRIVER_REGISTER_CONFIGURATION, CONFIGURATION_MODE_PICTURE, LED_DRIVER_FRAME_1};
 static uint8_t setFrame1Buffer[] = {LED_DRIVER_REGISTER_FRAME, LED_DRIVER_FRAME_1};
+static uint8_t setFrame2Buffer[] = {LED_DRIVER_REGISTER_FRAME, LED_DRIVER_FRAME_2};
+static uint8_t selectPageBuffer[] = {LED_DRIVER_REGISTER_FRAME, 0};
+static uint8_t setPictureDisplayBuffer[] = {LED_DRIVER_REGISTER_PICTURE_DISPLAY, 0};
 static uint8_t updatePwmRegistersBuffer[PWM_REGISTER_BUFFER_LENGTH];
 
+// The frames aren't flipped while an update is in progress, so that it is displayed all at once.
+static volatile uint8_t updateDepth;
+
+static void markLedDirty(uint32_t *dirtyLeds, uint8_t ledIndex)
+{
+    dirtyLeds[ledIndex / 32] |= 1UL << (ledIndex % 32);
+}
+
+static void markLedClean(uint32_t *dirtyLeds, uint8_t ledIndex)
+{
+    dirtyLeds[ledIndex / 32] &= ~(1UL << (ledIndex % 32));
+}
+
+static bool isLedDirty(const uint32_t *dirtyLeds, uint8_t ledIndex)
+{
+    return dirtyLeds[ledIndex / 32] & 1UL << (ledIndex % 32);
+}
+
+// Returns the first dirty LED from ledIndex on, or LED_DRIVER_LED_COUNT if there is none.
+static uint8_t findDirtyLed(const uint32_t *dirtyLeds, uint8_t ledIndex)
+{
+    uint8_t wordId = ledIndex / 32;
+    uint32_t word = dirtyLeds[wordId] & UINT32_MAX << (ledIndex % 32);
+    while (!word) {
+        if (++wordId == LED_DRIVER_DIRTY_WORD_COUNT) {
+            return LED_DRIVER_LED_COUNT;
+        }
+        word = dirtyLeds[wordId];
+    }
+    return wordId * 32 + __builtin_ctz(word);
+}
+
+// Returns the last LED that the PWM write starting at startLedIndex takes along. Unchanged LEDs in between are
+// written too, see PWM_REGISTER_UPDATE_MAX_GAP.
+static uint8_t findWriteEndLed(const uint32_t *dirtyLeds, uint8_t startLedIndex)
+{
+    uint8_t maxEndLedIndex = MIN(startLedIndex + PMW_REGISTER_UPDATE_CHUNK_SIZE, LED_DRIVER_LED_COUNT) - 1;
+    uint8_t endLedIndex = startLedIndex;
+    for (uint8_t index=startLedIndex+1; index<=maxEndLedIndex && index-endLedIndex<=PWM_REGISTER_UPDATE_MAX_GAP+1; index++) {
+        if (isLedDirty(dirtyLeds, index)) {
+            endLedIndex = index;
+        }
+    }
+    return endLedIndex;
+}
+
+static void markLedDirtyInEveryFrame(led_driver_state_t *ledDriverState, uint8_t ledIndex)
+{
+    for (uint8_t frameId=0; frameId<LED_DRIVER_BUFFERED_FRAME_COUNT; frameId++) {
+        markLedDirty(ledDriverState->dirtyLeds[frameId], ledIndex);
+    }
+}
+
+// Tells whether the LED control registers of the driver enable the LED, that is whether the LED is fitted.
+bool LedSlaveDriver_IsLedEnabled(uint8_t ledDriverId, uint8_t ledIndex)
+{
+    return ledDriverStates[ledDriverId].setupLedControlRegistersCommand[1 + ledIndex / 8] & 1 << (ledIndex % 8);
+}
+
+// The key LEDs take the first 8 LEDs of every row of 16 LEDs, and the display takes the rest. The first display
+// row starts with the icons, followed by 2 segments, and every display row ends with the LED of a layer text,
+// see led_display.c.
+static led_zone_t getLedZone(uint8_t ledDriverId, uint8_t ledIndex)
+{
+    uint8_t column = ledIndex % 16;
+    if (ledDriverId == LedDriverId_Right) {
+        return LedZone_RightKeyBacklight;
+    }
+    if (column < 8) {
+        return LedZone_LeftKeyBacklight;
+    }
+    if (ledIndex < 16 && column < 8 + LedDisplayIcon_Last + 1) {
+        return LedZone_Icons;
+    }
+    return column < 13 ? LedZone_AlphanumericSegments : LedZone_Icons;
+}
+
+// LEDs that aren't fitted stay at 0, so that they never need to be written.
+static uint8_t getPwmValue(uint8_t ledDriverId, uint8_t ledIndex)
+{
+    if (!LedSlaveDriver_IsLedEnabled(ledDriverId, ledIndex)) {
+        return 0;
+    }
+    uint8_t level = LedZoneLevels[getLedZone(ledDriverId, ledIndex)];
+    return gammaTable[LedDriverIntensities[ledDriverId][ledIndex] * level / UINT8_MAX];
+}
+
+// Every change of LedDriverValues goes through here, so that LedSlaveDriver_Update() only has to look at the
+// dirty LEDs. The value is written before the LED is marked dirty, as the update can interrupt this.
+static void updatePwmValue(uint8_t ledDriverId, uint8_t ledIndex)
+{
+    uint8_t value = getPwmValue(ledDriverId, ledIndex);
+    if (LedDriverValues[ledDriverId][ledIndex] != value) {
+        LedDriverValues[ledDriverId][ledIndex] = value;
+        markLedDirtyInEveryFrame(ledDriverStates + ledDriverId, ledIndex);
+    }
+}
+
+// Only the PWM value of the LED gets recomputed, and only if its intensity changed.
+void LedSlaveDriver_SetLedIntensity(uint8_t ledDriverId, uint8_t ledIndex, uint8_t intensity)
+{
+    if (LedDriverIntensities[ledDriverId][ledIndex] != intensity) {
+        LedDriverIntensities[ledDriverId][ledIndex] = intensity;
+        updatePwmValue(ledDriverId, ledIndex);
+    }
+}
+
+void LedSlaveDriver_SetLedIntensities(uint8_t ledDriverId, uint8_t intensity)
+{
+    LedSlaveDriver_BeginUpdate();
+    for (uint8_t ledIndex=0; ledIndex<LED_DRIVER_LED_COUNT; ledIndex++) {
+        LedSlaveDriver_SetLedIntensity(ledDriverId, ledIndex, intensity);
+    }
+    LedSlaveDriver_EndUpdate();
+}
+
+// Only the PWM values of the LEDs of the zone get recomputed, and only the ones that change get written.
+void LedSlaveDriver_SetZoneLevel(led_zone_t zone, uint8_t level)
+{
+    if (LedZoneLevels[zone] == level) {
+        return;
+    }
+
+    LedZoneLevels[zone] = level;
+    uint8_t ledDriverId = zone == LedZone_RightKeyBacklight ? LedDriverId_Right : LedDriverId_Left;
+    LedSlaveDriver_BeginUpdate();
+    for (uint8_t ledIndex=0; ledIndex<LED_DRIVER_LED_COUNT; ledIndex++) {
+        if (getLedZone(ledDriverId, ledIndex) == zone) {
+            updatePwmValue(ledDriverId, ledIndex);
+        }
+    }
+    LedSlaveDriver_EndUpdate();
+}
+
+// Changes of several LEDs that belong together are made between these, so that they are displayed at once.
+// Updates can be nested.
+void LedSlaveDriver_BeginUpdate(void)
+{
+    updateDepth++;
+}
+
+void LedSlaveDriver_EndUpdate(void)
+{
+    updateDepth--;
+}
+
+// The intensities are kept, so that LedSlaveDriver_UpdateLeds() brings every LED back.
 void LedSlaveDriver_DisableLeds(void)
 {
-    for (uint8_t ledDriverId=0; ledDriverId<=LedDriverId_Last; ledDriverId++) {
-        memset(LedDriverValues[ledDriverId], 0, LED_DRIVER_LED_COUNT);
+    LedSlaveDriver_BeginUpdate();
+    for (led_zone_t zone=0; zone<=LedZone_Last; zone++) {
+        LedSlaveDriver_SetZoneLevel(zone, 0);
     }
+    LedSlaveDriver_EndUpdate();
 }
 
 void LedSlaveDriver_UpdateLeds(void)
 {
+    LedSlaveDriver_BeginUpdate();
     for (uint8_t ledDriverId=0; ledDriverId<=LedDriverId_Last; ledDriverId++) {
-        memset(LedDriverValues[ledDriverId], KeyBacklightBrightness, LED_DRIVER_LED_COUNT);
+        LedSlaveDriver_SetLedIntensities(ledDriverId, UINT8_MAX);
     }
+    LedSlaveDriver_SetZoneLevel(LedZone_RightKeyBacklight, KeyBacklightBrightness);
+    LedSlaveDriver_SetZoneLevel(LedZone_LeftKeyBacklight, KeyBacklightBrightness);
+    LedSlaveDriver_SetZoneLevel(LedZone_Icons, IconsAndLayerTextsBrightness);
+    LedSlaveDriver_SetZoneLevel(LedZone_AlphanumericSegments, AlphanumericSegmentsBrightness);
 
     LedDisplay_UpdateAll();
+    LedSlaveDriver_EndUpdate();
 }
 
 void LedSlaveDriver_Init(uint8_t ledDriverId)
@@ -87,7 +271,16 @@ void LedSlaveDriver_Init(uint8_t ledDriverId)
     led_driver_state_t *currentLedDriverState = ledDriverStates + ledDriverId;
     currentLedDriverState->phase = LedDriverPhase_SetFunctionFrame;
     currentLedDriverState->ledIndex = 0;
-    memset(LedDriverValues[ledDriverId], KeyBacklightBrightness, LED_DRIVER_LED_COUNT);
+    currentLedDriverState->displayedFrame = LED_DRIVER_FRAME_1;
+    currentLedDriverState->selectedPage = LED_DRIVER_FRAME_2;
+    if (!currentLedDriverState->areLedValuesInitialized) {
+        memset(LedDriverIntensities[ledDriverId], UINT8_MAX, LED_DRIVER_LED_COUNT);
+        currentLedDriverState->areLedValuesInitialized = true;
+    }
+    for (uint8_t ledIndex=0; ledIndex<LED_DRIVER_LED_COUNT; ledIndex++) {
+        LedDriverValues[ledDriverId][ledIndex] = getPwmValue(ledDriverId, ledIndex);
+        markLedDirtyInEveryFrame(currentLedDriverState, ledIndex);
+    }
 
     if (ledDriverId == LedDriverId_Left) {
         LedDisplay_UpdateAll();
@@ -113,72 +306,107 @@ status_t LedSlaveDriver_Update(uint8_t ledDriverId)
             break;
         case LedDriverPhase_SetShutdownModeNormal:
             status = I2cAsyncWrite(ledDriverAddress, setShutdownModeNormalBuffer, sizeof(setShutdownModeNormalBuffer));
+            *ledDriverPhase = LedDriverPhase_SetPictureMode;
+            break;
+        case LedDriverPhase_SetPictureMode:
+            status = I2cAsyncWrite(ledDriverAddress, setPictureModeBuffer, sizeof(setPictureModeBuffer));
             *ledDriverPhase = LedDriverPhase_SetFrame1;
             break;
         case LedDriverPhase_SetFrame1:
             status = I2cAsyncWrite(ledDriverAddress, setFrame1Buffer, sizeof(setFrame1Buffer));
-            *ledDriverPhase = LedDriverPhase_InitLedControlRegisters;
+            *ledDriverPhase = LedDriverPhase_InitFrame1LedControlRegisters;
             break;
-        case LedDriverPhase_InitLedControlRegisters:
+        case LedDriverPhase_InitFrame1LedControlRegisters:
             status = I2cAsyncWrite(ledDriverAddress, currentLedDriverState->setupLedControlRegistersCommand, LED_CONTROL_REGISTERS_COMMAND_LENGTH);
-            *ledDriverPhase = LedDriverPhase_InitLedValues;
+            *ledDriverPhase = LedDriverPhase_SetFrame2;
             break;
-        case LedDriverPhase_InitLedValues:
-            updatePwmRegistersBuffer[0] = FRAME_REGISTER_PWM_FIRST + *ledIndex;
-            uint8_t chunkSize = MIN(LED_DRIVER_LED_COUNT - *ledIndex, PMW_REGISTER_UPDATE_CHUNK_SIZE);
-            memcpy(updatePwmRegistersBuffer+1, ledValues + *ledIndex, chunkSize);
-            status = I2cAsyncWrite(ledDriverAddress, updatePwmRegistersBuffer, chunkSize + 1);
-            *ledIndex += chunkSize;
-            if (*ledIndex >= LED_DRIVER_LED_COUNT) {
-                *ledIndex = 0;
-                memcpy(currentLedDriverState->targetLedValues, ledValues, LED_DRIVER_LED_COUNT);
-                *ledDriverPhase = LedDriverPhase_UpdateChangedLedValues;
-            }
+        case LedDriverPhase_SetFrame2:
+            status = I2cAsyncWrite(ledDriverAddress, setFrame2Buffer, sizeof(setFrame2Buffer));
+            *ledDriverPhase = LedDriverPhase_InitFrame2LedControlRegisters;
+            break;
+        case LedDriverPhase_InitFrame2LedControlRegisters:
+            status = I2cAsyncWrite(ledDriverAddress, currentLedDriverState->setupLedControlRegistersCommand, LED_CONTROL_REGISTERS_COMMAND_LENGTH);
+            *ledDriverPhase = LedDriverPhase_UpdateChangedLedValues;
             break;
         case LedDriverPhase_UpdateChangedLedValues: {
-            uint8_t *targetLedValues = currentLedDriverState->targetLedValues;
-
-            uint8_t lastLedChunkStartIndex = LED_DRIVER_LED_COUNT - PMW_REGISTER_UPDATE_CHUNK_SIZE;
-            uint8_t startLedIndex = *ledIndex > lastLedChunkStartIndex ? lastLedChunkStartIndex : *ledIndex;
+            uint8_t backFrame = currentLedDriverState->displayedFrame ^ 1;
+            uint32_t *dirtyLeds = currentLedDriverState->dirtyLeds[backFrame];
+            uint8_t startLedIndex = findDirtyLed(dirtyLeds, *ledIndex);
+            if (startLedIndex == LED_DRIVER_LED_COUNT) {
+                startLedIndex = findDirtyLed(dirtyLeds, 0);
+            }
 
-            uint8_t count;
-            for (count=0; count<LED_DRIVER_LED_COUNT; count++) {
-                if (ledValues[startLedIndex] != targetLedValues[startLedIndex]) {
+            // Once the back frame is complete, it gets displayed if the displayed frame lacks some of its changes.
+            // The former displayed frame becomes the back frame, which catches up with those changes.
+            if (startLedIndex == LED_DRIVER_LED_COUNT) {
+                bool isDisplayedFrameDirty = findDirtyLed(currentLedDriverState->dirtyLeds[currentLedDriverState->displayedFrame], 0) < LED_DRIVER_LED_COUNT;
+                if (!isDisplayedFrameDirty || updateDepth) {
                     break;
                 }
-
-                if (++startLedIndex >= LED_DRIVER_LED_COUNT) {
-                    startLedIndex = 0;
+                if (currentLedDriverState->selectedPage != LED_DRIVER_FRAME_FUNCTION) {
+                    selectPageBuffer[1] = LED_DRIVER_FRAME_FUNCTION;
+                    status = I2cAsyncWrite(ledDriverAddress, selectPageBuffer, sizeof(selectPageBuffer));
+                    currentLedDriverState->selectedPage = LED_DRIVER_FRAME_FUNCTION;
+                    LedDriverTelemetry.updateByteCount[ledDriverId] += 1 + sizeof(selectPageBuffer);
+                } else {
+                    setPictureDisplayBuffer[1] = backFrame;
+                    status = I2cAsyncWrite(ledDriverAddress, setPictureDisplayBuffer, sizeof(setPictureDisplayBuffer));
+                    currentLedDriverState->displayedFrame = backFrame;
+                    LedDriverTelemetry.frameFlipCount[ledDriverId]++;
+                    LedDriverTelemetry.updateByteCount[ledDriverId] += 1 + sizeof(setPictureDisplayBuffer);
                 }
-            }
-
-            bool foundStartIndex = count < LED_DRIVER_LED_COUNT;
-            if (!foundStartIndex) {
-                *ledIndex = 0;
                 break;
             }
 
-            uint8_t maxChunkSize = MIN(LED_DRIVER_LED_COUNT - startLedIndex, PMW_REGISTER_UPDATE_CHUNK_SIZE);
-            uint8_t maxEndLedIndex = startLedIndex + maxChunkSize - 1;
-            uint8_t endLedIndex = startLedIndex;
-            for (uint8_t index=startLedIndex; index<=maxEndLedIndex; index++) {
-                if (ledValues[index] != targetLedValues[index]) {
-                    endLedIndex = index;
-                }
+            if (currentLedDriverState->selectedPage != backFrame) {
+                selectPageBuffer[1] = backFrame;
+                status = I2cAsyncWrite(ledDriverAddress, selectPageBuffer, sizeof(selectPageBuffer));
+                currentLedDriverState->selectedPage = backFrame;
+                LedDriverTelemetry.updateByteCount[ledDriverId] += 1 + sizeof(selectPageBuffer);
+                break;
             }
 
+            uint8_t endLedIndex = findWriteEndLed(dirtyLeds, startLedIndex);
             updatePwmRegistersBuffer[0] = FRAME_REGISTER_PWM_FIRST + startLedIndex;
             uint8_t length = endLedIndex - startLedIndex + 1;
             memcpy(updatePwmRegistersBuffer+1, ledValues + startLedIndex, length);
-            memcpy(currentLedDriverState->targetLedValues + startLedIndex, ledValues + startLedIndex, length);
-            status = I2cAsyncWrite(ledDriverAddress, updatePwmRegistersBuffer, length+1);
-            *ledIndex += length;
-            if (*ledIndex >= LED_DRIVER_LED_COUNT) {
-                *ledIndex = 0;
+            for (uint8_t index=startLedIndex; index<=endLedIndex; index++) {
+                markLedClean(dirtyLeds, index);
             }
+            status = I2cAsyncWrite(ledDriverAddress, updatePwmRegistersBuffer, length+1);
+            LedDriverTelemetry.pwmWriteCount[ledDriverId]++;
+            LedDriverTelemetry.pwmByteCount[ledDriverId] += length;
+            LedDriverTelemetry.updateByteCount[ledDriverId] += 1 + 1 + length;
+            *ledIndex = endLedIndex + 1 < LED_DRIVER_LED_COUNT ? endLedIndex + 1 : 0;
             break;
         }
     }
 
     return status;
 }
+
+// Returns how many bytes LedSlaveDriver_Update() writes at most, with the I2C address bytes, when the LEDs become
+// dirty in every frame of a driver that is up to date. Every frame takes its own PWM writes, a page select to
+// reach it and a page select and a flip to display it. The PWM writes can be split once more where the update
+// resumes at ledIndex instead of at the first LED.
+uint16_t LedSlaveDriver_GetUpdateByteCount(const uint32_t *leds)
+{
+    uint8_t startLedIndex = findDirtyLed(leds, 0);
+    if (startLedIndex == LED_DRIVER_LED_COUNT) {
+        return 0;
+    }
+
+    uint16_t frameByteCount = 2 * (1 + sizeof(selectPageBuffer)) + 1 + sizeof(setPictureDisplayBuffer) + 1 + 1;
+    while (startLedIndex < LED_DRIVER_LED_COUNT) {
+        uint8_t endLedIndex = findWriteEndLed(leds, startLedIndex);
+        frameByteCount += 1 + 1 + endLedIndex - startLedIndex + 1;
+        startLedIndex = endLedIndex + 1 < LED_DRIVER_LED_COUNT ? findDirtyLed(leds, endLedIndex + 1) : LED_DRIVER_LED_COUNT;
+    }
+    return LED_DRIVER_BUFFERED_FRAME_COUNT * frameByteCount;
+}
+
+void LedSlaveDriver_ResetTelemetry(void)
+{
+    memset(&LedDriverTelemetry, 0, sizeof(LedDriverTelemetry));
+    LedDriverTelemetry.startMicros = Timer_GetCurrentTimeMicros();
+}
@@ -13,6 +13,15 @@
     #define PMW_REGISTER_UPDATE_CHUNK_SIZE 8
     #define PWM_REGISTER_BUFFER_LENGTH (1 + PMW_REGISTER_UPDATE_CHUNK_SIZE)
 
+    // Unchanged LEDs between two changed ones are written along with them up to this many, which takes less bus
+    // time than the start condition, address, register and stop condition of a separate write.
+    #define PWM_REGISTER_UPDATE_MAX_GAP 3
+
+    #define LED_DRIVER_DIRTY_WORD_COUNT ((LED_DRIVER_LED_COUNT + 31) / 32)
+
+    // Updates are written to the frame that isn't displayed, and the frames are flipped once it is complete.
+    #define LED_DRIVER_BUFFERED_FRAME_COUNT 2
+
     #define IS_ISO true
     #define ISO_KEY_LED_DRIVER_ID LedDriverId_Left
     #define ISO_KEY_CONTROL_REGISTER_POS 7
@@ -29,30 +38,65 @@
     typedef enum {
         LedDriverPhase_SetFunctionFrame,
         LedDriverPhase_SetShutdownModeNormal,
+        LedDriverPhase_SetPictureMode,
         LedDriverPhase_SetFrame1,
-        LedDriverPhase_InitLedControlRegisters,
-        LedDriverPhase_InitLedValues,
+        LedDriverPhase_InitFrame1LedControlRegisters,
+        LedDriverPhase_SetFrame2,
+        LedDriverPhase_InitFrame2LedControlRegisters,
         LedDriverPhase_UpdateChangedLedValues,
     } led_driver_phase_t;
 
+    // Every LED belongs to a zone, and its PWM value is the gamma corrected product of its intensity and the
+    // level of its zone.
+    typedef enum {
+        LedZone_RightKeyBacklight,
+        LedZone_LeftKeyBacklight,
+        LedZone_Icons,                 // The icons and the layer texts of the display
+        LedZone_AlphanumericSegments,
+        LedZone_Last = LedZone_AlphanumericSegments,
+    } led_zone_t;
+
     typedef struct {
         led_driver_phase_t phase;
-        uint8_t targetLedValues[LED_DRIVER_LED_COUNT];
-        uint8_t ledIndex;
+        // The LEDs whose LedDriverValues haven't been written to each frame yet
+        uint32_t dirtyLeds[LED_DRIVER_BUFFERED_FRAME_COUNT][LED_DRIVER_DIRTY_WORD_COUNT];
+        uint8_t ledIndex;  // Where the search for the next dirty LED starts, so that every LED gets its turn
+        uint8_t displayedFrame;
+        uint8_t selectedPage;  // The page that the frame register of the chip points to
+        bool areLedValuesInitialized;  // A reconnecting driver gets the current LedDriverValues instead of the defaults
         uint8_t i2cAddress;
         uint8_t setupLedControlRegistersCommand[LED_CONTROL_REGISTERS_COMMAND_LENGTH];
     } led_driver_state_t;
 
+    typedef struct {
+        uint32_t startMicros;
+        uint32_t pwmWriteCount[LED_DRIVER_MAX_COUNT];
+        uint32_t pwmByteCount[LED_DRIVER_MAX_COUNT];  // PWM register bytes written, without the register address
+        uint32_t frameFlipCount[LED_DRIVER_MAX_COUNT];
+        uint32_t updateByteCount[LED_DRIVER_MAX_COUNT];  // Bytes of the PWM writes, page selects and frame flips, with the I2C address
+    } led_driver_telemetry_t;
+
 // Variables:
 
     extern uint8_t KeyBacklightBrightness;
-    extern uint8_t LedDriverValues[LED_DRIVER_MAX_COUNT][LED_DRIVER_LED_COUNT];
+    extern uint8_t LedDriverIntensities[LED_DRIVER_MAX_COUNT][LED_DRIVER_LED_COUNT];
+    extern uint8_t LedZoneLevels[LedZone_Last + 1];
+    extern uint8_t LedDriverValues[LED_DRIVER_MAX_COUNT][LED_DRIVER_LED_COUNT];  // The PWM values
+    extern led_driver_telemetry_t LedDriverTelemetry;
 
 // Functions:
 
+    bool LedSlaveDriver_IsLedEnabled(uint8_t ledDriverId, uint8_t ledIndex);
+    void LedSlaveDriver_SetLedIntensity(uint8_t ledDriverId, uint8_t ledIndex, uint8_t intensity);
+    void LedSlaveDriver_SetLedIntensities(uint8_t ledDriverId, uint8_t intensity);
+    void LedSlaveDriver_SetZoneLevel(led_zone_t zone, uint8_t level);
+    void LedSlaveDriver_BeginUpdate(void);
+    void LedSlaveDriver_EndUpdate(void);
     void LedSlaveDriver_DisableLeds(void);
     void LedSlaveDriver_UpdateLeds(void);
     void LedSlaveDriver_Init(uint8_t ledDriverId);
     status_t LedSlaveDriver_Update(uint8_t ledDriverId);
+    uint16_t LedSlaveDriver_GetUpdateByteCount(const uint32_t *leds);
+    void LedSlaveDriver_ResetTelemetry(void);
 
 #endif
@@ -4,12 +4,12 @@
 #include "slave_drivers/uhk_module_driver.h"
 #include "slave_protocol.h"
 #include "peripherals/test_led.h"
-#include "bool_array_converter.h"
 #include "crc16.h"
 #include "key_states.h"
+#include "module_key_events.h"
+#include "bool_array_converter.h"
 
 uhk_module_state_t UhkModuleStates[UHK_MODULE_MAX_COUNT];
-static uint8_t keyStatesBuffer[MAX_KEY_COUNT_PER_MODULE];
 static i2c_message_t txMessage;
 
 static uhk_module_i2c_addresses_t moduleIdsToI2cAddresses[] = {
@@ -32,37 +32,300 @@ static status_t tx(uint8_t i2cAddress)
     return I2cAsyncWriteMessage(i2cAddress, &txMessage);
 }
 
-static status_t rx(i2c_message_t *rxMessage, uint8_t i2cAddress)
+static status_t txrx(i2c_message_t *rxMessage, uint8_t i2cAddress)
 {
-    return I2cAsyncReadMessage(i2cAddress, rxMessage);
+    return I2cAsyncWriteReadMessage(i2cAddress, &txMessage, rxMessage);
 }
 
-void UhkModuleSlaveDriver_Init(uint8_t uhkModuleDriverId)
+static uint64_t getKeyStates(uhk_module_state_t *uhkModuleState, const uint8_t *keyStateBits)
 {
-    uhk_module_state_t *uhkModuleState = UhkModuleStates + uhkModuleDriverId;
-    uhk_module_vars_t *uhkModuleSourceVars = &uhkModuleState->sourceVars;
-    uhk_module_vars_t *uhkModuleTargetVars = &uhkModuleState->targetVars;
+    uint64_t keyStates = 0;
+    for (uint8_t byteId=0; byteId*8<uhkModuleState->keyCount; byteId++) {
+        keyStates |= (uint64_t)keyStateBits[byteId] << (byteId*8);
+    }
+    if (uhkModuleState->keyCount < MAX_KEY_COUNT_PER_MODULE) {
+        keyStates &= KEY_STATE_BIT(uhkModuleState->keyCount) - 1;
+    }
+    return keyStates;
+}
+
+// Queues key events with the time they were scanned, which is reconstructed backwards from the start of the reply
+// by the tick deltas, and applies them to LeftKeyStates, unless the reply carried the key states that already
+// reflect them.
+static void applyKeyEvents(uint8_t slotId, uhk_module_state_t *uhkModuleState, const slave_key_event_t *events,
+    uint8_t eventCount, uint16_t ticksSinceLastEvent, bool hasKeyStates, uint32_t replyTimeMicros)
+{
+    uint32_t ticksSinceFirstEvent = ticksSinceLastEvent;
+    for (uint8_t eventId = 1; eventId < eventCount; eventId++) {
+        ticksSinceFirstEvent += events[eventId].tickDelta;
+    }
 
-    uhkModuleSourceVars->isTestLedOn = true;
-    uhkModuleTargetVars->isTestLedOn = false;
+    uint32_t eventTime = replyTimeMicros - ticksSinceFirstEvent * uhkModuleState->keyEventTickUsec;
+    for (uint8_t eventId = 0; eventId < eventCount; eventId++) {
+        const slave_key_event_t *event = events + eventId;
+        uint8_t keyId = event->keyIdAndState & SLAVE_KEY_EVENT_KEY_ID_MASK;
+        bool isPressed = event->keyIdAndState & SLAVE_KEY_EVENT_PRESSED;
+        if (eventId) {
+            eventTime += event->tickDelta * uhkModuleState->keyEventTickUsec;
+        }
+        if (keyId >= uhkModuleState->keyCount) {
+            continue;
+        }
+        if (!hasKeyStates) {
+            if (isPressed) {
+                LeftKeyStates[slotId] |= KEY_STATE_BIT(keyId);
+            } else {
+                LeftKeyStates[slotId] &= ~KEY_STATE_BIT(keyId);
+            }
+        }
+        ModuleKeyEvents_Push(slotId, keyId, isPressed, eventTime);
+    }
+}
 
-    uhkModuleSourceVars->ledPwmBrightness = MAX_PWM_BRIGHTNESS;
-    uhkModuleTargetVars->ledPwmBrightness = 0;
+static void resyncKeyStates(uint8_t slotId, uhk_module_state_t *uhkModuleState, const uint8_t *keyStateBits)
+{
+    LeftKeyStates[slotId] = getKeyStates(uhkModuleState, keyStateBits);
+    ModuleKeyEvents_Resync(slotId);
+}
 
-    uhk_module_phase_t *uhkModulePhase = &uhkModuleState->phase;
-    *uhkModulePhase = UhkModulePhase_RequestSync;
+// Processes a SlaveCommand_RequestKeyEvents reply. If it carries the key states, because they were requested or
+// the module overflowed, the queue is resynchronized to them. Returns false if the reply is malformed.
+static bool processKeyEvents(uint8_t slotId, uhk_module_state_t *uhkModuleState, i2c_message_t *rxMessage,
+    uint32_t replyTimeMicros)
+{
+    slave_key_events_header_t *header = (slave_key_events_header_t*)rxMessage->data;
+    slave_key_event_t *events = (slave_key_event_t*)(rxMessage->data + sizeof(slave_key_events_header_t));
+    uint16_t eventsLength = header->eventCount * sizeof(slave_key_event_t);
+    bool hasKeyStates = header->flags & SlaveKeyEventsFlag_KeyStates;
+    uint16_t keyStatesLength = hasKeyStates ? BOOL_BYTES_TO_BITS_COUNT(uhkModuleState->keyCount) : 0;
+
+    if (rxMessage->length < sizeof(slave_key_events_header_t) + eventsLength + keyStatesLength) {
+        return false;
+    }
+
+    if (hasKeyStates) {
+        resyncKeyStates(slotId, uhkModuleState, (uint8_t*)events + eventsLength);
+    }
+    if (!(header->flags & SlaveKeyEventsFlag_Overflow)) {
+        applyKeyEvents(slotId, uhkModuleState, events, header->eventCount, header->ticksSinceLastEvent, hasKeyStates,
+            replyTimeMicros);
+    }
+    return true;
+}
+
+// Processes a SlaveCommand_RequestKeyDeltas reply and acknowledges it with the next request. Returns false if the
+// reply is malformed, in which case the module sends its events again.
+static bool processKeyDeltas(uint8_t slotId, uhk_module_state_t *uhkModuleState, i2c_message_t *rxMessage,
+    uint32_t replyTimeMicros)
+{
+    uint8_t header = rxMessage->data[0];
+    uint8_t eventCount = 0;
+    uint16_t ticksSinceLastEvent = 0;
+    uint16_t length = 1;
+
+    if (rxMessage->length < length) {
+        return false;
+    }
+    if (header & SlaveKeyDeltasFlag_Events) {
+        if (rxMessage->length < length + 1 + sizeof(ticksSinceLastEvent)) {
+            return false;
+        }
+        eventCount = rxMessage->data[length++];
+        memcpy(&ticksSinceLastEvent, rxMessage->data + length, sizeof(ticksSinceLastEvent));
+        length += sizeof(ticksSinceLastEvent);
+    }
+    slave_key_event_t *events = (slave_key_event_t*)(rxMessage->data + length);
+    length += eventCount * sizeof(slave_key_event_t);
+    bool hasKeyStates = header & SlaveKeyDeltasFlag_KeyStates;
+    if (rxMessage->length < length + (hasKeyStates ? BOOL_BYTES_TO_BITS_COUNT(uhkModuleState->keyCount) : 0)) {
+        return false;
+    }
+
+    if (hasKeyStates) {
+        resyncKeyStates(slotId, uhkModuleState, rxMessage->data + length);
+        uhkModuleState->isKeyStatesRequested = false;
+    }
+    applyKeyEvents(slotId, uhkModuleState, events, eventCount, ticksSinceLastEvent, hasKeyStates, replyTimeMicros);
+    uhkModuleState->keyDeltaSequence = header & SLAVE_KEY_DELTAS_SEQUENCE_MASK;
+    return true;
+}
+
+static bool isModuleProtocolAtLeast(uhk_module_state_t *uhkModuleState, uint16_t major, uint16_t minor)
+{
+    version_t *moduleProtocolVersion = &uhkModuleState->moduleProtocolVersion;
+    return moduleProtocolVersion->major > major ||
+        (moduleProtocolVersion->major == major && moduleProtocolVersion->minor >= minor);
+}
+
+static void getIdentity(uhk_module_state_t *uhkModuleState, slave_identity_t *identity)
+{
+    memcpy(identity->sync, SlaveSyncString, SLAVE_SYNC_STRING_LENGTH);
+    identity->moduleProtocolVersion = uhkModuleState->moduleProtocolVersion;
+    identity->firmwareVersion = uhkModuleState->firmwareVersion;
+    identity->moduleId = uhkModuleState->moduleId;
+    identity->keyCount = uhkModuleState->keyCount;
+    identity->pointerCount = uhkModuleState->pointerCount;
+    identity->keyEventTickUsec = uhkModuleState->keyEventTickUsec;
+}
+
+static void setIdentity(uhk_module_state_t *uhkModuleState, const slave_identity_t *identity)
+{
+    uhkModuleState->moduleProtocolVersion = identity->moduleProtocolVersion;
+    uhkModuleState->firmwareVersion = identity->firmwareVersion;
+    uhkModuleState->moduleId = identity->moduleId;
+    uhkModuleState->keyCount = identity->keyCount;
+    uhkModuleState->pointerCount = identity->pointerCount;
+    uhkModuleState->keyEventTickUsec = identity->keyEventTickUsec;
+}
+
+// Called once the identity of the module is known. If the module has been polled with a cached identity that
+// turns out to be wrong, the key states that it reported are dropped and requested again.
+static void finishHandshake(uint8_t uhkModuleDriverId, uhk_module_state_t *uhkModuleState)
+{
+    slave_identity_t identity;
+    getIdentity(uhkModuleState, &identity);
+
+    if (!uhkModuleState->isIdentityVerified && memcmp(&identity, &uhkModuleState->cachedIdentity, sizeof(identity))) {
+        uint8_t slotId = UHK_MODULE_DRIVER_ID_TO_SLOT_ID(uhkModuleDriverId);
+        LeftKeyStates[slotId] = 0;
+        ModuleKeyEvents_Resync(slotId);
+        uhkModuleState->isKeyStatesRequested = true;
+        uhkModuleState->keyDeltaSequence = 0;
+    }
+
+    uhkModuleState->cachedIdentity = identity;
+    uhkModuleState->isIdentityCached = true;
+    uhkModuleState->isIdentityVerified = true;
+    uhkModuleState->phase = UhkModulePhase_RequestKeyStates;
+}
+
+// Returns the queued command with the command ID that isn't being sent yet, or NULL if there is none.
+static uhk_module_command_t *findQueuedCommand(uhk_module_command_queue_t *commandQueue, slave_command_t commandId)
+{
+    for (uint8_t i = commandQueue->sentCount; i < commandQueue->count; i++) {
+        if (commandQueue->commands[i].commandId == commandId) {
+            return commandQueue->commands + i;
+        }
+    }
+    return NULL;
+}
+
+// Sends every queued command in one SlaveCommand_Batch message, or only the oldest one to modules that don't know
+// the batch command yet. The sent commands stay queued until removeSentCommands().
+static status_t sendCommands(uhk_module_state_t *uhkModuleState, uint8_t i2cAddress)
+{
+    uhk_module_command_queue_t *commandQueue = &uhkModuleState->commandQueue;
+    uint8_t sentCount;
+
+    uint32_t primask = DisableGlobalIRQ();
+    if (isModuleProtocolAtLeast(uhkModuleState, 4, 4)) {
+        txMessage.data[0] = SlaveCommand_Batch;
+        txMessage.length = 1;
+        for (sentCount = 0; sentCount < commandQueue->count; sentCount++) {
+            uhk_module_command_t *command = commandQueue->commands + sentCount;
+            slave_batch_command_header_t header = {
+                .commandId = command->commandId,
+                .length = command->length,
+            };
+            memcpy(txMessage.data + txMessage.length, &header, sizeof(header));
+            txMessage.length += sizeof(header);
+            memcpy(txMessage.data + txMessage.length, command->value, command->length);
+            txMessage.length += command->length;
+        }
+    } else {
+        uhk_module_command_t *command = commandQueue->commands;
+        txMessage.data[0] = command->commandId;
+        memcpy(txMessage.data + 1, command->value, command->length);
+        txMessage.length = 1 + command->length;
+        sentCount = 1;
+    }
+    commandQueue->sentCount = sentCount;
+    EnableGlobalIRQ(primask);
+
+    return tx(i2cAddress);
+}
+
+// Queues the command, or gives the queued command that isn't being sent yet the new value. Returns false if the
+// queue is full.
+static bool queueCommand(uhk_module_command_queue_t *commandQueue, slave_command_t commandId, const uint8_t *value,
+    uint8_t length)
+{
+    uhk_module_command_t *command = findQueuedCommand(commandQueue, commandId);
+    if (!command && commandQueue->count < UHK_MODULE_COMMAND_QUEUE_LENGTH) {
+        command = commandQueue->commands + commandQueue->count++;
+    }
+    if (command) {
+        command->commandId = commandId;
+        command->length = length;
+        memcpy(command->value, value, length);
+    }
+    return command;
+}
+
+static void removeSentCommands(uhk_module_state_t *uhkModuleState)
+{
+    uhk_module_command_queue_t *commandQueue = &uhkModuleState->commandQueue;
+
+    uint32_t primask = DisableGlobalIRQ();
+    for (uint8_t i = 0; i < commandQueue->sentCount; i++) {
+        uhk_module_command_t *command = commandQueue->commands + i;
+        queueCommand(&uhkModuleState->appliedCommands, command->commandId, command->value, command->length);
+    }
+    commandQueue->count -= commandQueue->sentCount;
+    memmove(commandQueue->commands, commandQueue->commands + commandQueue->sentCount, commandQueue->count * sizeof(uhk_module_command_t));
+    commandQueue->sentCount = 0;
+    EnableGlobalIRQ(primask);
+}
+
+void UhkModuleSlaveDriver_Init(uint8_t uhkModuleDriverId)
+{
+    uhk_module_state_t *uhkModuleState = UhkModuleStates + uhkModuleDriverId;
+    uint8_t isTestLedOn = true;
+    uint8_t ledPwmBrightness = MAX_PWM_BRIGHTNESS;
+
+    // Init follows every failed transfer, so the commands whose transfer failed are sent again. The module may
+    // have been reset too, so it gets the last applied value of every other command again, or the default.
+    uhk_module_command_queue_t *commandQueue = &uhkModuleState->commandQueue;
+    uhk_module_command_queue_t *appliedCommands = &uhkModuleState->appliedCommands;
+    commandQueue->sentCount = 0;
+    if (!findQueuedCommand(appliedCommands, SlaveCommand_SetTestLed)) {
+        queueCommand(appliedCommands, SlaveCommand_SetTestLed, &isTestLedOn, sizeof(isTestLedOn));
+    }
+    if (!findQueuedCommand(appliedCommands, SlaveCommand_SetLedPwmBrightness)) {
+        queueCommand(appliedCommands, SlaveCommand_SetLedPwmBrightness, &ledPwmBrightness, sizeof(ledPwmBrightness));
+    }
+    uint32_t primask = DisableGlobalIRQ();
+    for (uint8_t i = 0; i < appliedCommands->count; i++) {
+        uhk_module_command_t *command = appliedCommands->commands + i;
+        if (!findQueuedCommand(commandQueue, command->commandId)) {
+            queueCommand(commandQueue, command->commandId, command->value, command->length);
+        }
+    }
+    EnableGlobalIRQ(primask);
 
     uhk_module_i2c_addresses_t *uhkModuleI2cAddresses = moduleIdsToI2cAddresses + uhkModuleDriverId;
     uhkModuleState->firmwareI2cAddress = uhkModuleI2cAddresses->firmwareI2cAddress;
     uhkModuleState->bootloaderI2cAddress = uhkModuleI2cAddresses->bootloaderI2cAddress;
+    uhkModuleState->isKeyStatesRequested = true;
+    uhkModuleState->keyDeltaSequence = 0;
+    uhkModuleState->invalidKeyDeltaReplyCount = 0;
+
+    uhk_module_phase_t *uhkModulePhase = &uhkModuleState->phase;
+    if (uhkModuleState->isIdentityCached) {
+        setIdentity(uhkModuleState, &uhkModuleState->cachedIdentity);
+        uhkModuleState->isIdentityVerified = false;
+        *uhkModulePhase = UhkModulePhase_RequestKeyStates;
+    } else {
+        uhkModuleState->keyEventTickUsec = 0;
+        uhkModuleState->isIdentityVerified = true;
+        *uhkModulePhase = UhkModulePhase_RequestIdentity;
+    }
 }
 
 status_t UhkModuleSlaveDriver_Update(uint8_t uhkModuleDriverId)
 {
     status_t status = kStatus_Uhk_IdleSlave;
     uhk_module_state_t *uhkModuleState = UhkModuleStates + uhkModuleDriverId;
-    uhk_module_vars_t *uhkModuleSourceVars = &uhkModuleState->sourceVars;
-    uhk_module_vars_t *uhkModuleTargetVars = &uhkModuleState->targetVars;
     uhk_module_phase_t *uhkModulePhase = &uhkModuleState->phase;
     uint8_t i2cAddress = uhkModuleState->firmwareI2cAddress;
     i2c_message_t *rxMessage = &uhkModuleState->rxMessage;
@@ -76,22 +339,41 @@ status_t UhkModuleSlaveDriver_Update(uint8_t uhkModuleDriverId)
             status = tx(i2cAddress);
             break;
 
+        // Get every property in one message, or fall back to one message per property for older modules
+        case UhkModulePhase_RequestIdentity:
+            txMessage.data[0] = SlaveCommand_RequestProperty;
+            txMessage.data[1] = SlaveProperty_Identity;
+            txMessage.length = 2;
+            status = txrx(rxMessage, i2cAddress);
+            *uhkModulePhase = UhkModulePhase_ProcessIdentity;
+            break;
+        case UhkModulePhase_ProcessIdentity: {
+            slave_identity_t *identity = (slave_identity_t*)rxMessage->data;
+            bool isIdentityValid = CRC16_IsMessageValid(rxMessage) && rxMessage->length == sizeof(slave_identity_t) &&
+                memcmp(identity->sync, SlaveSyncString, SLAVE_SYNC_STRING_LENGTH) == 0;
+            status = kStatus_Uhk_IdleCycle;
+            if (isIdentityValid) {
+                setIdentity(uhkModuleState, identity);
+                finishHandshake(uhkModuleDriverId, uhkModuleState);
+            } else {
+                *uhkModulePhase = UhkModulePhase_RequestSync;
+            }
+            break;
+        }
+
         // Sync communication
         case UhkModulePhase_RequestSync:
             txMessage.data[0] = SlaveCommand_RequestProperty;
             txMessage.data[1] = SlaveProperty_Sync;
             txMessage.length = 2;
-            status = tx(i2cAddress);
-            *uhkModulePhase = UhkModulePhase_ReceiveSync;
-            break;
-        case UhkModulePhase_ReceiveSync:
-            status = rx(rxMessage, i2cAddress);
+            status = txrx(rxMessage, i2cAddress);
             *uhkModulePhase = UhkModulePhase_ProcessSync;
             break;
         case UhkModulePhase_ProcessSync: {
-            bool isMessageValid = CRC16_IsMessageValid(rxMessage);
+            bool isMessageValid = CRC16_IsMessageValid(rxMessage) && rxMessage->length == SLAVE_SYNC_STRING_LENGTH;
             bool isSyncValid = memcmp(rxMessage->data, SlaveSyncString, SLAVE_SYNC_STRING_LENGTH) == 0;
             status = kStatus_Uhk_IdleCycle;
+            uhkModuleState->keyEventTickUsec = 0;
             *uhkModulePhase = isSyncValid && isMessageValid
                 ? UhkModulePhase_RequestModuleProtocolVersion
                 : UhkModulePhase_RequestSync;
@@ -103,15 +385,11 @@ status_t UhkModuleSlaveDriver_Update(uint8_t uhkModuleDriverId)
             txMessage.data[0] = SlaveCommand_RequestProperty;
             txMessage.data[1] = SlaveProperty_ModuleProtocolVersion;
             txMessage.length = 2;
-            status = tx(i2cAddress);
-            *uhkModulePhase = UhkModulePhase_ReceiveModuleProtocolVersion;
-            break;
-        case UhkModulePhase_ReceiveModuleProtocolVersion:
-            status = rx(rxMessage, i2cAddress);
+            status = txrx(rxMessage, i2cAddress);
             *uhkModulePhase = UhkModulePhase_ProcessModuleProtocolVersion;
             break;
         case UhkModulePhase_ProcessModuleProtocolVersion: {
-            bool isMessageValid = CRC16_IsMessageValid(rxMessage);
+            bool isMessageValid = CRC16_IsMessageValid(rxMessage) && rxMessage->length == sizeof(version_t);
             if (isMessageValid) {
                 memcpy(&uhkModuleState->moduleProtocolVersion, rxMessage->data, sizeof(version_t));
             }
@@ -125,15 +403,11 @@ status_t UhkModuleSlaveDriver_Update(uint8_t uhkModuleDriverId)
             txMessage.data[0] = SlaveCommand_RequestProperty;
             txMessage.data[1] = SlaveProperty_FirmwareVersion;
             txMessage.length = 2;
-            status = tx(i2cAddress);
-            *uhkModulePhase = UhkModulePhase_ReceiveFirmwareVersion;
-            break;
-        case UhkModulePhase_ReceiveFirmwareVersion:
-            status = rx(rxMessage, i2cAddress);
+            status = txrx(rxMessage, i2cAddress);
             *uhkModulePhase = UhkModulePhase_ProcessFirmwareVersion;
             break;
         case UhkModulePhase_ProcessFirmwareVersion: {
-            bool isMessageValid = CRC16_IsMessageValid(rxMessage);
+            bool isMessageValid = CRC16_IsMessageValid(rxMessage) && rxMessage->length == sizeof(version_t);
             if (isMessageValid) {
                 memcpy(&uhkModuleState->firmwareVersion, rxMessage->data, sizeof(version_t));
             }
@@ -147,15 +421,11 @@ status_t UhkModuleSlaveDriver_Update(uint8_t uhkModuleDriverId)
             txMessage.data[0] = SlaveCommand_RequestProperty;
             txMessage.data[1] = SlaveProperty_ModuleId;
             txMessage.length = 2;
-            status = tx(i2cAddress);
-            *uhkModulePhase = UhkModulePhase_ReceiveModuleId;
-            break;
-        case UhkModulePhase_ReceiveModuleId:
-            status = rx(rxMessage, i2cAddress);
+            status = txrx(rxMessage, i2cAddress);
             *uhkModulePhase = UhkModulePhase_ProcessModuleId;
             break;
         case UhkModulePhase_ProcessModuleId: {
-            bool isMessageValid = CRC16_IsMessageValid(rxMessage);
+            bool isMessageValid = CRC16_IsMessageValid(rxMessage) && rxMessage->length == 1;
             if (isMessageValid) {
                 uhkModuleState->moduleId = rxMessage->data[0];
             }
@@ -169,15 +439,11 @@ status_t UhkModuleSlaveDriver_Update(uint8_t uhkModuleDriverId)
             txMessage.data[0] = SlaveCommand_RequestProperty;
             txMessage.data[1] = SlaveProperty_KeyCount;
             txMessage.length = 2;
-            status = tx(i2cAddress);
-            *uhkModulePhase = UhkModulePhase_ReceiveModuleKeyCount;
-            break;
-        case UhkModulePhase_ReceiveModuleKeyCount:
-            status = rx(rxMessage, i2cAddress);
+            status = txrx(rxMessage, i2cAddress);
             *uhkModulePhase = UhkModulePhase_ProcessModuleKeyCount;
             break;
         case UhkModulePhase_ProcessModuleKeyCount: {
-            bool isMessageValid = CRC16_IsMessageValid(rxMessage);
+            bool isMessageValid = CRC16_IsMessageValid(rxMessage) && rxMessage->length == 1;
             if (isMessageValid) {
                 uhkModuleState->keyCount = rxMessage->data[0];
             }
@@ -191,71 +457,112 @@ status_t UhkModuleSlaveDriver_Update(uint8_t uhkModuleDriverId)
             txMessage.data[0] = SlaveCommand_RequestProperty;
             txMessage.data[1] = SlaveProperty_PointerCount;
             txMessage.length = 2;
-            status = tx(i2cAddress);
-            *uhkModulePhase = UhkModulePhase_ReceiveModulePointerCount;
-            break;
-        case UhkModulePhase_ReceiveModulePointerCount:
-            status = rx(rxMessage, i2cAddress);
+            status = txrx(rxMessage, i2cAddress);
             *uhkModulePhase = UhkModulePhase_ProcessModulePointerCount;
             break;
         case UhkModulePhase_ProcessModulePointerCount: {
-            bool isMessageValid = CRC16_IsMessageValid(rxMessage);
+            bool isMessageValid = CRC16_IsMessageValid(rxMessage) && rxMessage->length == 1;
             if (isMessageValid) {
                 uhkModuleState->pointerCount = rxMessage->data[0];
             }
+            bool hasKeyEvents = isModuleProtocolAtLeast(uhkModuleState, 4, 1);
             status = kStatus_Uhk_IdleCycle;
-            *uhkModulePhase = isMessageValid ? UhkModulePhase_RequestKeyStates : UhkModulePhase_RequestModulePointerCount;
+            if (!isMessageValid) {
+                *uhkModulePhase = UhkModulePhase_RequestModulePointerCount;
+            } else if (hasKeyEvents) {
+                *uhkModulePhase = UhkModulePhase_RequestKeyEventTickUsec;
+            } else {
+                finishHandshake(uhkModuleDriverId, uhkModuleState);
+            }
             break;
         }
 
-        // Get key states
-        case UhkModulePhase_RequestKeyStates:
-            txMessage.data[0] = SlaveCommand_RequestKeyStates;
-            txMessage.length = 1;
-            status = tx(i2cAddress);
-            *uhkModulePhase = UhkModulePhase_ReceiveKeystates;
-            break;
-        case UhkModulePhase_ReceiveKeystates:
-            status = rx(rxMessage, i2cAddress);
-            *uhkModulePhase = UhkModulePhase_ProcessKeystates;
+        // Get key event tick
+        case UhkModulePhase_RequestKeyEventTickUsec:
+            txMessage.data[0] = SlaveCommand_RequestProperty;
+            txMessage.data[1] = SlaveProperty_KeyEventTickUsec;
+            txMessage.length = 2;
+            status = txrx(rxMessage, i2cAddress);
+            *uhkModulePhase = UhkModulePhase_ProcessKeyEventTickUsec;
             break;
-        case UhkModulePhase_ProcessKeystates:
-            if (CRC16_IsMessageValid(rxMessage)) {
-                uint8_t slotId = uhkModuleDriverId + 1;
-                BoolBitsToBytes(rxMessage->data, keyStatesBuffer, uhkModuleState->keyCount);
-                for (uint8_t keyId=0; keyId<uhkModuleState->keyCount; keyId++) {
-                    LeftKeyStates[slotId][keyId].current = keyStatesBuffer[keyId];
-                }
+        case UhkModulePhase_ProcessKeyEventTickUsec: {
+            bool isMessageValid = CRC16_IsMessageValid(rxMessage) && rxMessage->length == sizeof(uint16_t);
+            if (isMessageValid) {
+                memcpy(&uhkModuleState->keyEventTickUsec, rxMessage->data, sizeof(uint16_t));
             }
             status = kStatus_Uhk_IdleCycle;
-            *uhkModulePhase = UhkModulePhase_SetTestLed;
+            if (isMessageValid) {
+                finishHandshake(uhkModuleDriverId, uhkModuleState);
+            } else {
+                *uhkModulePhase = UhkModulePhase_RequestKeyEventTickUsec;
+            }
             break;
+        }
 
-        // Set test LED
-        case UhkModulePhase_SetTestLed:
-            if (uhkModuleSourceVars->isTestLedOn == uhkModuleTargetVars->isTestLedOn) {
-                status = kStatus_Uhk_IdleCycle;
-            } else {
-                txMessage.data[0] = SlaveCommand_SetTestLed;
-                txMessage.data[1] = uhkModuleSourceVars->isTestLedOn;
+        // Get key states or key events
+        case UhkModulePhase_RequestKeyStates:
+            if (uhkModuleState->keyEventTickUsec && isModuleProtocolAtLeast(uhkModuleState, 4, 2)) {
+                txMessage.data[0] = SlaveCommand_RequestKeyDeltas;
+                txMessage.data[1] = uhkModuleState->keyDeltaSequence << SLAVE_KEY_DELTAS_ACK_SHIFT |
+                    (uhkModuleState->isKeyStatesRequested ? SlaveKeyDeltasRequest_KeyStates : 0);
                 txMessage.length = 2;
-                status = tx(i2cAddress);
-                uhkModuleTargetVars->isTestLedOn = uhkModuleSourceVars->isTestLedOn;
+            } else if (uhkModuleState->keyEventTickUsec) {
+                txMessage.data[0] = SlaveCommand_RequestKeyEvents;
+                txMessage.data[1] = uhkModuleState->isKeyStatesRequested;
+                txMessage.length = 2;
+            } else {
+                txMessage.data[0] = SlaveCommand_RequestKeyStates;
+                txMessage.length = 1;
             }
-            *uhkModulePhase = UhkModulePhase_SetLedPwmBrightness;
+            status = txrx(rxMessage, i2cAddress);
+            *uhkModulePhase = UhkModulePhase_ProcessKeystates;
             break;
-
-        // Set PWM brightness
-        case UhkModulePhase_SetLedPwmBrightness:
-            if (uhkModuleSourceVars->ledPwmBrightness == uhkModuleTargetVars->ledPwmBrightness) {
+        case UhkModulePhase_ProcessKeystates: {
+            uint8_t slotId = UHK_MODULE_DRIVER_ID_TO_SLOT_ID(uhkModuleDriverId);
+            bool isMessageValid = CRC16_IsMessageValid(rxMessage);
+            if (uhkModuleState->keyEventTickUsec && isModuleProtocolAtLeast(uhkModuleState, 4, 2)) {
+                if (isMessageValid && processKeyDeltas(slotId, uhkModuleState, rxMessage, I2cRepeatedStartMicros)) {
+                    uhkModuleState->invalidKeyDeltaReplyCount = 0;
+                } else if (++uhkModuleState->invalidKeyDeltaReplyCount >= UHK_MODULE_MAX_INVALID_KEY_DELTA_REPLY_COUNT) {
+                    // The module may drop events that never arrived once the sequence number wraps around, so the
+                    // key states are requested until a reply carries them.
+                    uhkModuleState->isKeyStatesRequested = true;
+                    uhkModuleState->invalidKeyDeltaReplyCount = 0;
+                }
+            } else if (uhkModuleState->keyEventTickUsec) {
+                // The events of a lost reply are gone, so the key states are requested with the next one.
+                uhkModuleState->isKeyStatesRequested = !(isMessageValid && processKeyEvents(slotId, uhkModuleState, rxMessage, I2cRepeatedStartMicros));
+            } else if (isMessageValid && rxMessage->length >= BOOL_BYTES_TO_BITS_COUNT(uhkModuleState->keyCount)) {
+                LeftKeyStates[slotId] = getKeyStates(uhkModuleState, rxMessage->data);
+                ModuleKeyEvents_Resync(slotId);
+            }
+            // The key states of a module that is polled with its cached identity are held back until the identity is
+            // verified, so the identity is requested right away.
+            if (uhkModuleState->isIdentityVerified) {
+                status = kStatus_Uhk_IdleSlave;
+                *uhkModulePhase = UhkModulePhase_SendCommands;
+            } else {
                 status = kStatus_Uhk_IdleCycle;
+                *uhkModulePhase = UhkModulePhase_RequestIdentity;
+            }
+            break;
+        }
+
+        // Send the commands that have been queued since the previous key state request
+        case UhkModulePhase_SendCommands:
+            if (uhkModuleState->commandQueue.count) {
+                status = sendCommands(uhkModuleState, i2cAddress);
+                *uhkModulePhase = UhkModulePhase_RemoveSentCommands;
             } else {
-                txMessage.data[0] = SlaveCommand_SetLedPwmBrightness;
-                txMessage.data[1] = uhkModuleSourceVars->ledPwmBrightness;
-                txMessage.length = 2;
-                status = tx(i2cAddress);
-                uhkModuleTargetVars->ledPwmBrightness = uhkModuleSourceVars->ledPwmBrightness;
+                status = kStatus_Uhk_IdleCycle;
+                *uhkModulePhase = UhkModulePhase_RequestKeyStates;
             }
+            break;
+        // A failed transfer ends the poll, and the module is initialized again before it is polled next, so this
+        // is only reached once the commands arrived.
+        case UhkModulePhase_RemoveSentCommands:
+            removeSentCommands(uhkModuleState);
+            status = kStatus_Uhk_IdleCycle;
             *uhkModulePhase = UhkModulePhase_RequestKeyStates;
             break;
     }
@@ -270,3 +577,19 @@ void UhkModuleSlaveDriver_Disconnect(uint8_t uhkModuleDriverId)
     }
     UhkModuleStates[uhkModuleDriverId].moduleId = 0;
 }
+
+bool UhkModuleSlaveDriver_QueueCommand(uint8_t uhkModuleDriverId, slave_command_t commandId, const uint8_t *value,
+    uint8_t length)
+{
+    uhk_module_command_queue_t *commandQueue = &UhkModuleStates[uhkModuleDriverId].commandQueue;
+
+    if (length > UHK_MODULE_COMMAND_MAX_VALUE_LENGTH) {
+        return false;
+    }
+
+    uint32_t primask = DisableGlobalIRQ();
+    bool isQueued = queueCommand(commandQueue, commandId, value, length);
+    EnableGlobalIRQ(primask);
+
+    return isQueued;
+}
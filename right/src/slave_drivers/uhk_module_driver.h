@@ -6,14 +6,25 @@
     #include "fsl_common.h"
     #include "crc16.h"
     #include "versions.h"
+    #include "slave_protocol.h"
 
 // Macros:
 
     #define UHK_MODULE_MAX_COUNT 3
     #define MAX_PWM_BRIGHTNESS 0x64
+    #define UHK_MODULE_POLL_INTERVAL_USEC 4000
     #define SLOT_ID_TO_UHK_MODULE_DRIVER_ID(slotId) ((slotId)-1)
     #define UHK_MODULE_DRIVER_ID_TO_SLOT_ID(uhkModuleDriverId) ((uhkModuleDriverId)+1)
 
+    // Commands are coalesced by command ID, so the queue only fills up if it has fewer entries than there are
+    // commands without a reply, counting the ones that are being sent twice.
+    #define UHK_MODULE_COMMAND_QUEUE_LENGTH 8
+    #define UHK_MODULE_COMMAND_MAX_VALUE_LENGTH 4
+
+    // A stale acknowledgement matches the sequence number of the module again once it has wrapped around, so the
+    // key states are requested after this many invalid key delta replies in a row, well before it can wrap.
+    #define UHK_MODULE_MAX_INVALID_KEY_DELTA_REPLY_COUNT ((SLAVE_KEY_DELTAS_SEQUENCE_MASK + 1) / 4)
+
 // Typedefs:
 
     typedef enum {
@@ -24,65 +35,86 @@
 
     typedef enum {
 
+        // Get every property in one message
+        UhkModulePhase_RequestIdentity,
+        UhkModulePhase_ProcessIdentity,
+
         // Sync communication
         UhkModulePhase_RequestSync,
-        UhkModulePhase_ReceiveSync,
         UhkModulePhase_ProcessSync,
 
         // Get protocol version
         UhkModulePhase_RequestModuleProtocolVersion,
-        UhkModulePhase_ReceiveModuleProtocolVersion,
         UhkModulePhase_ProcessModuleProtocolVersion,
 
         // Get firmware version
         UhkModulePhase_RequestFirmwareVersion,
-        UhkModulePhase_ReceiveFirmwareVersion,
         UhkModulePhase_ProcessFirmwareVersion,
 
         // Get module id
         UhkModulePhase_RequestModuleId,
-        UhkModulePhase_ReceiveModuleId,
         UhkModulePhase_ProcessModuleId,
 
         // Get module key count
         UhkModulePhase_RequestModuleKeyCount,
-        UhkModulePhase_ReceiveModuleKeyCount,
         UhkModulePhase_ProcessModuleKeyCount,
 
         // Get module key count
         UhkModulePhase_RequestModulePointerCount,
-        UhkModulePhase_ReceiveModulePointerCount,
         UhkModulePhase_ProcessModulePointerCount,
 
-        // Get key states
+        // Get key event tick
+        UhkModulePhase_RequestKeyEventTickUsec,
+        UhkModulePhase_ProcessKeyEventTickUsec,
+
+        // Get key states or key events
         UhkModulePhase_RequestKeyStates,
-        UhkModulePhase_ReceiveKeystates,
         UhkModulePhase_ProcessKeystates,
 
         // Misc phases
-        UhkModulePhase_SetTestLed,
-        UhkModulePhase_SetLedPwmBrightness,
+        UhkModulePhase_SendCommands,
+        UhkModulePhase_RemoveSentCommands,
         UhkModulePhase_JumpToBootloader,
 
     } uhk_module_phase_t;
 
     typedef struct {
-        uint8_t ledPwmBrightness;
-        bool isTestLedOn;
-    } uhk_module_vars_t;
+        uint8_t commandId;
+        uint8_t length;
+        uint8_t value[UHK_MODULE_COMMAND_MAX_VALUE_LENGTH];
+    } uhk_module_command_t;
+
+    // The commands without a reply that are yet to be sent, oldest first. A queued command that is queued again
+    // keeps its place and only gets the new value, unless it is being sent already. The sent commands are only
+    // removed once their transfer succeeded, so a failed transfer sends them again.
+    typedef struct {
+        uint8_t count;
+        uint8_t sentCount;  // The oldest commands, whose transfer is in progress
+        uhk_module_command_t commands[UHK_MODULE_COMMAND_QUEUE_LENGTH];
+    } uhk_module_command_queue_t;
 
     typedef struct {
         uint8_t moduleId;
         version_t moduleProtocolVersion;
         version_t firmwareVersion;
         uhk_module_phase_t phase;
-        uhk_module_vars_t sourceVars;
-        uhk_module_vars_t targetVars;
+        uhk_module_command_queue_t commandQueue;
+        uhk_module_command_queue_t appliedCommands;  // The last value of every command that the module got
         i2c_message_t rxMessage;
         uint8_t firmwareI2cAddress;
         uint8_t bootloaderI2cAddress;
         uint8_t keyCount;
         uint8_t pointerCount;
+        uint16_t keyEventTickUsec;  // 0 if the module only reports key states
+        bool isKeyStatesRequested;  // Ask for the key states along with the next key events
+        uint8_t keyDeltaSequence;   // The sequence number of the last processed key delta reply
+        uint8_t invalidKeyDeltaReplyCount;  // Invalid key delta replies since the last valid one
+        // The identity of the module that was last connected. A module that reconnects after a glitch is polled
+        // with it right away, and its identity is verified right after the first poll. UpdateUsbReports() holds
+        // back the key states of the module until then.
+        bool isIdentityCached;
+        slave_identity_t cachedIdentity;
+        bool isIdentityVerified;  // False while the module is polled with the cached identity
     } uhk_module_state_t;
 
     typedef struct {
@@ -99,5 +131,7 @@
     void UhkModuleSlaveDriver_Init(uint8_t uhkModuleDriverId);
     status_t UhkModuleSlaveDriver_Update(uint8_t uhkModuleDriverId);
     void UhkModuleSlaveDriver_Disconnect(uint8_t uhkModuleDriverId);
+    bool UhkModuleSlaveDriver_QueueCommand(uint8_t uhkModuleDriverId, slave_command_t commandId, const uint8_t *value,
+        uint8_t length);
 
 #endif
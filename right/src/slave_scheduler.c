@@ -8,11 +8,28 @@
 #include "i2c_addresses.h"
 #include "config.h"
 #include "i2c_error_logger.h"
+#include "i2c_baud_rate.h"
+#include "timer.h"
+#include "peripherals/merge_sensor.h"
+#include "init_peripherals.h"
 
 uint32_t I2cSlaveScheduler_Counter;
+uint16_t SlaveScheduler_MaxProbeBackoffMsec = SLAVE_SCHEDULER_DEFAULT_MAX_PROBE_BACKOFF_MSEC;
+bool SlaveScheduler_IsSqueezing;
+
+#define NO_SLAVE_ID UINT8_MAX
 
 static uint8_t previousSlaveId;
-static uint8_t currentSlaveId;
+static uint8_t pollingSlaveId;
+static uint8_t nextBackgroundSlaveId;
+static bool isBackgroundTransfer;
+static bool isTransferInProgress;
+static bool isTransferToConnectedSlave;
+static bool isSparePoll;
+static bool wasMerged;
+static uint32_t transferStartMicros;
+static uint32_t guardUsec;
+static uint32_t guardBaudRateBps;
 
 uhk_slave_t Slaves[] = {
     {
@@ -20,90 +37,306 @@ uhk_slave_t Slaves[] = {
         .update = UhkModuleSlaveDriver_Update,
         .disconnect = UhkModuleSlaveDriver_Disconnect,
         .perDriverId = UhkModuleDriverId_LeftKeyboardHalf,
+        .priority = SlavePriority_High,
+        .pollIntervalUsec = UHK_MODULE_POLL_INTERVAL_USEC,
     },
     {
         .init = UhkModuleSlaveDriver_Init,
         .update = UhkModuleSlaveDriver_Update,
         .perDriverId = UhkModuleDriverId_LeftAddon,
+        .priority = SlavePriority_Normal,
+        .pollIntervalUsec = UHK_MODULE_POLL_INTERVAL_USEC,
     },
     {
         .init = UhkModuleSlaveDriver_Init,
         .update = UhkModuleSlaveDriver_Update,
         .perDriverId = UhkModuleDriverId_RightAddon,
+        .priority = SlavePriority_Normal,
+        .pollIntervalUsec = UHK_MODULE_POLL_INTERVAL_USEC,
     },
     {
         .init = LedSlaveDriver_Init,
         .update = LedSlaveDriver_Update,
         .perDriverId = LedDriverId_Right,
+        .priority = SlavePriority_Normal,
     },
     {
         .init = LedSlaveDriver_Init,
         .update = LedSlaveDriver_Update,
         .perDriverId = LedDriverId_Left,
+        .priority = SlavePriority_Normal,
     },
     {
         .init = KbootSlaveDriver_Init,
         .update = KbootSlaveDriver_Update,
         .perDriverId = KbootDriverId_Singleton,
+        .priority = SlavePriority_Low,
     },
 };
 
-static void slaveSchedulerCallback(I2C_Type *base, i2c_master_handle_t *handle, status_t previousStatus, void *userData)
+static bool isSlaveBackingOff(uhk_slave_t *slave, uint32_t now)
 {
-    bool isFirstCycle = true;
-    bool isTransferScheduled = false;
-    I2cSlaveScheduler_Counter++;
+    if (slave->isBackingOff && (int32_t)(slave->retryMicros - now) <= 0) {
+        slave->isBackingOff = false;
+    }
+    return slave->isBackingOff;
+}
+
+static void backOff(uhk_slave_t *slave, uint32_t now, uint32_t minBackoffUsec, uint32_t maxBackoffUsec)
+{
+    slave->backoffUsec = MIN(MAX(2 * slave->backoffUsec, minBackoffUsec), maxBackoffUsec);
+    slave->retryMicros = now + slave->backoffUsec;
+    slave->isBackingOff = true;
+}
+
+static void endBackoffs(void)
+{
+    for (uint8_t slaveId=0; slaveId<SLAVE_COUNT; slaveId++) {
+        Slaves[slaveId].isBackingOff = false;
+        Slaves[slaveId].backoffUsec = 0;
+    }
+}
+
+// Lets the slave schedule a transfer and returns false if it has nothing to transfer.
+static bool updateSlave(uint8_t slaveId)
+{
+    uhk_slave_t *slave = Slaves + slaveId;
+    status_t status;
 
     do {
-        uhk_slave_t *currentSlave = Slaves + currentSlaveId;
+        if (!slave->isConnected) {
+            slave->init(slave->perDriverId);
+        }
+        status = slave->update(slave->perDriverId);
+        if (IS_STATUS_I2C_ERROR(status)) {
+            LogI2cError(slaveId, status);
+        }
+    } while (status == kStatus_Uhk_IdleCycle);
 
-        if (isFirstCycle) {
-            uhk_slave_t *previousSlave = Slaves + previousSlaveId;
-            previousSlave->previousStatus = previousStatus;
-            if (IS_STATUS_I2C_ERROR(previousStatus)) {
-                LogI2cError(previousSlaveId, previousStatus);
-            }
+    if (status == kStatus_Uhk_IdleSlave) {
+        return false;
+    }
 
-            bool wasPreviousSlaveConnected = previousSlave->isConnected;
-            previousSlave->isConnected = previousStatus == kStatus_Success;
-            if (wasPreviousSlaveConnected && !previousSlave->isConnected && previousSlave->disconnect) {
-                previousSlave->disconnect(previousSlaveId);
-            }
+    isTransferToConnectedSlave = slave->isConnected;
+    slave->isConnected = true;
+    previousSlaveId = slaveId;
+    isTransferInProgress = true;
+    transferStartMicros = Timer_GetCurrentTimeMicros();
+    return true;
+}
 
-            isFirstCycle = false;
+// The transfers take longer or shorter by the same factor when the baud rate changes, and so does the guard.
+static void updateGuardBaudRate(void)
+{
+    uint32_t baudRateBps = I2cMainBusActualBaudRateBps;
+    if (baudRateBps == guardBaudRateBps) {
+        return;
+    }
+    if (baudRateBps && guardBaudRateBps) {
+        guardUsec = MIN((uint64_t)guardUsec * guardBaudRateBps / baudRateBps, SLAVE_SCHEDULER_MAX_GUARD_USEC);
+    }
+    guardBaudRateBps = baudRateBps;
+}
+
+static void startPoll(uint8_t slaveId, uint32_t now)
+{
+    uhk_slave_t *slave = Slaves + slaveId;
+    uint32_t pollIntervalUsec = now - slave->pollStartMicros;
+
+    if (slave->isConnected) {
+        LogI2cPoll(slaveId, pollIntervalUsec);
+        if (pollIntervalUsec > slave->maxPollIntervalUsec) {
+            slave->maxPollIntervalUsec = pollIntervalUsec;
         }
+    }
+    slave->pollStartMicros = now;
+    slave->pollDeadlineMicros = now + slave->pollIntervalUsec;
+    pollingSlaveId = slaveId;
+}
 
-        if (!currentSlave->isConnected) {
-            currentSlave->init(currentSlave->perDriverId);
+// Returns the slave with a poll interval whose deadline is within horizonUsec, or NO_SLAVE_ID. Higher priorities
+// come first, then earlier deadlines. Disconnected slaves are only considered with includeDisconnected, and slaves
+// that back off only with includeBackingOff.
+static uint8_t getNextPolledSlaveId(uint32_t now, int32_t horizonUsec, bool includeDisconnected, bool includeBackingOff)
+{
+    uint8_t nextSlaveId = NO_SLAVE_ID;
+
+    for (uint8_t slaveId=0; slaveId<SLAVE_COUNT; slaveId++) {
+        uhk_slave_t *slave = Slaves + slaveId;
+        if (!slave->pollIntervalUsec || (!slave->isConnected && !includeDisconnected) ||
+            (isSlaveBackingOff(slave, now) && !includeBackingOff) ||
+            (int32_t)(slave->pollDeadlineMicros - now) > horizonUsec) {
+            continue;
+        }
+        uhk_slave_t *nextSlave = Slaves + nextSlaveId;
+        if (nextSlaveId == NO_SLAVE_ID || slave->priority > nextSlave->priority ||
+            (slave->priority == nextSlave->priority && (int32_t)(slave->pollDeadlineMicros - nextSlave->pollDeadlineMicros) < 0)) {
+            nextSlaveId = slaveId;
+        }
+    }
+
+    return nextSlaveId;
+}
+
+// Gives one transfer to the first slave that has something to transfer in the spare bus time, higher priorities
+// first and round-robin within a priority. Disconnected slaves with a poll interval are probed at low priority
+// once per poll interval.
+static bool updateBackgroundSlave(uint32_t now)
+{
+    for (int8_t priority=SlavePriority_High; priority>=SlavePriority_Low; priority--) {
+        for (uint8_t i=0; i<SLAVE_COUNT; i++) {
+            uint8_t slaveId = (nextBackgroundSlaveId + i) % SLAVE_COUNT;
+            uhk_slave_t *slave = Slaves + slaveId;
+            if (isSlaveBackingOff(slave, now)) {
+                continue;
+            }
+            if (slave->pollIntervalUsec) {
+                if (slave->isConnected || priority != SlavePriority_Low || (int32_t)(slave->pollDeadlineMicros - now) > 0) {
+                    continue;
+                }
+                slave->pollStartMicros = now;
+                slave->pollDeadlineMicros = now + slave->pollIntervalUsec;
+            } else if (slave->priority != priority) {
+                continue;
+            }
+            if (updateSlave(slaveId)) {
+                nextBackgroundSlaveId = (slaveId + 1) % SLAVE_COUNT;
+                isBackgroundTransfer = true;
+                return true;
+            }
         }
+    }
+
+    return false;
+}
+
+static void slaveSchedulerCallback(I2C_Type *base, i2c_master_handle_t *handle, status_t previousStatus, void *userData)
+{
+    uint32_t now = Timer_GetCurrentTimeMicros();
+    uint32_t transferUsec = now - transferStartMicros;
+    I2cSlaveScheduler_Counter++;
+
+    // The scheduler is kickstarted without a transfer.
+    bool isTransferCompleted = isTransferInProgress;
+    isTransferInProgress = false;
+    if (isTransferCompleted) {
+        LogI2cTransfer(previousSlaveId, previousStatus, transferUsec, I2cGetTransferByteCount(), isSparePoll);
+    }
+
+    uhk_slave_t *previousSlave = Slaves + previousSlaveId;
+    previousSlave->previousStatus = previousStatus;
+    if (IS_STATUS_I2C_ERROR(previousStatus)) {
+        LogI2cError(previousSlaveId, previousStatus);
+    }
+
+    bool wasPreviousSlaveConnected = previousSlave->isConnected;
+    previousSlave->isConnected = previousStatus == kStatus_Success;
+    if (previousSlave->isConnected) {
+        previousSlave->backoffUsec = 0;
+    }
 
-        status_t currentStatus = currentSlave->update(currentSlave->perDriverId);
-        if (IS_STATUS_I2C_ERROR(currentStatus)) {
-            LogI2cError(currentSlaveId, currentStatus);
+    if (isTransferCompleted && !isTransferToConnectedSlave) {
+        if (previousStatus == kStatus_Success) {
+            endBackoffs();
+        } else if (!previousSlave->isBackingOff) {
+            backOff(previousSlave, now, SLAVE_SCHEDULER_MIN_PROBE_BACKOFF_USEC, SlaveScheduler_MaxProbeBackoffMsec * 1000U);
         }
-        isTransferScheduled = currentStatus != kStatus_Uhk_IdleSlave && currentStatus != kStatus_Uhk_IdleCycle;
-        if (isTransferScheduled) {
-            currentSlave->isConnected = true;
+    }
+
+    bool isMerged = MERGE_SENSOR_IS_MERGED;
+    if (isMerged != wasMerged) {
+        wasMerged = isMerged;
+        endBackoffs();
+    }
+    if (wasPreviousSlaveConnected && !previousSlave->isConnected && previousSlave->disconnect) {
+        previousSlave->disconnect(previousSlaveId);
+    }
+
+    // No transfer is in progress here, so the baud rate can be changed safely.
+    if (isTransferCompleted) {
+        I2cBaudRate_LogTransfer(isTransferToConnectedSlave, previousStatus);
+    }
+    I2cBaudRate_Update(now);
+    updateGuardBaudRate();
+
+    bool wasBackgroundTransfer = isBackgroundTransfer;
+    if (isBackgroundTransfer && previousStatus == kStatus_Success) {
+        guardUsec = MIN(MAX(transferUsec, guardUsec), SLAVE_SCHEDULER_MAX_GUARD_USEC);
+    }
+    isBackgroundTransfer = false;
+
+    if (pollingSlaveId != NO_SLAVE_ID) {
+        if (previousStatus == kStatus_Success && updateSlave(pollingSlaveId)) {
+            return;
         }
+        pollingSlaveId = NO_SLAVE_ID;
+    }
 
-        if (currentStatus != kStatus_Uhk_IdleCycle) {
-            previousSlaveId = currentSlaveId++;
-            if (currentSlaveId >= SLAVE_COUNT) {
-                currentSlaveId = 0;
+    while (true) {
+        // Background transfers only get the bus one at a time between two polls, so that the connected slaves are
+        // polled as often as if the bus had nothing else to do, apart from the gap of that transfer, and the
+        // disconnected slaves are probed when due even if the background always has something to transfer. If the
+        // polls leave less spare time than the guard, a background transfer still gets squeezed in between two
+        // polls unless a poll is overdue, so that the other slaves are slowed down but not starved.
+        uint8_t slaveId = getNextPolledSlaveId(now, wasBackgroundTransfer ? INT32_MAX : (int32_t)guardUsec, false, false);
+        if (slaveId == NO_SLAVE_ID && wasBackgroundTransfer) {
+            slaveId = getNextPolledSlaveId(now, 0, true, false);
+        }
+        bool isPollDue = slaveId != NO_SLAVE_ID && (int32_t)(Slaves[slaveId].pollDeadlineMicros - now) <= (int32_t)guardUsec;
+        isSparePoll = slaveId != NO_SLAVE_ID && !isPollDue;
+        bool isPollOverdue = slaveId != NO_SLAVE_ID && (int32_t)(Slaves[slaveId].pollDeadlineMicros - now) <= 0;
+        if (slaveId == NO_SLAVE_ID || (!isPollOverdue && !wasBackgroundTransfer)) {
+            SlaveScheduler_IsSqueezing = isPollDue;
+            if (updateBackgroundSlave(now)) {
+                return;
+            }
+            // Nobody needs the spare bus time, so poll ahead of the deadline, or probe ahead of time if no slave
+            // is connected, as the bus must not go idle. That is also why a slave that backs off gets probed if
+            // every other slave backs off too.
+            isSparePoll = true;
+            if (slaveId == NO_SLAVE_ID) {
+                slaveId = getNextPolledSlaveId(now, INT32_MAX, false, false);
+            }
+            if (slaveId == NO_SLAVE_ID) {
+                slaveId = getNextPolledSlaveId(now, INT32_MAX, true, false);
+            }
+            if (slaveId == NO_SLAVE_ID) {
+                slaveId = getNextPolledSlaveId(now, INT32_MAX, true, true);
             }
         }
 
-    } while (!isTransferScheduled);
+        startPoll(slaveId, now);
+        if (updateSlave(slaveId)) {
+            return;
+        }
+        pollingSlaveId = NO_SLAVE_ID;
+        wasBackgroundTransfer = false;
+    }
 }
 
 void InitSlaveScheduler(void)
 {
+    uint32_t now = Timer_GetCurrentTimeMicros();
+
     previousSlaveId = 0;
-    currentSlaveId = 0;
+    pollingSlaveId = NO_SLAVE_ID;
+    nextBackgroundSlaveId = 0;
+    isBackgroundTransfer = false;
+    isTransferInProgress = false;
+    isSparePoll = false;
+    SlaveScheduler_IsSqueezing = false;
+    wasMerged = MERGE_SENSOR_IS_MERGED;
+    guardUsec = SLAVE_SCHEDULER_INITIAL_GUARD_USEC;
+    guardBaudRateBps = I2cMainBusActualBaudRateBps;
 
     for (uint8_t i=0; i<SLAVE_COUNT; i++) {
         uhk_slave_t *currentSlave = Slaves + i;
         currentSlave->isConnected = false;
+        currentSlave->pollStartMicros = now;
+        currentSlave->pollDeadlineMicros = now;
+        currentSlave->maxPollIntervalUsec = 0;
+        currentSlave->isBackingOff = false;
+        currentSlave->backoffUsec = 0;
     }
 
     I2C_MasterTransferCreateHandle(I2C_MAIN_BUS_BASEADDR, &I2cMasterHandle, slaveSchedulerCallback, NULL);
@@ -111,3 +344,21 @@ void InitSlaveScheduler(void)
     // Kickstart the scheduler by triggering the first transfer.
     slaveSchedulerCallback(I2C_MAIN_BUS_BASEADDR, &I2cMasterHandle, kStatus_Fail, NULL);
 }
+
+// Called by the I2C watchdog once the stuck transfer has been aborted and the bus has been cleared. Unlike
+// InitSlaveScheduler(), only the slave of the stuck transfer gets disconnected, and it backs off, while the other
+// slaves keep their state.
+void RecoverSlaveScheduler(void)
+{
+    uint32_t now = Timer_GetCurrentTimeMicros();
+    uhk_slave_t *slave = Slaves + previousSlaveId;
+
+    LogI2cRecovery(previousSlaveId, now - transferStartMicros);
+
+    // The slave backs off before the stuck transfer fails, so that the failure doesn't count as a failed probe.
+    backOff(slave, now, SLAVE_SCHEDULER_MIN_RECOVERY_BACKOFF_USEC, SLAVE_SCHEDULER_MAX_RECOVERY_BACKOFF_USEC);
+
+    // The handle may still have the completion callback of I2cAsyncWriteReadMessage().
+    I2C_MasterTransferCreateHandle(I2C_MAIN_BUS_BASEADDR, &I2cMasterHandle, slaveSchedulerCallback, NULL);
+    slaveSchedulerCallback(I2C_MAIN_BUS_BASEADDR, &I2cMasterHandle, kStatus_I2C_Timeout, NULL);
+}
@@ -13,6 +13,25 @@
     #define IS_VALID_SLAVE_ID(slaveId) (0 <= slaveId && slaveId <= MAX_SLAVE_COUNT)
     #define IS_STATUS_I2C_ERROR(status) (kStatus_I2C_Busy <= status && status <= kStatus_I2C_Timeout)
 
+    // Background transfers are only started if the next poll is due later than the longest background transfer
+    // took at the current baud rate, which is assumed to be this long initially and is capped at
+    // SLAVE_SCHEDULER_MAX_GUARD_USEC.
+    #define SLAVE_SCHEDULER_INITIAL_GUARD_USEC 1000
+    #define SLAVE_SCHEDULER_MAX_GUARD_USEC 2000
+
+    // A slave that got the bus stuck isn't addressed for a backoff time that starts at
+    // SLAVE_SCHEDULER_MIN_RECOVERY_BACKOFF_USEC and doubles with every further recovery up to
+    // SLAVE_SCHEDULER_MAX_RECOVERY_BACKOFF_USEC, until a transfer to the slave succeeds again.
+    #define SLAVE_SCHEDULER_MIN_RECOVERY_BACKOFF_USEC 50000
+    #define SLAVE_SCHEDULER_MAX_RECOVERY_BACKOFF_USEC 5000000
+
+    // Likewise, an absent slave is probed again after a backoff time that starts at
+    // SLAVE_SCHEDULER_MIN_PROBE_BACKOFF_USEC and doubles with every failed probe up to
+    // SlaveScheduler_MaxProbeBackoffMsec. Every backoff ends when a slave gets connected or the merge state of
+    // the halves changes, as modules may have been attached.
+    #define SLAVE_SCHEDULER_MIN_PROBE_BACKOFF_USEC 4000
+    #define SLAVE_SCHEDULER_DEFAULT_MAX_PROBE_BACKOFF_MSEC 256
+
 // Typedefs:
 
     typedef enum { // Slaves[] is meant to be indexed with these values
@@ -28,6 +47,15 @@
     typedef status_t (slave_update_t)(uint8_t);
     typedef void (slave_disconnect_t)(uint8_t);
 
+    typedef enum {
+        SlavePriority_Low,
+        SlavePriority_Normal,
+        SlavePriority_High,
+    } slave_priority_t;
+
+    // Slaves with a poll interval are polled by deadline. A poll starts when the scheduler picks the slave and
+    // lasts until its update function returns kStatus_Uhk_IdleSlave or one of its transfers fails. The other
+    // slaves get one transfer at a time between two polls whenever no poll is due, higher priorities first.
     typedef struct {
         uint8_t perDriverId;  // Identifies the slave instance on a per-driver basis
         slave_init_t *init;
@@ -35,6 +63,14 @@
         slave_disconnect_t *disconnect;
         bool isConnected;
         status_t previousStatus;
+        slave_priority_t priority;
+        uint16_t pollIntervalUsec;     // The maximum time between the starts of two polls, 0 to only use the spare bus time
+        uint32_t pollDeadlineMicros;
+        uint32_t pollStartMicros;
+        uint32_t maxPollIntervalUsec;  // The longest time between the starts of two polls of the connected slave
+        bool isBackingOff;             // The slave got the bus stuck or is absent and isn't addressed until retryMicros
+        uint32_t retryMicros;
+        uint32_t backoffUsec;
     } uhk_slave_t;
 
     typedef enum {
@@ -50,9 +86,12 @@
 
     extern uhk_slave_t Slaves[];
     extern uint32_t I2cSlaveScheduler_Counter;
+    extern uint16_t SlaveScheduler_MaxProbeBackoffMsec;
+    extern bool SlaveScheduler_IsSqueezing;  // The polls left less spare time than the guard when the background last got the bus
 
 // Functions:
 
     void InitSlaveScheduler(void);
+    void RecoverSlaveScheduler(void);
 
 #endif
@@ -0,0 +1,43 @@
+#include "usb_protocol_handler.h"
+#include "usb_commands/usb_command_get_debounce_stats.h"
+#include "debounce.h"
+
+#define KEY_STATS_LENGTH 8
+#define KEY_STATS_PER_RESPONSE ((USB_GENERIC_HID_OUT_BUFFER_LENGTH - 2) / KEY_STATS_LENGTH)
+
+// Request: slot id, first key id, then 1 to reset the statistics of every key after reading them.
+// Response: key count, then the debounce time, shortest glitch time, max settle time, edge count, chatter count and
+// max glitch spacing of every key.
+void UsbCommand_GetDebounceStats(void)
+{
+    uint8_t slotId = GetUsbRxBufferUint8(1);
+    uint8_t firstKeyId = GetUsbRxBufferUint8(2);
+    bool shouldReset = GetUsbRxBufferUint8(3);
+
+    if (slotId >= SLOT_COUNT) {
+        SetUsbTxBufferUint8(0, UsbStatusCode_GetDebounceStats_InvalidSlotId);
+        return;
+    }
+
+    if (firstKeyId >= MAX_KEY_COUNT_PER_MODULE) {
+        SetUsbTxBufferUint8(0, UsbStatusCode_GetDebounceStats_InvalidKeyId);
+        return;
+    }
+
+    uint8_t keyCount = MIN(KEY_STATS_PER_RESPONSE, MAX_KEY_COUNT_PER_MODULE - firstKeyId);
+    SetUsbTxBufferUint8(1, keyCount);
+    for (uint8_t i = 0; i < keyCount; i++) {
+        debounce_key_stats_t *stats = &DebounceKeyStats[slotId][firstKeyId + i];
+        uint8_t offset = 2 + i * KEY_STATS_LENGTH;
+        SetUsbTxBufferUint8(offset, stats->debounceTime);
+        SetUsbTxBufferUint8(offset + 1, stats->shortestGlitchTime);
+        SetUsbTxBufferUint8(offset + 2, stats->maxSettleTime);
+        SetUsbTxBufferUint16(offset + 3, stats->edgeCount);
+        SetUsbTxBufferUint16(offset + 5, stats->chatterCount);
+        SetUsbTxBufferUint8(offset + 7, stats->maxGlitchSpacing);
+    }
+
+    if (shouldReset) {
+        Debounce_ResetKeyStats();
+    }
+}
@@ -0,0 +1,15 @@
+#ifndef __USB_COMMAND_GET_DEBOUNCE_STATS_H__
+#define __USB_COMMAND_GET_DEBOUNCE_STATS_H__
+
+// Functions:
+
+    void UsbCommand_GetDebounceStats(void);
+
+// Typedefs:
+
+    typedef enum {
+        UsbStatusCode_GetDebounceStats_InvalidSlotId = 2,
+        UsbStatusCode_GetDebounceStats_InvalidKeyId  = 3,
+    } usb_status_code_get_debounce_stats_t;
+
+#endif
@@ -5,7 +5,7 @@
 #include "i2c_watchdog.h"
 #include "buffer.h"
 #include "timer.h"
-#include "right_key_matrix.h"
+#include "key_scanner.h"
 #include "usb_report_updater.h"
 #include "usb_interfaces/usb_interface_basic_keyboard.h"
 #include "usb_interfaces/usb_interface_media_keyboard.h"
@@ -28,6 +28,18 @@ void UsbCommand_GetDebugBuffer(void)
     SetDebugBufferUint32(37, UsbMediaKeyboardActionCounter);
     SetDebugBufferUint32(41, UsbSystemKeyboardActionCounter);
     SetDebugBufferUint32(45, UsbMouseActionCounter);
+    SetDebugBufferUint32(49, KeyScanner_Stats.frameCount);
+    SetDebugBufferUint16(53, KeyScanner_RowIntervalUsec);
+    SetDebugBufferUint16(55, KeyScanner_Stats.frameCount ? KeyScanner_Stats.minLatencyUsec : 0);
+    SetDebugBufferUint16(57, KeyScanner_Stats.maxLatencyUsec);
+    SetDebugBufferUint16(59, KeyScanner_Stats.maxPeriodDeviationUsec);
+
+    // The longest time between two polls of every module slot since the last read, in units of 100 us.
+    for (uint8_t slaveId=SlaveId_LeftKeyboardHalf; slaveId<=SlaveId_RightAddon; slaveId++) {
+        uhk_slave_t *slave = Slaves + slaveId;
+        SetDebugBufferUint8(61 + slaveId, MIN(slave->maxPollIntervalUsec / 100, UINT8_MAX));
+        slave->maxPollIntervalUsec = 0;
+    }
 
     memcpy(GenericHidOutBuffer, DebugBuffer, USB_GENERIC_HID_OUT_BUFFER_LENGTH);
 }
@@ -0,0 +1,39 @@
+#include "usb_protocol_handler.h"
+#include "usb_commands/usb_command_get_i2c_baud_rate_history.h"
+#include "i2c_baud_rate.h"
+#include "init_peripherals.h"
+
+#define CHANGE_LENGTH 11
+#define HEADER_LENGTH 13
+#define CHANGES_PER_RESPONSE ((USB_GENERIC_HID_OUT_BUFFER_LENGTH - HEADER_LENGTH) / CHANGE_LENGTH)
+
+// Request: the number of most recent changes to skip.
+// Response: whether the baud rate is adaptive, the requested and the actual baud rate, the total change count,
+// the number of changes that follow, then the baud rate, time, error rate per mille and reason of every change,
+// the most recent one first.
+void UsbCommand_GetI2cBaudRateHistory(void)
+{
+    uint8_t skippedChangeCount = GetUsbRxBufferUint8(1);
+    uint8_t storedChangeCount = MIN(I2cBaudRate_ChangeCount, I2C_BAUD_RATE_HISTORY_LENGTH);
+
+    if (skippedChangeCount > storedChangeCount) {
+        SetUsbTxBufferUint8(0, UsbStatusCode_GetI2cBaudRateHistory_InvalidChangeIndex);
+        return;
+    }
+
+    uint8_t changeCount = MIN(CHANGES_PER_RESPONSE, storedChangeCount - skippedChangeCount);
+    SetUsbTxBufferUint8(1, I2cBaudRate_IsAdaptive);
+    SetUsbTxBufferUint32(2, I2cMainBusRequestedBaudRateBps);
+    SetUsbTxBufferUint32(6, I2cMainBusActualBaudRateBps);
+    SetUsbTxBufferUint16(10, I2cBaudRate_ChangeCount);
+    SetUsbTxBufferUint8(12, changeCount);
+    for (uint8_t i = 0; i < changeCount; i++) {
+        uint16_t changeIndex = I2cBaudRate_ChangeCount - 1 - skippedChangeCount - i;
+        i2c_baud_rate_change_t *change = I2cBaudRate_History + changeIndex % I2C_BAUD_RATE_HISTORY_LENGTH;
+        uint8_t offset = HEADER_LENGTH + i * CHANGE_LENGTH;
+        SetUsbTxBufferUint32(offset, change->baudRateBps);
+        SetUsbTxBufferUint32(offset + 4, change->time);
+        SetUsbTxBufferUint16(offset + 8, change->errorPerMille);
+        SetUsbTxBufferUint8(offset + 10, change->reason);
+    }
+}
@@ -0,0 +1,14 @@
+#ifndef __USB_COMMAND_GET_I2C_BAUD_RATE_HISTORY_H__
+#define __USB_COMMAND_GET_I2C_BAUD_RATE_HISTORY_H__
+
+// Functions:
+
+    void UsbCommand_GetI2cBaudRateHistory(void);
+
+// Typedefs:
+
+    typedef enum {
+        UsbStatusCode_GetI2cBaudRateHistory_InvalidChangeIndex = 2,
+    } usb_status_code_get_i2c_baud_rate_history_t;
+
+#endif
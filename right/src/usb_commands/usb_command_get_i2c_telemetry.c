@@ -0,0 +1,42 @@
+#include "usb_protocol_handler.h"
+#include "usb_commands/usb_command_get_i2c_telemetry.h"
+#include "i2c_error_logger.h"
+#include "timer.h"
+
+// Request: slave id, then 1 to reset the telemetry of the bus and of every slave after reading it.
+// Response: the busy, spare and elapsed microseconds of the bus, then the transfer count, byte count and transfer
+// duration histogram of the slave, the average and maximum time between its polls in microseconds, capped at
+// UINT16_MAX, and the count, average and maximum duration in milliseconds of the bus recoveries that the slave
+// caused. The baud rate that these relate to is the I2cMainBusBaudRate device property.
+void UsbCommand_GetI2cTelemetry(void)
+{
+    uint8_t slaveId = GetUsbRxBufferUint8(1);
+    bool shouldReset = GetUsbRxBufferUint8(2);
+
+    if (slaveId >= MAX_SLAVE_COUNT) {
+        SetUsbTxBufferUint8(0, UsbStatusCode_GetI2cTelemetry_InvalidSlaveId);
+        return;
+    }
+
+    i2c_slave_telemetry_t *telemetry = I2cSlaveTelemetry + slaveId;
+    uint32_t averagePollGapUsec = telemetry->pollCount ? telemetry->pollGapSumUsec / telemetry->pollCount : 0;
+    uint32_t averageRecoveryUsec = telemetry->recoveryCount ? telemetry->recoveryUsecSum / telemetry->recoveryCount : 0;
+
+    SetUsbTxBufferUint32(1, I2cBusTelemetry.busyUsec);
+    SetUsbTxBufferUint32(5, I2cBusTelemetry.spareUsec);
+    SetUsbTxBufferUint32(9, Timer_GetCurrentTimeMicros() - I2cBusTelemetry.startMicros);
+    SetUsbTxBufferUint32(13, telemetry->transferCount);
+    SetUsbTxBufferUint32(17, telemetry->byteCount);
+    for (uint8_t i = 0; i < I2C_TRANSFER_HISTOGRAM_BUCKET_COUNT; i++) {
+        SetUsbTxBufferUint32(21 + i * 4, telemetry->transferUsecHistogram[i]);
+    }
+    SetUsbTxBufferUint16(53, MIN(averagePollGapUsec, UINT16_MAX));
+    SetUsbTxBufferUint16(55, MIN(telemetry->maxPollGapUsec, UINT16_MAX));
+    SetUsbTxBufferUint16(57, MIN(telemetry->recoveryCount, UINT16_MAX));
+    SetUsbTxBufferUint16(59, averageRecoveryUsec / 1000);
+    SetUsbTxBufferUint16(61, telemetry->maxRecoveryUsec / 1000);
+
+    if (shouldReset) {
+        ResetI2cTelemetry();
+    }
+}
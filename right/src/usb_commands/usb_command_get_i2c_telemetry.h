@@ -0,0 +1,14 @@
+#ifndef __USB_COMMAND_GET_I2C_TELEMETRY_H__
+#define __USB_COMMAND_GET_I2C_TELEMETRY_H__
+
+// Functions:
+
+    void UsbCommand_GetI2cTelemetry(void);
+
+// Typedefs:
+
+    typedef enum {
+        UsbStatusCode_GetI2cTelemetry_InvalidSlaveId = 2,
+    } usb_status_code_get_i2c_telemetry_t;
+
+#endif
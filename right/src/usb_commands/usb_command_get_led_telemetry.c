@@ -0,0 +1,31 @@
+#include "usb_protocol_handler.h"
+#include "usb_commands/usb_command_get_led_telemetry.h"
+#include "slave_drivers/is31fl3731_driver.h"
+#include "timer.h"
+
+// Request: LED driver id, then 1 to reset the telemetry of every LED driver after reading it.
+// Response: the elapsed microseconds, then the PWM register write count, the PWM register byte count, the PWM
+// register bytes per second and the frame flip count of the LED driver.
+void UsbCommand_GetLedTelemetry(void)
+{
+    uint8_t ledDriverId = GetUsbRxBufferUint8(1);
+    bool shouldReset = GetUsbRxBufferUint8(2);
+
+    if (ledDriverId > LedDriverId_Last) {
+        SetUsbTxBufferUint8(0, UsbStatusCode_GetLedTelemetry_InvalidLedDriverId);
+        return;
+    }
+
+    uint32_t elapsedUsec = Timer_GetCurrentTimeMicros() - LedDriverTelemetry.startMicros;
+    uint32_t byteCount = LedDriverTelemetry.pwmByteCount[ledDriverId];
+
+    SetUsbTxBufferUint32(1, elapsedUsec);
+    SetUsbTxBufferUint32(5, LedDriverTelemetry.pwmWriteCount[ledDriverId]);
+    SetUsbTxBufferUint32(9, byteCount);
+    SetUsbTxBufferUint32(13, elapsedUsec ? (uint64_t)byteCount * 1000000 / elapsedUsec : 0);
+    SetUsbTxBufferUint32(17, LedDriverTelemetry.frameFlipCount[ledDriverId]);
+
+    if (shouldReset) {
+        LedSlaveDriver_ResetTelemetry();
+    }
+}
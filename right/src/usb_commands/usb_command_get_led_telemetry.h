@@ -0,0 +1,14 @@
+#ifndef __USB_COMMAND_GET_LED_TELEMETRY_H__
+#define __USB_COMMAND_GET_LED_TELEMETRY_H__
+
+// Functions:
+
+    void UsbCommand_GetLedTelemetry(void);
+
+// Typedefs:
+
+    typedef enum {
+        UsbStatusCode_GetLedTelemetry_InvalidLedDriverId = 2,
+    } usb_status_code_get_led_telemetry_t;
+
+#endif
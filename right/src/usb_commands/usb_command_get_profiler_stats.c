@@ -0,0 +1,34 @@
+#include "usb_protocol_handler.h"
+#include "usb_commands/usb_command_get_profiler_stats.h"
+#include "profiler.h"
+
+// Request: stage id, then 1 to reset the stage after reading it.
+// Response: stage count, sample count, min, max and average cycles, then the histogram buckets.
+void UsbCommand_GetProfilerStats(void)
+{
+#if PROFILER_ENABLED
+    uint8_t stageId = GetUsbRxBufferUint8(1);
+    bool shouldReset = GetUsbRxBufferUint8(2);
+
+    if (stageId >= ProfilerStage_Count) {
+        SetUsbTxBufferUint8(0, UsbStatusCode_GetProfilerStats_InvalidStageId);
+        return;
+    }
+
+    profiler_stage_stats_t *stats = ProfilerStageStats + stageId;
+    SetUsbTxBufferUint8(1, ProfilerStage_Count);
+    SetUsbTxBufferUint32(2, stats->sampleCount);
+    SetUsbTxBufferUint32(6, stats->sampleCount ? stats->minCycles : 0);
+    SetUsbTxBufferUint32(10, stats->maxCycles);
+    SetUsbTxBufferUint32(14, stats->sampleCount ? stats->totalCycles / stats->sampleCount : 0);
+    for (uint8_t i = 0; i < PROFILER_HISTOGRAM_BUCKET_COUNT; i++) {
+        SetUsbTxBufferUint16(18 + 2*i, stats->histogram[i]);
+    }
+
+    if (shouldReset) {
+        Profiler_Reset(stageId);
+    }
+#else
+    SetUsbTxBufferUint8(0, UsbStatusCode_GetProfilerStats_Disabled);
+#endif
+}
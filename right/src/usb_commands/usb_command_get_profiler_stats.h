@@ -0,0 +1,15 @@
+#ifndef __USB_COMMAND_GET_PROFILER_STATS_H__
+#define __USB_COMMAND_GET_PROFILER_STATS_H__
+
+// Functions:
+
+    void UsbCommand_GetProfilerStats(void);
+
+// Typedefs:
+
+    typedef enum {
+        UsbStatusCode_GetProfilerStats_Disabled       = 2,
+        UsbStatusCode_GetProfilerStats_InvalidStageId = 3,
+    } usb_status_code_get_profiler_stats_t;
+
+#endif
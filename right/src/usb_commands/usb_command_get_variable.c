@@ -1,8 +1,13 @@
 #include "usb_protocol_handler.h"
 #include "usb_commands/usb_command_get_variable.h"
-#include "key_matrix.h"
+#include "debounce.h"
 #include "test_switches.h"
 #include "usb_report_updater.h"
+#include "key_scanner.h"
+#include "i2c_baud_rate.h"
+#include "slave_scheduler.h"
+#include "led_animation.h"
+#include "slave_drivers/is31fl3731_driver.h"
 
 void UsbCommand_GetVariable(void)
 {
@@ -24,5 +29,29 @@ void UsbCommand_GetVariable(void)
         case UsbVariable_UsbReportSemaphore:
             SetUsbTxBufferUint8(1, UsbReportUpdateSemaphore);
             break;
+        case UsbVariable_KeyScannerRowIntervalUsec:
+            SetUsbTxBufferUint16(1, KeyScanner_RowIntervalUsec);
+            break;
+        case UsbVariable_I2cBaudRateAdaptive:
+            SetUsbTxBufferUint8(1, I2cBaudRate_IsAdaptive);
+            break;
+        case UsbVariable_SlaveMaxProbeBackoffMsec:
+            SetUsbTxBufferUint16(1, SlaveScheduler_MaxProbeBackoffMsec);
+            break;
+        case UsbVariable_LedAnimationEffects:
+            SetUsbTxBufferUint8(1, LedAnimation_Effects);
+            break;
+        case UsbVariable_LedAnimationFrameRateHz:
+            SetUsbTxBufferUint8(1, LedAnimation_FrameRateHz);
+            break;
+        case UsbVariable_LedAnimationMaxBusSharePercent:
+            SetUsbTxBufferUint8(1, LedAnimation_MaxBusSharePercent);
+            break;
+        case UsbVariable_RightKeyBacklightLevel:
+        case UsbVariable_LeftKeyBacklightLevel:
+        case UsbVariable_IconsLevel:
+        case UsbVariable_AlphanumericSegmentsLevel:
+            SetUsbTxBufferUint8(1, LedZoneLevels[variableId - UsbVariable_RightKeyBacklightLevel]);
+            break;
     }
 }
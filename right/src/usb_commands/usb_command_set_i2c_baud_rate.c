@@ -2,10 +2,12 @@
 #include "usb_commands/usb_command_set_i2c_baud_rate.h"
 #include "init_peripherals.h"
 #include "fsl_i2c.h"
+#include "i2c_baud_rate.h"
 
 void UsbCommand_SetI2cBaudRate(void)
 {
     uint32_t i2cBaudRate = GetUsbRxBufferUint32(1);
     I2cMainBusRequestedBaudRateBps = i2cBaudRate;
     ReinitI2cMainBus();
+    I2cBaudRate_RecordManualChange();
 }
@@ -7,5 +7,6 @@ void UsbCommand_SetLedPwmBrightness(void)
 {
     uint8_t brightnessPercent = GetUsbRxBufferUint8(1);
     LedPwm_SetBrightness(brightnessPercent);
-    UhkModuleStates[UhkModuleDriverId_LeftKeyboardHalf].sourceVars.ledPwmBrightness = brightnessPercent;
+    UhkModuleSlaveDriver_QueueCommand(UhkModuleDriverId_LeftKeyboardHalf, SlaveCommand_SetLedPwmBrightness,
+        &brightnessPercent, sizeof(brightnessPercent));
 }
@@ -7,5 +7,6 @@ void UsbCommand_SetTestLed(void)
 {
     bool isTestLedOn = GetUsbRxBufferUint8(1);
     TestLed_Set(isTestLedOn);
-    UhkModuleStates[UhkModuleDriverId_LeftKeyboardHalf].sourceVars.isTestLedOn = isTestLedOn;
+    UhkModuleSlaveDriver_QueueCommand(UhkModuleDriverId_LeftKeyboardHalf, SlaveCommand_SetTestLed,
+        (uint8_t*)&isTestLedOn, sizeof(isTestLedOn));
 }
@@ -1,8 +1,13 @@
 #include "usb_protocol_handler.h"
 #include "usb_commands/usb_command_set_variable.h"
-#include "key_matrix.h"
+#include "debounce.h"
 #include "test_switches.h"
 #include "usb_report_updater.h"
+#include "key_scanner.h"
+#include "i2c_baud_rate.h"
+#include "slave_scheduler.h"
+#include "led_animation.h"
+#include "slave_drivers/is31fl3731_driver.h"
 
 void UsbCommand_SetVariable(void)
 {
@@ -19,13 +24,37 @@ void UsbCommand_SetVariable(void)
             TestUsbStack = GetUsbRxBufferUint8(2);
             break;
         case UsbVariable_DebounceTimePress:
-            DebounceTimePress = GetUsbRxBufferUint8(2);
+            DebounceTimePress = MIN(GetUsbRxBufferUint8(2), DEBOUNCE_MAX_TIME_MSEC);
             break;
         case UsbVariable_DebounceTimeRelease:
-            DebounceTimeRelease = GetUsbRxBufferUint8(2);
+            DebounceTimeRelease = MIN(GetUsbRxBufferUint8(2), DEBOUNCE_MAX_TIME_MSEC);
             break;
         case UsbVariable_UsbReportSemaphore:
             UsbReportUpdateSemaphore = GetUsbRxBufferUint8(2);
             break;
+        case UsbVariable_KeyScannerRowIntervalUsec:
+            KeyScanner_SetRowInterval(GetUsbRxBufferUint16(2));
+            break;
+        case UsbVariable_I2cBaudRateAdaptive:
+            I2cBaudRate_SetAdaptive(GetUsbRxBufferUint8(2));
+            break;
+        case UsbVariable_SlaveMaxProbeBackoffMsec:
+            SlaveScheduler_MaxProbeBackoffMsec = GetUsbRxBufferUint16(2);
+            break;
+        case UsbVariable_LedAnimationEffects:
+            LedAnimation_SetEffects(GetUsbRxBufferUint8(2));
+            break;
+        case UsbVariable_LedAnimationFrameRateHz:
+            LedAnimation_FrameRateHz = GetUsbRxBufferUint8(2);
+            break;
+        case UsbVariable_LedAnimationMaxBusSharePercent:
+            LedAnimation_MaxBusSharePercent = MIN(GetUsbRxBufferUint8(2), 100);
+            break;
+        case UsbVariable_RightKeyBacklightLevel:
+        case UsbVariable_LeftKeyBacklightLevel:
+        case UsbVariable_IconsLevel:
+        case UsbVariable_AlphanumericSegmentsLevel:
+            LedSlaveDriver_SetZoneLevel(variableId - UsbVariable_RightKeyBacklightLevel, GetUsbRxBufferUint8(2));
+            break;
     }
 }
@@ -19,6 +19,11 @@
 #include "usb_commands/usb_command_switch_keymap.h"
 #include "usb_commands/usb_command_get_variable.h"
 #include "usb_commands/usb_command_set_variable.h"
+#include "usb_commands/usb_command_get_profiler_stats.h"
+#include "usb_commands/usb_command_get_debounce_stats.h"
+#include "usb_commands/usb_command_get_i2c_telemetry.h"
+#include "usb_commands/usb_command_get_i2c_baud_rate_history.h"
+#include "usb_commands/usb_command_get_led_telemetry.h"
 
 void UsbProtocolHandler(void)
 {
@@ -85,6 +90,21 @@ void UsbProtocolHandler(void)
         case UsbCommandId_SetVariable:
             UsbCommand_SetVariable();
             break;
+        case UsbCommandId_GetProfilerStats:
+            UsbCommand_GetProfilerStats();
+            break;
+        case UsbCommandId_GetDebounceStats:
+            UsbCommand_GetDebounceStats();
+            break;
+        case UsbCommandId_GetI2cTelemetry:
+            UsbCommand_GetI2cTelemetry();
+            break;
+        case UsbCommandId_GetI2cBaudRateHistory:
+            UsbCommand_GetI2cBaudRateHistory();
+            break;
+        case UsbCommandId_GetLedTelemetry:
+            UsbCommand_GetLedTelemetry();
+            break;
         default:
             SetUsbTxBufferUint8(0, UsbStatusCode_InvalidCommand);
             break;
@@ -36,6 +36,11 @@
         UsbCommandId_SwitchKeymap             = 0x11,
         UsbCommandId_GetVariable              = 0x12,
         UsbCommandId_SetVariable              = 0x13,
+        UsbCommandId_GetProfilerStats         = 0x14,
+        UsbCommandId_GetDebounceStats         = 0x15,
+        UsbCommandId_GetI2cTelemetry          = 0x16,
+        UsbCommandId_GetI2cBaudRateHistory    = 0x17,
+        UsbCommandId_GetLedTelemetry          = 0x18,
     } usb_command_id_t;
 
     typedef enum {
@@ -44,6 +49,16 @@
         UsbVariable_DebounceTimePress,
         UsbVariable_DebounceTimeRelease,
         UsbVariable_UsbReportSemaphore,
+        UsbVariable_KeyScannerRowIntervalUsec,
+        UsbVariable_I2cBaudRateAdaptive,
+        UsbVariable_SlaveMaxProbeBackoffMsec,
+        UsbVariable_LedAnimationEffects,
+        UsbVariable_LedAnimationFrameRateHz,
+        UsbVariable_LedAnimationMaxBusSharePercent,
+        UsbVariable_RightKeyBacklightLevel,  // The levels of the LED zones, in the order of led_zone_t
+        UsbVariable_LeftKeyBacklightLevel,
+        UsbVariable_IconsLevel,
+        UsbVariable_AlphanumericSegmentsLevel,
     } usb_variable_id_t;
 
     typedef enum {
@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include "key_action.h"
 #include "led_display.h"
+#include "led_animation.h"
 #include "layer.h"
 #include "usb_interfaces/usb_interface_mouse.h"
 #include "keymap.h"
@@ -9,7 +10,9 @@
 #include "slave_drivers/is31fl3731_driver.h"
 #include "slave_drivers/uhk_module_driver.h"
 #include "macros.h"
-#include "right_key_matrix.h"
+#include "key_scanner.h"
+#include "debounce.h"
+#include "module_key_events.h"
 #include "layer.h"
 #include "usb_report_updater.h"
 #include "timer.h"
@@ -20,6 +23,7 @@
 #include "arrays.h"
 #include "keyboard_state.h"
 #include "debug.h"
+#include "profiler.h"
 
 static uint32_t mouseUsbReportUpdateTime = 0;
 static uint32_t mouseElapsedTime;
@@ -60,7 +64,7 @@ mouse_kinetic_state_t MouseScrollState = {
     .acceleratedSpeed = 50,
 };
 
-static void applyKeyAction(key_state_t *keyState, key_action_t *action);
+static void applyKeyAction(key_ref_t *keyRef, key_action_t *action);
 
 void addModifiersToReport(int flags);
 
@@ -206,14 +210,17 @@ static void processMouseActions()
 
 static layer_id_t previousLayer = LayerId_Base;
 
-static void handleSwitchLayerAction(key_state_t *keyState, key_action_t *action)
+static void handleSwitchLayerAction(key_ref_t *keyRef, key_action_t *action)
 {
+    key_state_t *keyState = keyRef->state;
+    bool wasPressed = KeyStates_WasPressed(keyRef->slotId, keyRef->keyId);
+
     static key_state_t *doubleTapSwitchLayerKey;
     static uint32_t doubleTapSwitchLayerStartTime;
     static uint32_t doubleTapSwitchLayerTriggerTime;
     static bool isLayerDoubleTapToggled;
 
-    if (doubleTapSwitchLayerKey && doubleTapSwitchLayerKey != keyState && !keyState->previous) {
+    if (doubleTapSwitchLayerKey && doubleTapSwitchLayerKey != keyState && !wasPressed) {
         doubleTapSwitchLayerKey = NULL;
     }
 
@@ -221,17 +228,17 @@ static void handleSwitchLayerAction(key_state_t *keyState, key_action_t *action)
         return;
     }
 
-    if (!keyState->previous && isLayerDoubleTapToggled && ToggledLayer == action->switchLayer.layer) {
+    if (!wasPressed && isLayerDoubleTapToggled && ToggledLayer == action->switchLayer.layer) {
         ToggledLayer = LayerId_Base;
         isLayerDoubleTapToggled = false;
     }
 
-    if (keyState->previous && doubleTapSwitchLayerKey == keyState &&
+    if (wasPressed && doubleTapSwitchLayerKey == keyState &&
             (CurrentTime - doubleTapSwitchLayerTriggerTime) > DoubleTapSwitchLayerReleaseTimeout) {
         ToggledLayer = LayerId_Base;
     }
 
-    if (!keyState->previous && previousLayer == LayerId_Base && action->switchLayer.mode == SwitchLayerMode_HoldAndDoubleTapToggle) {
+    if (!wasPressed && previousLayer == LayerId_Base && action->switchLayer.mode == SwitchLayerMode_HoldAndDoubleTapToggle) {
         if (doubleTapSwitchLayerKey && (CurrentTime - doubleTapSwitchLayerStartTime) < DoubleTapSwitchLayerTimeout) {
             ToggledLayer = action->switchLayer.layer;
             isLayerDoubleTapToggled = true;
@@ -246,8 +253,8 @@ static void handleSwitchLayerAction(key_state_t *keyState, key_action_t *action)
 static uint8_t basicScancodeIndex = 0;
 static uint8_t mediaScancodeIndex = 0;
 static uint8_t systemScancodeIndex = 0;
-void applyKeyAction(key_state_t *keyState, key_action_t *action) {
-    handleSwitchLayerAction(keyState, action);
+void applyKeyAction(key_ref_t *keyRef, key_action_t *action) {
+    handleSwitchLayerAction(keyRef, action);
 
     switch (action->type) {
         case KeyActionType_Keystroke:
@@ -282,31 +289,17 @@ void applyKeyAction(key_state_t *keyState, key_action_t *action) {
             SwitchKeymapById(action->switchKeymap.keymapId);
             break;
         case KeyActionType_PlayMacro:
-            if (!keyState->suppressed) {
+            if (!KeyStates_IsSuppressed(keyRef->slotId, keyRef->keyId)) {
                 Macros_StartMacro(action->playMacro.macroId);
-                keyState->suppressed = true;
+                KeyStates_Suppress(keyRef->slotId, keyRef->keyId);
             }
             break;
     }
 }
 
 
-static void mitigateBouncing(key_state_t *keyState) {
-    uint8_t debounceTimeOut = (keyState->previous ? DebounceTimePress : DebounceTimeRelease);
-    if (keyState->debouncing) {
-        if ((uint8_t)(CurrentTime - keyState->timestamp) > debounceTimeOut) {
-            keyState->debouncing = false;
-        } else {
-            keyState->current = keyState->previous;
-        }
-    } else if (keyState->previous != keyState->current) {
-        keyState->timestamp = CurrentTime;
-        keyState->debouncing = true;
-    }
-}
-
-
 void sendKeyboardEvents() {
+    PROFILER_START(SendKeyboardEvents);
     bool HasUsbBasicKeyboardReportChanged = memcmp(ActiveUsbBasicKeyboardReport, GetInactiveUsbBasicKeyboardReport(), sizeof(usb_basic_keyboard_report_t)) != 0;
     bool HasUsbMediaKeyboardReportChanged = memcmp(ActiveUsbMediaKeyboardReport, GetInactiveUsbMediaKeyboardReport(), sizeof(usb_media_keyboard_report_t)) != 0;
     bool HasUsbSystemKeyboardReportChanged = memcmp(ActiveUsbSystemKeyboardReport, GetInactiveUsbSystemKeyboardReport(), sizeof(usb_system_keyboard_report_t)) != 0;
@@ -331,6 +324,7 @@ void sendKeyboardEvents() {
             UsbReportUpdateSemaphore |= 1 << USB_SYSTEM_KEYBOARD_INTERFACE_INDEX;
         }
     }
+    PROFILER_STOP(SendKeyboardEvents);
 }
 
 void resetKeyboardReports() {
@@ -351,7 +345,7 @@ static bool execModifierActions() {
     for (uint8_t i = 0; i < State.actionCount; ++i) {
         pending_key_t *actionKey = action(i);
         key_action_t *action = resolveAction(&actionKey->keyRef);
-        if (actionKey->keyRef.state->current && action->type == KeyActionType_Keystroke && !action->keystroke.scancode) {
+        if (isPressed(&actionKey->keyRef) && action->type == KeyActionType_Keystroke && !action->keystroke.scancode) {
             addModifiersToReport(action->keystroke.modifiers);
             executedModifierActionCount++;
         }
@@ -364,7 +358,7 @@ static void executeActions() {
     if (State.scheduledForImmediateExecutionAmount > 0) {
         for (int i = State.scheduledForImmediateExecutionAmount - 1; i >= 0; --i) {
             pending_key_t *key = &State.scheduledForImmediateExecution[i]; ;
-            applyKeyAction(key->keyRef.state, resolveAction(&key->keyRef));
+            applyKeyAction(&key->keyRef, resolveAction(&key->keyRef));
             key->activated = true;
         }
 
@@ -393,14 +387,14 @@ static void executeActions() {
     for (int i = State.actionCount - 1; i >= 0; --i) {
         pending_key_t* actionKey = action(i);
 
-        key_state_t *keyState = actionKey->keyRef.state;
+        key_ref_t *keyRef = &actionKey->keyRef;
 
-        if (keyState->current && !keyState->suppressed) {
-            applyKeyAction(keyState, resolveAction(&actionKey->keyRef));
+        if (isPressed(keyRef) && !KeyStates_IsSuppressed(keyRef->slotId, keyRef->keyId)) {
+            applyKeyAction(keyRef, resolveAction(keyRef));
             actionKey->activated = true;
         }
 
-        if (!keyState->current) {
+        if (!isPressed(keyRef)) {
             untrackActionAt(i);
         }
     }
@@ -425,7 +419,7 @@ void handleFreeTypeState() {
     } else {
         for (int i = State.modifierCount - 1; i >= 0 ; --i) {
             bool isAlreadyTrackedAsAction = IndexOf(State.actions, &modifier(i)->keyRef, State.actionCount) >= 0;
-            if (modifier(i)->keyRef.state->current &&
+            if (isPressed(&modifier(i)->keyRef) &&
                 !isAlreadyTrackedAsAction) {
                 untrackModifier(i);
                 addAction(modifier(i));
@@ -440,8 +434,7 @@ void handleSecondaryRoleReleaseAwaitState() {
     bool shouldTriggerSecondaryRoleActivationMode = false;
     for (int i = State.modifierCount - 1; i >= 0; --i) {
         pending_key_t *pendingModifier = modifier(i);
-        key_state_t *keyState = pendingModifier->keyRef.state;
-        if (!keyState->current) {
+        if (!isPressed(&pendingModifier->keyRef)) {
             if (State.modifierCount > 1) {
                 // FIXME - this a workaround which is considered in the state == 2, doing this is roughly equivalent to pushing the mod into the action array
                 State.releasedActionKeyEnqueueTime = pendingModifier->enqueueTime;
@@ -464,7 +457,7 @@ void handleSecondaryRoleReleaseAwaitState() {
         // the previous conditions have to be met
         // or any of the modifiers may pressed long enough
         for (uint8_t i = 0; i < State.modifierCount; ++i) {
-            if (modifier(i)->keyRef.state->current) {
+            if (isPressed(&modifier(i)->keyRef)) {
                 if (secondaryRoleTimeoutElapsed(modifier(i))) {
                     shouldTriggerSecondaryRoleActivationMode = true;
                     break;
@@ -473,7 +466,7 @@ void handleSecondaryRoleReleaseAwaitState() {
         }
 
         for (uint8_t i = 0; i < State.actionCount && !shouldTriggerSecondaryRoleActivationMode; ++i) {
-            if (!action(i)->keyRef.state->current) {
+            if (!isPressed(&action(i)->keyRef)) {
                 shouldTriggerSecondaryRoleActivationMode = true;
             }
         }
@@ -499,7 +492,7 @@ void handleActiveSecondaryRoleState() {
     // should this be done in the previous stage?
     for (uint8_t i = 0; i < State.actionCount; ++i) {
         pending_key_t *key = action(i);
-        if (!key->keyRef.state->current && !key->activated) {
+        if (!isPressed(&key->keyRef) && !key->activated) {
             scheduleForImmediateExecution(key);
         }
     }
@@ -508,7 +501,7 @@ void handleActiveSecondaryRoleState() {
     bool activeModifierDetected = false;
     for (int i = State.modifierCount - 1; i >= 0; --i) {
         pending_key_t *pendingModifier = modifier(i);
-        if (!pendingModifier->keyRef.state->current) {
+        if (!isPressed(&pendingModifier->keyRef)) {
             continue;
         }
         bool timeoutElapsed = secondaryRoleTimeoutElapsed(pendingModifier);
@@ -535,7 +528,7 @@ void handleActiveSecondaryRoleState() {
     for (int i = State.modifierCount - 1; i >= 0; --i) {
         pending_key_t *pendingModifier = modifier(i);
         bool timeoutElapsed = secondaryRoleTimeoutElapsed(pendingModifier);
-        if (!pendingModifier->keyRef.state->current) {
+        if (!isPressed(&pendingModifier->keyRef)) {
             if (!timeoutElapsed
                 && !pendingModifier->activated) {
                 scheduleForImmediateExecution(pendingModifier);
@@ -581,27 +574,32 @@ static void updateActiveUsbReports(void)
     State.longestPressedKey = NULL;
     State.scheduledForImmediateExecutionAmount = 0;
 
-    for (uint8_t slotId = 0; slotId < SLOT_COUNT; slotId++) {
-        for (uint8_t keyId = 0; keyId < MAX_KEY_COUNT_PER_MODULE; keyId++) {
-            key_state_t *keyState = &KeyStates[slotId][keyId];
+    PROFILER_START(KeyStates);
+    Debounce_UpdateKeyStates();
 
-            mitigateBouncing(keyState);
+    for (uint8_t slotId = 0; slotId < SLOT_COUNT; slotId++) {
+        slot_key_states_t *slotKeyStates = &SlotKeyStates[slotId];
 
-            if (keyState->current && !keyState->previous) {
-                if (SleepModeActive) {
-                    WakeUpHost();
-                }
+        if (slotKeyStates->current & ~slotKeyStates->previous) {
+            LedAnimation_KeysPressed(slotId, slotKeyStates->current & ~slotKeyStates->previous);
+            if (SleepModeActive) {
+                WakeUpHost();
             }
+        }
 
-
-            if (keyState->current) {
-                updateActiveKey(keyState, slotId, keyId);
-            }
+        uint64_t pressedKeys = slotKeyStates->current;
+        while (pressedKeys) {
+            uint8_t keyId = KeyStates_PopKeyId(&pressedKeys);
+            updateActiveKey(&KeyStates[slotId][keyId], slotId, keyId);
         }
     }
+    PROFILER_STOP(KeyStates);
 
+    PROFILER_START(GetActiveLayer);
     State.activeLayer = GetActiveLayer();
+    PROFILER_STOP(GetActiveLayer);
 
+    PROFILER_START(SecondaryRole);
     updateLongestPressedKey();
 
     // free mode - none of the modifiers is pressed yet, merely wait for them and push through all the
@@ -621,10 +619,13 @@ static void updateActiveUsbReports(void)
     if (State.stateType == 2) {
         handleActiveSecondaryRoleState();
     }
+    PROFILER_STOP(SecondaryRole);
 
     LedDisplay_SetLayer(State.activeLayer);
 
+    PROFILER_START(ProcessMouseActions);
     processMouseActions();
+    PROFILER_STOP(ProcessMouseActions);
 
     if (previousLayer != State.activeLayer && State.activeLayer == LayerId_Base) {
         suppressHeldKeystrokes();
@@ -632,12 +633,9 @@ static void updateActiveUsbReports(void)
 
     previousLayer = State.activeLayer;
     for (uint8_t slotId = 0; slotId < SLOT_COUNT; slotId++) {
-        for (uint8_t keyId = 0; keyId < MAX_KEY_COUNT_PER_MODULE; keyId++) {
-            if (!KeyStates[slotId][keyId].current) {
-                KeyStates[slotId][keyId].suppressed = false;
-            }
-            KeyStates[slotId][keyId].previous = KeyStates[slotId][keyId].current;
-        }
+        slot_key_states_t *slotKeyStates = &SlotKeyStates[slotId];
+        slotKeyStates->suppressed &= slotKeyStates->current;
+        slotKeyStates->previous = slotKeyStates->current;
     }
 }
 
@@ -645,7 +643,7 @@ void suppressHeldKeystrokes() {
     for (int i = State.actionCount - 1; i >= 0; --i) {
         pending_key_t *ac = action(i);
         if (ac->activated && resolveAction(&ac->keyRef)->type == KeyActionType_Keystroke) {
-            ac->keyRef.state->suppressed = true;
+            KeyStates_Suppress(ac->keyRef.slotId, ac->keyRef.keyId);
         }
     }
 }
@@ -654,13 +652,11 @@ void UpdateUsbReports(void)
 {
     static uint32_t lastUpdateTime;
 
-    for (uint8_t keyId = 0; keyId < RIGHT_KEY_MATRIX_KEY_COUNT; keyId++) {
-        KeyStates[SlotId_RightKeyboardHalf][keyId].current = RightKeyMatrix.keyStates[keyId];
-    }
-
-    uint8_t left_key_count = 7 * 5;
-    for (uint8_t keyId = 0; keyId < left_key_count; keyId++) {
-        KeyStates[1][keyId].current = LeftKeyStates[1][keyId].current;
+    SlotKeyStates[SlotId_RightKeyboardHalf].current = KeyScanner_GetFrame();
+    // The key states of a module that is polled with its cached identity are held back until the identity is
+    // verified, as they are garbage if the module turns out to speak another protocol by now.
+    if (UhkModuleStates[UhkModuleDriverId_LeftKeyboardHalf].isIdentityVerified) {
+        SlotKeyStates[SlotId_LeftKeyboardHalf].current = ModuleKeyEvents_Replay(SlotId_LeftKeyboardHalf);
     }
 
     if (UsbReportUpdateSemaphore && !SleepModeActive) {
@@ -671,6 +667,7 @@ void UpdateUsbReports(void)
         }
     }
 
+    PROFILER_START(UpdateUsbReports);
     lastUpdateTime = CurrentTime;
     UsbReportUpdateCounter++;
 
@@ -679,6 +676,10 @@ void UpdateUsbReports(void)
 
     updateActiveUsbReports();
 
+    PROFILER_START(LedAnimation);
+    LedAnimation_Update();
+    PROFILER_STOP(LedAnimation);
+
     bool HasUsbMouseReportChanged = memcmp(ActiveUsbMouseReport, GetInactiveUsbMouseReport(), sizeof(usb_mouse_report_t)) != 0;
 
     sendKeyboardEvents();
@@ -691,5 +692,6 @@ void UpdateUsbReports(void)
             UsbReportUpdateSemaphore |= 1 << USB_MOUSE_INTERFACE_INDEX;
         }
     }
+    PROFILER_STOP(UpdateUsbReports);
 }
 
@@ -7,6 +7,23 @@
 
 #define CRC16_HASH_LENGTH 2 // bytes
 
+// The implementation of crc16_update(), which can be overridden by the build. The hardware CRC unit is used where
+// the MCU has one, the nibble table on Cortex-M0+ parts, whose flash is scarce, and the byte table otherwise.
+#define CRC16_IMPLEMENTATION_BITWISE 0
+#define CRC16_IMPLEMENTATION_NIBBLE_TABLE 1
+#define CRC16_IMPLEMENTATION_BYTE_TABLE 2
+#define CRC16_IMPLEMENTATION_HARDWARE 3
+
+#ifndef CRC16_IMPLEMENTATION
+    #if defined(FSL_FEATURE_SOC_CRC_COUNT) && FSL_FEATURE_SOC_CRC_COUNT
+        #define CRC16_IMPLEMENTATION CRC16_IMPLEMENTATION_HARDWARE
+    #elif defined(__CORTEX_M) && __CORTEX_M == 0U
+        #define CRC16_IMPLEMENTATION CRC16_IMPLEMENTATION_NIBBLE_TABLE
+    #else
+        #define CRC16_IMPLEMENTATION CRC16_IMPLEMENTATION_BYTE_TABLE
+    #endif
+#endif
+
 typedef struct Crc16Data {
     uint16_t currentCrc;
 } crc16_data_t;
@@ -26,6 +43,18 @@ void crc16_update(crc16_data_t *crc16Config, const uint8_t *src, uint32_t length
 //! @param hash Pointer to the value returned for the final calculated crc value.
 void crc16_finalize(crc16_data_t *crc16Config, uint16_t *hash);
 
+//! @brief The implementations of crc16_update(), which continue crc with the given data and return the result.
+uint16_t crc16_update_bitwise(uint16_t crc, const uint8_t *src, uint32_t lengthInBytes);
+uint16_t crc16_update_nibble_table(uint16_t crc, const uint8_t *src, uint32_t lengthInBytes);
+uint16_t crc16_update_byte_table(uint16_t crc, const uint8_t *src, uint32_t lengthInBytes);
+#if CRC16_IMPLEMENTATION == CRC16_IMPLEMENTATION_HARDWARE
+uint16_t crc16_update_hardware(uint16_t crc, const uint8_t *src, uint32_t lengthInBytes);
+#endif
+
+//! @brief Checks the hardware CRC unit against the byte table once, and makes crc16_update() fall back to the table
+//! if they disagree. Does nothing with the other implementations.
+void CRC16_Init(void);
+
 void CRC16_UpdateMessageChecksum(i2c_message_t *message);
 bool CRC16_IsMessageValid(i2c_message_t *message);
 
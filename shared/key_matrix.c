@@ -1,7 +1,45 @@
 #include "fsl_gpio.h"
 #include "key_matrix.h"
 
-uint8_t DebounceTimePress = 50, DebounceTimeRelease = 50;
+// Groups the columns into runs of pins that can be extracted together. Runs of the same port are kept
+// adjacent, so that KeyMatrix_ReadCols() reads every port only once. Falls back to reading the pins one by
+// one if the columns don't fit into KEY_MATRIX_MAX_COL_RUNS runs.
+static void initColRuns(key_matrix_t *keyMatrix)
+{
+    keyMatrix->colRunNum = 0;
+
+    for (uint8_t colId = 0; colId < keyMatrix->colNum; colId++) {
+        key_matrix_pin_t *col = keyMatrix->cols + colId;
+        uint8_t rotation = (col->pin - colId) & 31;
+
+        key_matrix_col_run_t *run = keyMatrix->colRuns;
+        key_matrix_col_run_t *runEnd = keyMatrix->colRuns + keyMatrix->colRunNum;
+        while (run < runEnd && (run->gpio != col->gpio || run->rotation != rotation)) {
+            run++;
+        }
+
+        if (run == runEnd) {
+            if (keyMatrix->colRunNum >= KEY_MATRIX_MAX_COL_RUNS) {
+                keyMatrix->scanMode = KeyMatrixScanMode_PerPin;
+                return;
+            }
+
+            // Insert the new run after the last run of the same port.
+            key_matrix_col_run_t *position = runEnd;
+            for (key_matrix_col_run_t *portRun = keyMatrix->colRuns; portRun < runEnd; portRun++) {
+                if (portRun->gpio == col->gpio) {
+                    position = portRun + 1;
+                }
+            }
+            memmove(position + 1, position, (runEnd - position) * sizeof(key_matrix_col_run_t));
+            *position = (key_matrix_col_run_t){.gpio = col->gpio, .pinMask = 0, .rotation = rotation};
+            run = position;
+            keyMatrix->colRunNum++;
+        }
+
+        run->pinMask |= 1U << col->pin;
+    }
+}
 
 void KeyMatrix_Init(key_matrix_t *keyMatrix)
 {
@@ -18,25 +56,71 @@ void KeyMatrix_Init(key_matrix_t *keyMatrix)
                           &(port_pin_config_t){.pullSelect=kPORT_PullDown, .mux=kPORT_MuxAsGpio});
         GPIO_PinInit(col->gpio, col->pin, &(gpio_pin_config_t){kGPIO_DigitalInput});
     }
+
+    if (keyMatrix->scanMode == KeyMatrixScanMode_PortWide) {
+        initColRuns(keyMatrix);
+    }
+}
+
+// Returns the column states of the currently driven row, bit n being the state of column n.
+uint32_t KeyMatrix_ReadCols(key_matrix_t *keyMatrix)
+{
+    uint32_t colStates = 0;
+
+    if (keyMatrix->scanMode == KeyMatrixScanMode_PortWide) {
+        GPIO_Type *gpio = NULL;
+        uint32_t pdir = 0;
+        key_matrix_col_run_t *runEnd = keyMatrix->colRuns + keyMatrix->colRunNum;
+        for (key_matrix_col_run_t *run = keyMatrix->colRuns; run < runEnd; run++) {
+            if (run->gpio != gpio) {
+                gpio = run->gpio;
+                pdir = gpio->PDIR;
+            }
+            uint32_t pins = pdir & run->pinMask;
+            colStates |= (pins >> run->rotation) | (pins << ((32 - run->rotation) & 31));
+        }
+    } else {
+        for (uint8_t colId = 0; colId < keyMatrix->colNum; colId++) {
+            key_matrix_pin_t *col = keyMatrix->cols + colId;
+            colStates |= GPIO_ReadPinInput(col->gpio, col->pin) << colId;
+        }
+    }
+
+    return colStates;
 }
 
 void KeyMatrix_ScanRow(key_matrix_t *keyMatrix)
 {
-    uint8_t *keyState = keyMatrix->keyStates + keyMatrix->currentRowNum * keyMatrix->colNum;
     key_matrix_pin_t *row = keyMatrix->rows + keyMatrix->currentRowNum;
     GPIO_Type *rowGpio = row->gpio;
     uint32_t rowPin = row->pin;
 
     GPIO_WritePinOutput(rowGpio, rowPin, 1);
-
-    key_matrix_pin_t *colEnd = keyMatrix->cols + keyMatrix->colNum;
-    for (key_matrix_pin_t *col = keyMatrix->cols; col<colEnd; col++) {
-        *(keyState++) = GPIO_ReadPinInput(col->gpio, col->pin);
-    }
-
+    keyMatrix->rowStates[keyMatrix->currentRowNum] = KeyMatrix_ReadCols(keyMatrix);
     GPIO_WritePinOutput(rowGpio, rowPin, 0);
 
     if (++keyMatrix->currentRowNum >= keyMatrix->rowNum) {
         keyMatrix->currentRowNum = 0;
     }
 }
+
+// Packs the key states into dstBits in key id order, like BoolBytesToBits() would do.
+void KeyMatrix_GetKeyStateBits(key_matrix_t *keyMatrix, uint8_t *dstBits)
+{
+    uint32_t accumulator = 0;
+    uint8_t accumulatedBitCount = 0;
+
+    for (uint8_t rowId = 0; rowId < keyMatrix->rowNum; rowId++) {
+        accumulator |= keyMatrix->rowStates[rowId] << accumulatedBitCount;
+        accumulatedBitCount += keyMatrix->colNum;
+        while (accumulatedBitCount >= 8) {
+            *(dstBits++) = accumulator;
+            accumulator >>= 8;
+            accumulatedBitCount -= 8;
+        }
+    }
+
+    if (accumulatedBitCount) {
+        *dstBits = accumulator;
+    }
+}
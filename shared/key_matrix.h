@@ -9,6 +9,8 @@
 // Macros:
 
     #define MAX_KEYS_IN_MATRIX 100
+    #define KEY_MATRIX_MAX_ROWS 8
+    #define KEY_MATRIX_MAX_COL_RUNS 8
 
 // Typedefs:
 
@@ -19,22 +21,41 @@
         uint32_t pin;
     } key_matrix_pin_t;
 
+    typedef enum {
+        KeyMatrixScanMode_PerPin,    // Reads every column pin separately
+        KeyMatrixScanMode_PortWide,  // Reads the PDIR of every involved port once per row
+    } key_matrix_scan_mode_t;
+
+    // Columns whose pins are on the same port and are offset from their column index by the same amount,
+    // so they can be extracted from PDIR by a single mask and rotation.
+    typedef struct {
+        GPIO_Type *gpio;
+        uint32_t pinMask;
+        uint8_t rotation;  // Pin number minus column index, modulo 32
+    } key_matrix_col_run_t;
+
     typedef struct {
         uint8_t colNum;
         uint8_t rowNum;
         uint8_t currentRowNum;
+        key_matrix_scan_mode_t scanMode;
         key_matrix_pin_t *cols;
         key_matrix_pin_t *rows;
-        uint8_t keyStates[MAX_KEYS_IN_MATRIX];
+        uint8_t colRunNum;
+        key_matrix_col_run_t colRuns[KEY_MATRIX_MAX_COL_RUNS];
+        uint32_t rowStates[KEY_MATRIX_MAX_ROWS];  // Bit n of a row is the state of column n
     } key_matrix_t;
 
-// Variables:
-
-    extern uint8_t DebounceTimePress, DebounceTimeRelease;
-
 // Functions:
 
     void KeyMatrix_Init(key_matrix_t *keyMatrix);
     void KeyMatrix_ScanRow(key_matrix_t *keyMatrix);
+    uint32_t KeyMatrix_ReadCols(key_matrix_t *keyMatrix);
+    void KeyMatrix_GetKeyStateBits(key_matrix_t *keyMatrix, uint8_t *dstBits);
+
+    static inline bool KeyMatrix_GetKeyState(key_matrix_t *keyMatrix, uint8_t keyId)
+    {
+        return (keyMatrix->rowStates[keyId / keyMatrix->colNum] >> (keyId % keyMatrix->colNum)) & 1;
+    }
 
 #endif
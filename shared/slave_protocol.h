@@ -5,6 +5,7 @@
 
     #include "fsl_common.h"
     #include "attributes.h"
+    #include "versions.h"
 
 // Macros:
 
@@ -15,6 +16,14 @@
     #define SLAVE_SYNC_STRING "SYNC"
     #define SLAVE_SYNC_STRING_LENGTH (sizeof(SLAVE_SYNC_STRING) - 1)
 
+    #define SLAVE_KEY_EVENT_PRESSED 0x80
+    #define SLAVE_KEY_EVENT_KEY_ID_MASK 0x7f
+
+    // The sequence number of key delta replies, found in the low bits of the reply header and in the high bits of
+    // the request flags, where it acknowledges the last reply that the master has processed.
+    #define SLAVE_KEY_DELTAS_SEQUENCE_MASK 0x0f
+    #define SLAVE_KEY_DELTAS_ACK_SHIFT 4
+
 // Typedefs:
 
     typedef enum {
@@ -23,6 +32,9 @@
         SlaveCommand_RequestKeyStates,
         SlaveCommand_SetTestLed,
         SlaveCommand_SetLedPwmBrightness,
+        SlaveCommand_RequestKeyEvents,
+        SlaveCommand_RequestKeyDeltas,
+        SlaveCommand_Batch,
     } slave_command_t;
 
     typedef enum {
@@ -32,6 +44,8 @@
         SlaveProperty_ModuleId,
         SlaveProperty_KeyCount,
         SlaveProperty_PointerCount,
+        SlaveProperty_KeyEventTickUsec,
+        SlaveProperty_Identity,
     } slave_property_t;
 
     typedef enum {
@@ -48,6 +62,60 @@
         uint8_t data[I2C_MESSAGE_MAX_PAYLOAD_LENGTH];
     } ATTR_PACKED i2c_message_t;
 
+    typedef enum {
+        SlaveKeyEventsFlag_Overflow  = 1 << 0,  // Events were lost, the reply carries no events
+        SlaveKeyEventsFlag_KeyStates = 1 << 1,  // The key states follow the events
+    } slave_key_events_flag_t;
+
+    typedef struct {
+        uint8_t keyIdAndState;  // The key ID, ORed with SLAVE_KEY_EVENT_PRESSED for presses
+        uint8_t tickDelta;      // Key scanner ticks since the previous event, saturated at UINT8_MAX
+    } ATTR_PACKED slave_key_event_t;
+
+    // The reply of SlaveCommand_RequestKeyEvents is this header and eventCount events from oldest to newest. The key
+    // state bits of every key follow if the second byte of the command was nonzero or the queue overflowed.
+    typedef struct {
+        uint8_t flags;
+        uint8_t eventCount;
+        uint16_t ticksSinceLastEvent;  // Key scanner ticks from the newest event to the reply, saturated at UINT16_MAX
+    } ATTR_PACKED slave_key_events_header_t;
+
+    typedef enum {
+        SlaveKeyDeltasRequest_KeyStates = 1 << 0,  // Include the key states in the reply
+    } slave_key_deltas_request_t;
+
+    // The reply of SlaveCommand_RequestKeyDeltas starts with a header byte of these flags and the sequence number.
+    // If nothing happened since the acknowledged reply, the header alone is the reply, with no flags and the sequence
+    // number of that reply. Otherwise, the sequence number is incremented, and the events of the reply are resent
+    // along with the newer ones until the master acknowledges it, so a lost reply doesn't lose events.
+    typedef enum {
+        SlaveKeyDeltasFlag_Overflow  = 1 << 4,  // Events were lost, the reply carries the key states but no events
+        SlaveKeyDeltasFlag_KeyStates = 1 << 5,  // The key states follow the events
+        SlaveKeyDeltasFlag_Events    = 1 << 6,  // An event count, a uint16_t ticksSinceLastEvent and the events follow
+    } slave_key_deltas_flag_t;
+
+    // The reply of SlaveProperty_Identity, every property that the master needs before polling the module in one
+    // message. It starts with the sync string, so that the stale reply of a module that doesn't know the property
+    // can't be taken for it.
+    typedef struct {
+        char sync[SLAVE_SYNC_STRING_LENGTH];
+        version_t moduleProtocolVersion;
+        version_t firmwareVersion;
+        uint8_t moduleId;
+        uint8_t keyCount;
+        uint8_t pointerCount;
+        uint16_t keyEventTickUsec;
+    } ATTR_PACKED slave_identity_t;
+
+    // SlaveCommand_Batch is followed by sub-commands of this header and length bytes of value, which are applied in
+    // order. Every sub-command is a command without a reply, and its value is what follows the command ID of the
+    // single command, so that older modules can be sent the same commands one by one. Unknown sub-commands are
+    // skipped.
+    typedef struct {
+        uint8_t commandId;
+        uint8_t length;
+    } ATTR_PACKED slave_batch_command_header_t;
+
 // Variables:
 
     extern char SlaveSyncString[];
@@ -27,11 +27,11 @@
     #define DEVICE_PROTOCOL_PATCH_VERSION 0
 
     #define MODULE_PROTOCOL_MAJOR_VERSION 4
-    #define MODULE_PROTOCOL_MINOR_VERSION 0
+    #define MODULE_PROTOCOL_MINOR_VERSION 4
     #define MODULE_PROTOCOL_PATCH_VERSION 0
 
     #define USER_CONFIG_MAJOR_VERSION 4
-    #define USER_CONFIG_MINOR_VERSION 1
+    #define USER_CONFIG_MINOR_VERSION 3
     #define USER_CONFIG_PATCH_VERSION 0
 
     #define HARDWARE_CONFIG_MAJOR_VERSION 1